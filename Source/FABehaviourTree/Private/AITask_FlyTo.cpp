@@ -9,7 +9,6 @@
 #include "Engine/World.h"
 #include "GameFramework/Character.h"
 #include "TimerManager.h"
-#include "Async/Async.h"
 #include "GameFramework/PawnMovementComponent.h"
 #include "VisualLogger/VisualLogger.h"
 
@@ -54,58 +53,80 @@ bool UAITask_FlyTo::AdjustInitialPath(UPathFollowingComponent* PFComp)
 		FinishMoveTask(EPathFollowingResult::Invalid);
 		return false;
 	}
-	UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, x, system, PFComp]
+	RequestInitialPath(x);
+	return true;
+}
+
+void UAITask_FlyTo::RequestInitialPath(const FFAHPAPath& HPAPath)
+{
+	UFAWorldSubsystem* system = GetWorld()->GetSubsystem<UFAWorldSubsystem>();
+	const int32 QueryId = system->RequestFinePathByHPA(
+		HPAPath, FFAOnPathQueryFinished::CreateWeakLambda(this, [this, HPAPath](const FFAFinePath& FinePath)
+		{
+			OnInitialPathFound(HPAPath, FinePath);
+		}), ColliderSize, ColliderSize.UnitZ() * ColliderSize, PathQueryPriority, this);
+	//The queue is full, wait for it to drain.
+	if (QueryId == INDEX_NONE)
+	{
+		GetWorld()->GetTimerManager().SetTimer(RetryPathQueryHandle, FTimerDelegate::CreateWeakLambda(
+			                                       this, [this, HPAPath] { RequestInitialPath(HPAPath); }),
+		                                       0.1f, false);
+	}
+}
+
+void UAITask_FlyTo::OnInitialPathFound(const FFAHPAPath& HPAPath, FFAFinePath FinePath)
+{
+	if (TaskState == EGameplayTaskState::Finished) return;
+	if (!FinePath.bBoundLoaded)
+	{
+		GetWorld()->GetTimerManager().SetTimer(RetryPathQueryHandle, FTimerDelegate::CreateWeakLambda(
+			                                       this, [this, HPAPath] { RequestInitialPath(HPAPath); }),
+		                                       0.1f, false);
+		return;
+	}
+	UPathFollowingComponent* PFComp = OwnerController
+		                                  ? GetAIController()->GetPathFollowingComponent()
+		                                  : nullptr;
+	if (!FinePath.bIsSuccess || FinePath.Nodes.Num() == 0 || !PFComp)
+	{
+		FinishMoveTask(EPathFollowingResult::Invalid);
+		return;
+	}
+	GetWorld()->GetSubsystem<UFAWorldSubsystem>()->InterpolateFinePath(FinePath);
+
+	auto ResultData = OwnerController->MoveTo(MoveRequest, &Path);
+	switch (ResultData.Code)
 	{
-		auto finePath = system->CreateFinePathByHPA(x, ColliderSize,
-		                                            ColliderSize.UnitZ() * ColliderSize);
-		if (!finePath.bIsSuccess || finePath.Nodes.Num() == 0)
+	case EPathFollowingRequestResult::Failed:
+		FinishMoveTask(EPathFollowingResult::Invalid);
+		break;
+
+	case EPathFollowingRequestResult::AlreadyAtGoal:
+		MoveRequestID = ResultData.MoveId;
+		OnRequestFinished(ResultData.MoveId,
+		                  FPathFollowingResult(EPathFollowingResult::Success,
+		                                       FPathFollowingResultFlags::AlreadyAtGoal));
+		break;
+
+	case EPathFollowingRequestResult::RequestSuccessful:
+		bIsStillAdjustingPath = true;
+		MoveRequestID = ResultData.MoveId;
+		PFComp->OnRequestFinished.AddUObject(this, &UAITask_FlyTo::OnRequestFinished);
+		SetObservedPath(Path);
+		Path->SetIgnoreInvalidation(true);
+		Path->GetPathPoints().Empty();
+		AddNextPath(FinePath, Path);
+		Path->DoneUpdating(ENavPathUpdateType::NavigationChanged);
+		if (IsFinished())
 		{
-			AsyncTask(ENamedThreads::GameThread, [this, finePath, PFComp]
-			{
-				FinishMoveTask(EPathFollowingResult::Invalid);
-			});
-			return;
+			UE_VLOG(OwnerController, LogFAAITask, Error,
+			        TEXT("%s> re-Activating Finished task!"), *GetName());
 		}
-		system->InterpolateFinePath(finePath);
+		break;
 
-		AsyncTask(ENamedThreads::GameThread, [this, finePath, PFComp]
-		{
-			auto ResultData = OwnerController->MoveTo(MoveRequest, &Path);
-			switch (ResultData.Code)
-			{
-			case EPathFollowingRequestResult::Failed:
-				FinishMoveTask(EPathFollowingResult::Invalid);
-				break;
-
-			case EPathFollowingRequestResult::AlreadyAtGoal:
-				MoveRequestID = ResultData.MoveId;
-				OnRequestFinished(ResultData.MoveId,
-				                  FPathFollowingResult(EPathFollowingResult::Success,
-				                                       FPathFollowingResultFlags::AlreadyAtGoal));
-				break;
-
-			case EPathFollowingRequestResult::RequestSuccessful:
-				bIsStillAdjustingPath = true;
-				MoveRequestID = ResultData.MoveId;
-				PFComp->OnRequestFinished.AddUObject(this, &UAITask_FlyTo::OnRequestFinished);
-				SetObservedPath(Path);
-				Path->SetIgnoreInvalidation(true);
-				Path->GetPathPoints().Empty();
-				AddNextPath(finePath, Path);
-				Path->DoneUpdating(ENavPathUpdateType::NavigationChanged);
-				if (IsFinished())
-				{
-					UE_VLOG(OwnerController, LogFAAITask, Error,
-					        TEXT("%s> re-Activating Finished task!"), *GetName());
-				}
-				break;
-
-			default: checkNoEntry();
-				break;
-			}
-		});
-	});
-	return true;
+	default: checkNoEntry();
+		break;
+	}
 }
 
 void UAITask_FlyTo::OnRequestFinished(FAIRequestID RequestID, const FPathFollowingResult& Result)
@@ -147,7 +168,6 @@ void UAITask_FlyTo::AddNextPath(const FFAFinePath& NextPath, FNavPathSharedPtr I
 
 	PathPoints.Append(NextPath.InterpolatedPoints);
 	InPath->DoneUpdating(ENavPathUpdateType::NavigationChanged);
-	const auto system = GetWorld()->GetSubsystem<UFAWorldSubsystem>();
 	bIsStillAdjustingPath = true;
 #if ENABLE_VISUAL_LOG
 	for (auto i = 0; i < NextPath.ControlPoints.Num(); i++)
@@ -167,24 +187,50 @@ void UAITask_FlyTo::AddNextPath(const FFAFinePath& NextPath, FNavPathSharedPtr I
 			            node.NodeData. HalfExtent ), FColor::Green, TEXT("Path"));
 	}
 #endif
-	GenTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, NextPath, system, InPath]
-	{
-		auto finePath = system->CreateNextFinePath(NextPath, ColliderSize,
-		                                           ColliderSize.UnitZ() * ColliderSize);
-		while (!finePath.bBoundLoaded)
+	RequestNextPath(NextPath, InPath);
+}
+
+void UAITask_FlyTo::RequestNextPath(const FFAFinePath& NextPath, FNavPathSharedPtr InPath)
+{
+	if (TaskState == EGameplayTaskState::Finished) return;
+	const auto system = GetWorld()->GetSubsystem<UFAWorldSubsystem>();
+	const int32 QueryId = system->RequestNextFinePath(
+		NextPath, FFAOnPathQueryFinished::CreateWeakLambda(this, [this, NextPath, InPath](FFAFinePath FinePath)
 		{
-			FPlatformProcess::Sleep(0.1f);
 			if (TaskState == EGameplayTaskState::Finished) return;
-			finePath = system->CreateNextFinePath(NextPath, ColliderSize,
-			                                      ColliderSize.UnitZ() * ColliderSize);
-		}
-		if (finePath.bIsSuccess)
-		{
-			system->InterpolateFinePath(finePath);
-		}
-		AsyncTask(ENamedThreads::GameThread, [this, finePath, InPath]
-		{
-			AddNextPath(finePath, InPath);
-		});
-	});
+			//Retry until the bounds of the segment are loaded.
+			if (!FinePath.bBoundLoaded)
+			{
+				GetWorld()->GetTimerManager().SetTimer(RetryPathQueryHandle, FTimerDelegate::CreateWeakLambda(
+					                                       this, [this, NextPath, InPath]
+					                                       {
+						                                       RequestNextPath(NextPath, InPath);
+					                                       }), 0.1f, false);
+				return;
+			}
+			if (FinePath.bIsSuccess)
+			{
+				GetWorld()->GetSubsystem<UFAWorldSubsystem>()->InterpolateFinePath(FinePath);
+			}
+			AddNextPath(FinePath, InPath);
+		}), ColliderSize, ColliderSize.UnitZ() * ColliderSize, PathQueryPriority, this);
+	//The queue is full, wait for it to drain.
+	if (QueryId == INDEX_NONE)
+	{
+		GetWorld()->GetTimerManager().SetTimer(RetryPathQueryHandle, FTimerDelegate::CreateWeakLambda(
+			                                       this, [this, NextPath, InPath]
+			                                       {
+				                                       RequestNextPath(NextPath, InPath);
+			                                       }), 0.1f, false);
+	}
+}
+
+void UAITask_FlyTo::OnDestroy(bool bInOwnerFinished)
+{
+	if (UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().ClearTimer(RetryPathQueryHandle);
+		if (UFAWorldSubsystem* system = World->GetSubsystem<UFAWorldSubsystem>()) system->CancelPathQueriesOf(this);
+	}
+	Super::OnDestroy(bInOwnerFinished);
 }
@@ -78,14 +78,12 @@ EBTNodeResult::Type UBTTask_FALocationQuery::ExecuteTask(UBehaviorTreeComponent&
 			}
 		});
 	};
-	Memory->Location = AsyncPool(*GetWorld()->GetSubsystem<UFAWorldSubsystem>()->GetThreadPool(),
-	                             [this, &OwnerComp, &ColliderSize]
-	                             {
-		                             return GetWorld()->GetSubsystem<UFALocationQuerySubsystem>()->
-		                                                GetRandomReachableLocation(
-			                                                ColliderSize,
-			                                                ColliderSize.Z * ColliderSize.UnitZ());
-	                             }, MoveTemp(Callback));
+	Memory->Location = GetWorld()->GetSubsystem<UFAWorldSubsystem>()->LaunchOnThreadPool(
+		[this, &OwnerComp, &ColliderSize]
+		{
+			return GetWorld()->GetSubsystem<UFALocationQuerySubsystem>()->GetRandomReachableLocation(
+				ColliderSize, ColliderSize.Z * ColliderSize.UnitZ());
+		}, MoveTemp(Callback));
 	if (Memory->Location.IsValid() && Memory->Location.IsReady())
 	{
 		if (Memory->Location.Get() == UFALocationQuerySubsystem::GetNullValue())
@@ -56,6 +56,7 @@ UAITask_MoveTo* UBTTask_FlyTo::PrepareMoveTask(UBehaviorTreeComponent& OwnerComp
 	if (MoveTask)
 	{
 		MoveTask->SetUp(MoveTask->GetAIController(), MoveRequest);
+		MoveTask->SetPathQueryPriority(PathQueryPriority);
 		if (ColliderSizeKey.SelectedKeyType == UBlackboardKeyType_Vector::StaticClass())
 		{
 			FVector ColliderSize = OwnerComp.GetBlackboardComponent()->GetValue<
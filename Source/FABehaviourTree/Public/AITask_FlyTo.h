@@ -27,15 +27,24 @@ public:
 			               ? FVector::ZeroVector
 			               : InColliderSize;
 	};
+	/** Priority of the path queries of the move, e.g. higher for agents the player sees. */
+	void SetPathQueryPriority(EFAPathQueryPriority InPriority) { PathQueryPriority = InPriority; }
 
 protected:
 	virtual void PerformMove() override;
 	bool AdjustInitialPath(UPathFollowingComponent* PFComp);
+	virtual void OnDestroy(bool bInOwnerFinished) override;
+	/** Queue the search of the first segment of the path, retrying while the queue is full. */
+	void RequestInitialPath(const FFAHPAPath& HPAPath);
+	void OnInitialPathFound(const FFAHPAPath& HPAPath, FFAFinePath FinePath);
+	/** Queue the search of the segment after a path, retrying while the queue is full or its bounds are unloaded. */
+	void RequestNextPath(const FFAFinePath& NextPath, FNavPathSharedPtr InPath);
 	virtual void
 	OnRequestFinished(FAIRequestID RequestID, const FPathFollowingResult& Result) override;
 	void AddNextPath(const FFAFinePath& NewNextPath, FNavPathSharedPtr InPath);
-	UE::Tasks::FTask GenTask;
 	FVector ColliderSize;
+	EFAPathQueryPriority PathQueryPriority = EFAPathQueryPriority::Normal;
+	FTimerHandle RetryPathQueryHandle;
 	bool bIsStillAdjustingPath = false;
 	FTimerHandle PathFinishDelegateHandle;
 };
@@ -10,6 +10,7 @@
 #include "AITypes.h"
 #include "BehaviorTree/Tasks/BTTask_BlackboardBase.h"
 #include "BehaviorTree/Tasks/BTTask_MoveDirectlyToward.h"
+#include "FAPathQueryScheduler.h"
 #include "BTTask_FlyTo.generated.h"
 
 class UAITask_MoveTo;
@@ -32,4 +33,7 @@ protected:
 	                                        FAIMoveRequest& MoveRequest) override;
 	UPROPERTY(EditAnywhere, Category=FA)
 	struct FBlackboardKeySelector ColliderSizeKey;
+	/** Priority of the path queries of the move against the other agents' queries. */
+	UPROPERTY(EditAnywhere, Category=FA)
+	EFAPathQueryPriority PathQueryPriority = EFAPathQueryPriority::Normal;
 };
@@ -4,8 +4,8 @@
 
 #include "FANeighbourData.h"
 #include "FAWorldSubsystem.h"
-#include "FAPathfindingAlgo.h"
 #include "Engine/AssetManager.h"
+#include "Misc/PackageName.h"
 
 // Sets default values
 AFABound::AFABound()
@@ -16,8 +16,10 @@ AFABound::AFABound()
 
 void AFABound::BeginDestroy()
 {
-	//Wait for all pathfinding ends due to this might be referenced in the algorithm.
-	FPlatformProcess::ConditionalSleep([] { return !UFAPathfindingAlgo::IsGenerating(); });
+	//Only the queries searching this bound are stopped, and only the steps reading it right now are waited for.
+	bPathQueriesClosed = true;
+	CancelPathQueries();
+	FPlatformProcess::ConditionalSleep([this] { return NumPathQuerySteps.load() == 0; });
 	Super::BeginDestroy();
 }
 
@@ -65,13 +67,6 @@ void AFABound::OnLODChanged()
 		{
 			LoadNodes();
 		}
-		for (auto& m : NeighboursData)
-		{
-			if (!m.Value)
-			{
-				m.Value = GetWorld()->GetSubsystem<UFAWorldSubsystem>()->GetNeighbourData(m.Key);
-			}
-		}
 		break;
 	case 1:
 		if (!LoadedDataHandle.IsValid())
@@ -85,10 +80,6 @@ void AFABound::OnLODChanged()
 		break;
 	case 2:
 		UnloadNodes();
-		for (auto& m : NeighboursData)
-		{
-			m.Value = nullptr;
-		}
 		break;
 	default: checkNoEntry();
 	}
@@ -96,44 +87,266 @@ void AFABound::OnLODChanged()
 
 void AFABound::LoadNodes()
 {
-	UE::TScopeLock Lock(NodesDataLock);
-	if (LoadedDataHandle.IsValid() && LoadedDataHandle->IsActive()) return;
-	LoadedDataHandle = UAssetManager::GetStreamableManager().RequestSyncLoad(
-		BoundData->CombinedNodes.ToSoftObjectPath());
-	NodesData = Cast<UDataTable>(LoadedDataHandle->GetLoadedAsset());
+	bool bBlobLoaded;
+	{
+		FWriteScopeLock Lock(NodesDataLock);
+		bBlobLoaded = LoadNavBlob();
+		if (!bBlobLoaded && LoadedDataHandle.IsValid() && LoadedDataHandle->IsActive()) return;
+	}
+	if (!bBlobLoaded)
+	{
+		//Loaded without the lock, as loading may complete an async load of the bound that takes it.
+		const TSharedPtr<FStreamableHandle> Handle = UAssetManager::GetStreamableManager().RequestSyncLoad(
+			GetNodesDataPath());
+		FWriteScopeLock Lock(NodesDataLock);
+		LoadedDataHandle = Handle;
+		SetLoadedNodesData(Handle->GetLoadedAsset());
+	}
+	OnNodesDataLoaded();
 }
 
 void AFABound::LoadNodesAsync()
 {
-	UE::TScopeLock Lock(NodesDataLock);
-	LoadedDataHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
-		BoundData->CombinedNodes.ToSoftObjectPath(), FStreamableDelegate::CreateLambda([this]
+	bool bBlobLoaded;
+	{
+		FWriteScopeLock Lock(NodesDataLock);
+		//Mapping is cheap enough to not be deferred.
+		bBlobLoaded = LoadNavBlob();
+	}
+	if (bBlobLoaded)
+	{
+		OnNodesDataLoaded();
+		return;
+	}
+	const FSoftObjectPath Path = GetNodesDataPath();
+	//The handle of the request, set before it starts. Weak, the handle owns the delegate.
+	const TSharedRef<TWeakPtr<FStreamableHandle>> Request = MakeShared<TWeakPtr<FStreamableHandle>>();
+	const TSharedPtr<FStreamableHandle> Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		Path, FStreamableDelegate::CreateWeakLambda(this, [this, Path, Request]
 		{
-			UE::TScopeLock Lock(NodesDataLock);
-			NodesData = Cast<UDataTable>(LoadedDataHandle->GetLoadedAsset());
-		}));
+			{
+				FWriteScopeLock Lock(NodesDataLock);
+				//Unloaded or loaded again since requested, the nodes data is not wanted anymore.
+				if (!LoadedDataHandle.IsValid() || LoadedDataHandle != Request->Pin()) return;
+				SetLoadedNodesData(Path.ResolveObject());
+			}
+			OnNodesDataLoaded();
+		}), FStreamableManager::DefaultAsyncLoadPriority, false, true);
+	*Request = Handle;
+	{
+		FWriteScopeLock Lock(NodesDataLock);
+		LoadedDataHandle = Handle;
+	}
+	//Started without the lock, the delegate is called right away if the asset is already loaded.
+	if (Handle.IsValid()) Handle->StartStalledHandle();
+}
+
+void AFABound::SetNavData(UFANavOctreeData* InNavData)
+{
+	{
+		FWriteScopeLock Lock(NodesDataLock);
+		LoadedDataHandle.Reset();
+		SetLoadedNodesData(InNavData);
+	}
+	OnNodesDataLoaded();
 }
 
 void AFABound::UnloadNodes()
 {
+	//Stop the searches holding the lock instead of waiting for them.
+	CancelPathQueries();
+	FWriteScopeLock Lock(NodesDataLock);
 	LoadedDataHandle.Reset();
-	NodesData = nullptr;
+	//Unmap now instead of when collected.
+	if (NavData) NavData->ReleaseBlob();
+	NavData = nullptr;
+	ResolveSearchNodes();
+	EdgeClearanceCache.Invalidate();
+}
+
+void AFABound::AddPathQuery(const TSharedRef<FFAPathQueryToken, ESPMode::ThreadSafe>& Token)
+{
+	UE::TScopeLock Lock(PathQueryTokensLock);
+	//Amortised, the tokens of dropped queries go once they outnumber the ones left at the last pruning.
+	if (PathQueryTokens.Num() >= FMath::Max(2 * NumPrunedPathQueryTokens, 64))
+	{
+		PathQueryTokens.RemoveAllSwap([](const TWeakPtr<FFAPathQueryToken, ESPMode::ThreadSafe>& Weak)
+		{
+			return !Weak.IsValid();
+		});
+		NumPrunedPathQueryTokens = PathQueryTokens.Num();
+	}
+	PathQueryTokens.Add(Token);
+}
+
+bool AFABound::BeginPathQueryStep()
+{
+	//Counted before checking, so the destroyer either sees the step or the step sees the bound closed.
+	NumPathQuerySteps.fetch_add(1);
+	if (!bPathQueriesClosed.load()) return true;
+	NumPathQuerySteps.fetch_sub(1);
+	return false;
+}
+
+void AFABound::CancelPathQueries()
+{
+	UE::TScopeLock Lock(PathQueryTokensLock);
+	for (const TWeakPtr<FFAPathQueryToken, ESPMode::ThreadSafe>& Weak : PathQueryTokens)
+	{
+		if (const TSharedPtr<FFAPathQueryToken, ESPMode::ThreadSafe> Token = Weak.Pin()) Token->Cancel();
+	}
+	PathQueryTokens.Reset();
+	NumPrunedPathQueryTokens = 0;
+}
+
+bool AFABound::ResetObstacleOverlay(const UFANavOctreeData* InNavData)
+{
+	//A collected nodes data is not the same one, even at the same address.
+	if (ObstacleOverlayNavData.Get() == InNavData) return false;
+	ObstacleOverlayNavData = InNavData;
+	const bool bBlocked = ObstacleOverlay.GetNumBlocked() > 0;
+	ObstacleOverlay.Reset();
+	return bBlocked;
+}
+
+void AFABound::OnNodesDataLoaded()
+{
+	const UWorld* World = GetWorld();
+	if (UFAWorldSubsystem* Subsystem = World ? World->GetSubsystem<UFAWorldSubsystem>() : nullptr)
+		Subsystem->ApplyDynamicObstacles(this);
+}
+
+bool AFABound::IsNodeClearanceValid() const
+{
+	return bNodeClearanceValid && BoundData && GetActorLocation().Equals(BoundData->GeneratePosition);
 }
 
-void AFABound::AddNeighbourData(FString InName, UFANeighbourData* Data)
+FSoftObjectPath AFABound::GetNodesDataPath() const
 {
-	NeighboursData.FindOrAdd(InName, Data);
+	return BoundData->NavData.IsNull()
+		       ? BoundData->CombinedNodes.ToSoftObjectPath()
+		       : BoundData->NavData.ToSoftObjectPath();
+}
+
+bool AFABound::LoadNavBlob()
+{
+	if (NavData && NavData->IsBlobLoaded()) return true;
+	if (!BoundData || BoundData->NavBlobPath.IsEmpty()) return false;
+	UFANavOctreeData* BlobData = NewObject<UFANavOctreeData>(this);
+	if (!BlobData->LoadFromBlob(
+		FPackageName::LongPackageNameToFilename(BoundData->NavBlobPath, FFANavBlob::Extension)))
+	{
+		UE_LOG(LogFAWorldSubsystem, Warning, TEXT("%s failed to map %s, loading the nav data asset instead."),
+		       *GetName(), *BoundData->NavBlobPath);
+		return false;
+	}
+	NavData = BlobData;
+	ResolveSearchNodes();
+	return true;
+}
+
+void AFABound::SetLoadedNodesData(UObject* Asset)
+{
+	if (UFANavOctreeData* LoadedNavData = Cast<UFANavOctreeData>(Asset))
+	{
+		NavData = LoadedNavData;
+		ResolveSearchNodes();
+		return;
+	}
+	NavData = nullptr;
+	const UDataTable* NodesData = Cast<UDataTable>(Asset);
+	if (NodesData)
+	{
+		UE_LOG(LogFAWorldSubsystem, Warning,
+		       TEXT("%s has no nav data, converting the nodes data table on load. Regenerate the nodes to cook it."),
+		       *GetName());
+		NavData = NewObject<UFANavOctreeData>(this);
+		NavData->BuildFromDataTable(NodesData, BoundData->GeneratePosition, GetHalfExtent());
+	}
+	ResolveSearchNodes();
+}
+
+void AFABound::UpdateSearchNodes()
+{
+	const FVector Location = GetActorLocation();
+	{
+		FReadScopeLock Lock(NodesDataLock);
+		if (!HasSearchNodesLocked() || SearchNodesLocation == Location) return;
+	}
+	FWriteScopeLock Lock(NodesDataLock);
+	if (HasSearchNodesLocked()) ResolveNodeLocations();
+}
+
+void AFABound::UpdateGlobalHPANodes()
+{
+	FWriteScopeLock Lock(NodesDataLock);
+	ResolveGlobalHPANodes();
+}
+
+void AFABound::ResolveSearchNodes()
+{
+	ResolveNodeLocations();
+	ResolveGlobalHPANodes();
+}
+
+void AFABound::ResolveNodeLocations()
+{
+	if (!NavData || !BoundData)
+	{
+		NodeLocations.Empty();
+		return;
+	}
+	const FVector Location = GetActorLocation();
+	//The cached overlap results were tested around the nodes where they were.
+	if (Location != SearchNodesLocation) EdgeClearanceCache.Invalidate();
+	SearchNodesLocation = Location;
+	const FVector Offset = SearchNodesLocation - BoundData->GeneratePosition;
+	NodeLocations.SetNumUninitialized(NavData->Num());
+	for (int32 i = 0; i < NodeLocations.Num(); i++)
+	{
+		NodeLocations[i] = NavData->GetPosition(i) + Offset;
+	}
+}
+
+void AFABound::ResolveGlobalHPANodes()
+{
+	if (!NavData)
+	{
+		NodeGlobalHPANodes.Empty();
+		return;
+	}
+	NodeGlobalHPANodes.SetNumUninitialized(NavData->Num());
+	for (int32 i = 0; i < NodeGlobalHPANodes.Num(); i++)
+	{
+		const uint32 HPANode = NavData->GetHPANodeIndex(i);
+		//Missing only while the bound is not registered, resolved again once it is.
+		const uint32* GlobalHPANode = HPANode == INDEX_NONE ? nullptr : LocalToGlobalHPANodes.Find(HPANode);
+		NodeGlobalHPANodes[i] = GlobalHPANode ? *GlobalHPANode : INDEX_NONE;
+	}
+}
+
+void AFABound::AddNeighbourData(UFANeighbourData* Data)
+{
+	UE::TScopeLock Lock(NeighboursDataLock);
+	NeighboursData.Add(Data);
+}
+
+void AFABound::RemoveNeighbourData(const AFABound* Other)
+{
+	UE::TScopeLock Lock(NeighboursDataLock);
+	NeighboursData.RemoveAll([Other](const UFANeighbourData* Data)
+	{
+		return Data->Bound[0] == Other || Data->Bound[1] == Other;
+	});
 }
 
 UFANeighbourData* AFABound::FindNeighboursData(AFABound* Bound0, AFABound* Bound1)
 {
+	UE::TScopeLock Lock(NeighboursDataLock);
 	for (auto Data : NeighboursData)
 	{
-		if (Data.Value)
-		{
-			if ((Data.Value->Bound[0] == Bound0 && Data.Value->Bound[1] == Bound1) || (Data.Value->
-				Bound[0] == Bound1 && Data.Value->Bound[1] == Bound0)) return Data.Value.Get();
-		}
+		if ((Data->Bound[0] == Bound0 && Data->Bound[1] == Bound1) || (Data->Bound[0] == Bound1 && Data->
+			Bound[1] == Bound0)) return Data.Get();
 	}
 	return nullptr;
 }
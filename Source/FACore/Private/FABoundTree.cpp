@@ -0,0 +1,205 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FABoundTree.h"
+
+int32 FFABoundTree::Insert(const FBox& Box, uint32 UserData)
+{
+	const int32 Proxy = AllocateNode();
+	Nodes[Proxy].Box = Box;
+	Nodes[Proxy].UserData = UserData;
+	Nodes[Proxy].Height = 0;
+	InsertLeaf(Proxy);
+	NumLeaves++;
+	return Proxy;
+}
+
+void FFABoundTree::Remove(int32 Proxy)
+{
+	check(Nodes.IsValidIndex(Proxy) && Nodes[Proxy].IsLeaf() && Nodes[Proxy].Height == 0);
+	RemoveLeaf(Proxy);
+	FreeNode(Proxy);
+	NumLeaves--;
+}
+
+void FFABoundTree::Move(int32 Proxy, const FBox& Box)
+{
+	check(Nodes.IsValidIndex(Proxy) && Nodes[Proxy].IsLeaf() && Nodes[Proxy].Height == 0);
+	RemoveLeaf(Proxy);
+	Nodes[Proxy].Box = Box;
+	InsertLeaf(Proxy);
+}
+
+void FFABoundTree::Reset()
+{
+	Nodes.Reset();
+	Root = NullNode;
+	FreeList = NullNode;
+	NumLeaves = 0;
+}
+
+int32 FFABoundTree::AllocateNode()
+{
+	if (FreeList == NullNode) return Nodes.AddDefaulted();
+	const int32 Node = FreeList;
+	//Free nodes are linked by their parent.
+	FreeList = Nodes[Node].Parent;
+	Nodes[Node] = FNode();
+	return Node;
+}
+
+void FFABoundTree::FreeNode(int32 Node)
+{
+	Nodes[Node].Parent = FreeList;
+	Nodes[Node].Height = -1;
+	FreeList = Node;
+}
+
+double FFABoundTree::Area(const FBox& Box)
+{
+	const FVector Size = Box.GetSize();
+	return 2 * (Size.X * Size.Y + Size.Y * Size.Z + Size.Z * Size.X);
+}
+
+void FFABoundTree::InsertLeaf(int32 Leaf)
+{
+	if (Root == NullNode)
+	{
+		Root = Leaf;
+		Nodes[Root].Parent = NullNode;
+		return;
+	}
+
+	//Descend to the sibling with the least cost of the grown boxes.
+	const FBox LeafBox = Nodes[Leaf].Box;
+	int32 Index = Root;
+	while (!Nodes[Index].IsLeaf())
+	{
+		const FNode& Node = Nodes[Index];
+		const double NodeArea = Area(Node.Box);
+		const double CombinedArea = Area(Node.Box + LeafBox);
+		//Cost of making a new parent for this node and the leaf.
+		const double Cost = 2 * CombinedArea;
+		//Minimum cost of pushing the leaf further down the tree.
+		const double InheritanceCost = 2 * (CombinedArea - NodeArea);
+		auto ChildCost = [&](int32 Child)
+		{
+			const FBox Grown = Nodes[Child].Box + LeafBox;
+			return Nodes[Child].IsLeaf()
+				       ? Area(Grown) + InheritanceCost
+				       : Area(Grown) - Area(Nodes[Child].Box) + InheritanceCost;
+		};
+		const double Cost1 = ChildCost(Node.Child1);
+		const double Cost2 = ChildCost(Node.Child2);
+		if (Cost < Cost1 && Cost < Cost2) break;
+		Index = Cost1 < Cost2 ? Node.Child1 : Node.Child2;
+	}
+
+	const int32 Sibling = Index;
+	const int32 OldParent = Nodes[Sibling].Parent;
+	const int32 NewParent = AllocateNode();
+	Nodes[NewParent].Parent = OldParent;
+	Nodes[NewParent].Box = LeafBox + Nodes[Sibling].Box;
+	Nodes[NewParent].Height = Nodes[Sibling].Height + 1;
+	Nodes[NewParent].Child1 = Sibling;
+	Nodes[NewParent].Child2 = Leaf;
+	Nodes[Sibling].Parent = NewParent;
+	Nodes[Leaf].Parent = NewParent;
+	if (OldParent == NullNode)
+	{
+		Root = NewParent;
+	}
+	else if (Nodes[OldParent].Child1 == Sibling)
+	{
+		Nodes[OldParent].Child1 = NewParent;
+	}
+	else
+	{
+		Nodes[OldParent].Child2 = NewParent;
+	}
+	Refit(Nodes[Leaf].Parent);
+}
+
+void FFABoundTree::RemoveLeaf(int32 Leaf)
+{
+	if (Leaf == Root)
+	{
+		Root = NullNode;
+		return;
+	}
+	const int32 Parent = Nodes[Leaf].Parent;
+	const int32 GrandParent = Nodes[Parent].Parent;
+	const int32 Sibling = Nodes[Parent].Child1 == Leaf ? Nodes[Parent].Child2 : Nodes[Parent].Child1;
+	FreeNode(Parent);
+	if (GrandParent == NullNode)
+	{
+		Root = Sibling;
+		Nodes[Sibling].Parent = NullNode;
+		return;
+	}
+	if (Nodes[GrandParent].Child1 == Parent) Nodes[GrandParent].Child1 = Sibling;
+	else Nodes[GrandParent].Child2 = Sibling;
+	Nodes[Sibling].Parent = GrandParent;
+	Refit(GrandParent);
+}
+
+void FFABoundTree::Refit(int32 Node)
+{
+	while (Node != NullNode)
+	{
+		Node = Balance(Node);
+		FNode& Current = Nodes[Node];
+		const FNode& Child1 = Nodes[Current.Child1];
+		const FNode& Child2 = Nodes[Current.Child2];
+		Current.Height = 1 + FMath::Max(Child1.Height, Child2.Height);
+		Current.Box = Child1.Box + Child2.Box;
+		Node = Current.Parent;
+	}
+}
+
+int32 FFABoundTree::Balance(int32 A)
+{
+	if (Nodes[A].IsLeaf() || Nodes[A].Height < 2) return A;
+	const int32 B = Nodes[A].Child1;
+	const int32 C = Nodes[A].Child2;
+	const int32 Difference = Nodes[C].Height - Nodes[B].Height;
+	if (Difference > -2 && Difference < 2) return A;
+
+	//Promote the taller child, F and G are its children.
+	const bool bRotateUpC = Difference > 0;
+	const int32 Up = bRotateUpC ? C : B;
+	const int32 Other = bRotateUpC ? B : C;
+	const int32 F = Nodes[Up].Child1;
+	const int32 G = Nodes[Up].Child2;
+
+	//Swap A and Up.
+	Nodes[Up].Child1 = A;
+	Nodes[Up].Parent = Nodes[A].Parent;
+	Nodes[A].Parent = Up;
+	if (Nodes[Up].Parent == NullNode)
+	{
+		Root = Up;
+	}
+	else if (Nodes[Nodes[Up].Parent].Child1 == A)
+	{
+		Nodes[Nodes[Up].Parent].Child1 = Up;
+	}
+	else
+	{
+		Nodes[Nodes[Up].Parent].Child2 = Up;
+	}
+
+	//The taller grandchild stays under Up, the other replaces Up under A.
+	const bool bKeepF = Nodes[F].Height > Nodes[G].Height;
+	const int32 Keep = bKeepF ? F : G;
+	const int32 Moved = bKeepF ? G : F;
+	Nodes[Up].Child2 = Keep;
+	if (bRotateUpC) Nodes[A].Child2 = Moved;
+	else Nodes[A].Child1 = Moved;
+	Nodes[Moved].Parent = A;
+
+	Nodes[A].Box = Nodes[Other].Box + Nodes[Moved].Box;
+	Nodes[A].Height = 1 + FMath::Max(Nodes[Other].Height, Nodes[Moved].Height);
+	Nodes[Up].Box = Nodes[A].Box + Nodes[Keep].Box;
+	Nodes[Up].Height = 1 + FMath::Max(Nodes[A].Height, Nodes[Keep].Height);
+	return Up;
+}
@@ -0,0 +1,77 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FADynamicObstacleOverlay.h"
+#include "FANavOctreeData.h"
+#include "FAOccupancyGrid.h"
+
+void FFADynamicObstacleOverlay::AddObstacle(int32 ObstacleId, const FBox& GeneratedBox,
+                                            const UFANavOctreeData* NavData, TArray<uint32>& OutChangedNodes)
+{
+	//Shrunk so the leaves around the obstacle, only touching it, are left traversable.
+	const FVector Tolerance = (GeneratedBox.GetExtent() / 2).ComponentMin(FVector(FFAOccupancyGrid::TouchTolerance));
+	TArray<uint32> Nodes;
+	NavData->FindNodesInBox(FBox(GeneratedBox.Min + Tolerance, GeneratedBox.Max - Tolerance), Nodes);
+	Nodes.RemoveAll([NavData](uint32 Node) { return !NavData->IsTraversable(Node); });
+
+	FWriteScopeLock WriteLock(Lock);
+	if (ObstacleNodes.Contains(ObstacleId)) return;
+	if (BlockCounts.Num() < NavData->Num()) BlockCounts.SetNumZeroed(NavData->Num());
+	for (const uint32 Node : Nodes)
+	{
+		if (BlockCounts[Node]++ > 0) continue;
+		OutChangedNodes.Add(Node);
+		++NumBlocked;
+	}
+	ObstacleNodes.Add(ObstacleId, MoveTemp(Nodes));
+}
+
+void FFADynamicObstacleOverlay::RemoveObstacle(int32 ObstacleId, TArray<uint32>& OutChangedNodes)
+{
+	FWriteScopeLock WriteLock(Lock);
+	ObstacleBoxes.RemoveAllSwap([ObstacleId](const TPair<int32, FBox>& Obstacle)
+	{
+		return Obstacle.Key == ObstacleId;
+	});
+	NumObstacleBoxes = ObstacleBoxes.Num();
+	TArray<uint32> Nodes;
+	if (!ObstacleNodes.RemoveAndCopyValue(ObstacleId, Nodes)) return;
+	for (const uint32 Node : Nodes)
+	{
+		if (--BlockCounts[Node] > 0) continue;
+		OutChangedNodes.Add(Node);
+		--NumBlocked;
+	}
+}
+
+void FFADynamicObstacleOverlay::Reset()
+{
+	FWriteScopeLock WriteLock(Lock);
+	ObstacleNodes.Empty();
+	BlockCounts.Empty();
+	NumBlocked = 0;
+}
+
+void FFADynamicObstacleOverlay::SetObstacleBox(int32 ObstacleId, const FBox& Box)
+{
+	FWriteScopeLock WriteLock(Lock);
+	for (TPair<int32, FBox>& Obstacle : ObstacleBoxes)
+	{
+		if (Obstacle.Key != ObstacleId) continue;
+		Obstacle.Value = Box;
+		return;
+	}
+	ObstacleBoxes.Emplace(ObstacleId, Box);
+	NumObstacleBoxes = ObstacleBoxes.Num();
+}
+
+SIZE_T FFADynamicObstacleOverlay::GetAllocatedSize() const
+{
+	FReadScopeLock ReadLock(Lock);
+	SIZE_T AllocatedSize = ObstacleNodes.GetAllocatedSize() + BlockCounts.GetAllocatedSize() +
+		ObstacleBoxes.GetAllocatedSize();
+	for (auto& Obstacle : ObstacleNodes)
+	{
+		AllocatedSize += Obstacle.Value.GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
@@ -0,0 +1,78 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FAEdgeClearanceCache.h"
+#include "FAStats.h"
+
+DEFINE_STAT(STAT_FA_EdgeClearanceCacheHits);
+DEFINE_STAT(STAT_FA_EdgeClearanceCacheMisses);
+DEFINE_STAT(STAT_FA_EdgeClearanceCacheInvalidations);
+
+bool FFAEdgeClearanceCache::Find(const FFAEdgeClearanceKey& Key, bool& bOutClear) const
+{
+	{
+		FReadScopeLock ReadLock(Lock);
+		if (const bool* Found = Entries.Find(Key))
+		{
+			bOutClear = *Found;
+			++Hits;
+			INC_DWORD_STAT(STAT_FA_EdgeClearanceCacheHits);
+			return true;
+		}
+	}
+	++Misses;
+	INC_DWORD_STAT(STAT_FA_EdgeClearanceCacheMisses);
+	return false;
+}
+
+void FFAEdgeClearanceCache::Add(const FFAEdgeClearanceKey& Key, bool bClear, int32 MaxEntries, uint64 InEpoch)
+{
+	FWriteScopeLock WriteLock(Lock);
+	if (InEpoch != Epoch.load()) return;
+	if (bool* Found = Entries.Find(Key))
+	{
+		*Found = bClear;
+		return;
+	}
+	MaxEntries = FMath::Max(MaxEntries, 1);
+	//The limit may have been lowered.
+	while (Order.Num() > MaxEntries)
+	{
+		Entries.Remove(Order.Pop());
+	}
+	if (Order.Num() < MaxEntries)
+	{
+		Order.Add(Key);
+	}
+	else
+	{
+		//Only the oldest result goes, the others stay warm.
+		NextEvicted %= Order.Num();
+		Entries.Remove(Order[NextEvicted]);
+		Order[NextEvicted++] = Key;
+	}
+	Entries.Add(Key, bClear);
+}
+
+void FFAEdgeClearanceCache::Invalidate()
+{
+	FWriteScopeLock WriteLock(Lock);
+	//Bumped even when empty, for the tests running meanwhile.
+	++Epoch;
+	if (Entries.Num() == 0) return;
+	Entries.Reset();
+	Order.Reset();
+	NextEvicted = 0;
+	++Invalidations;
+	INC_DWORD_STAT(STAT_FA_EdgeClearanceCacheInvalidations);
+}
+
+FFAEdgeClearanceCacheStats FFAEdgeClearanceCache::GetStats() const
+{
+	FFAEdgeClearanceCacheStats Stats;
+	Stats.Hits = Hits;
+	Stats.Misses = Misses;
+	Stats.Invalidations = Invalidations;
+	FReadScopeLock ReadLock(Lock);
+	Stats.Entries = Entries.Num();
+	return Stats;
+}
@@ -0,0 +1,184 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FAHPAGraph.h"
+#include "FAIndexedHeap.h"
+#include "Algo/Reverse.h"
+
+void FFAHPAGraph::Reset()
+{
+	PortalClusters.Reset();
+	PortalPositions.Reset();
+	ClusterOffsets.Reset();
+	ClusterPortals.Reset();
+	EdgeOffsets.Reset();
+	EdgeTargets.Reset();
+	EdgeCosts.Reset();
+	bNeedsBuild = false;
+}
+
+void FFAHPAGraph::AddPortal(uint32 ClusterA, uint32 ClusterB, const FVector& Position)
+{
+	check(ClusterA != ClusterB);
+	PortalClusters.Add(ClusterA);
+	PortalClusters.Add(ClusterB);
+	PortalPositions.Add(Position);
+	bNeedsBuild = true;
+}
+
+void FFAHPAGraph::RemoveClusters(const TSet<uint32>& Clusters)
+{
+	int32 Kept = 0;
+	for (int32 Portal = 0; Portal < PortalPositions.Num(); Portal++)
+	{
+		const uint32 ClusterA = PortalClusters[MakeState(Portal, 0)];
+		const uint32 ClusterB = PortalClusters[MakeState(Portal, 1)];
+		if (Clusters.Contains(ClusterA) || Clusters.Contains(ClusterB)) continue;
+		PortalClusters[MakeState(Kept, 0)] = ClusterA;
+		PortalClusters[MakeState(Kept, 1)] = ClusterB;
+		PortalPositions[Kept++] = PortalPositions[Portal];
+	}
+	if (Kept == PortalPositions.Num()) return;
+	PortalClusters.SetNum(Kept * 2);
+	PortalPositions.SetNum(Kept);
+	bNeedsBuild = true;
+}
+
+void FFAHPAGraph::Build()
+{
+	bNeedsBuild = false;
+	const int32 NumPortals = PortalPositions.Num();
+	uint32 NumClusters = 0;
+	for (auto Cluster : PortalClusters)
+	{
+		NumClusters = FMath::Max(NumClusters, Cluster + 1);
+	}
+
+	//Bucket the portals by cluster.
+	ClusterOffsets.Reset();
+	ClusterOffsets.SetNumZeroed(NumClusters + 1);
+	for (auto Cluster : PortalClusters)
+	{
+		ClusterOffsets[Cluster + 1]++;
+	}
+	for (uint32 i = 0; i < NumClusters; i++)
+	{
+		ClusterOffsets[i + 1] += ClusterOffsets[i];
+	}
+	ClusterPortals.Reset();
+	ClusterPortals.SetNumUninitialized(PortalClusters.Num());
+	{
+		TArray<int32> Fill(ClusterOffsets.GetData(), NumClusters);
+		for (int32 State = 0; State < PortalClusters.Num(); State++)
+		{
+			ClusterPortals[Fill[PortalClusters[State]]++] = StatePortal(State);
+		}
+	}
+
+	//A state is in the cluster on the other side of the portal, it can leave by the other portals of that cluster.
+	EdgeOffsets.Reset();
+	EdgeOffsets.Reserve(NumPortals * 2 + 1);
+	EdgeTargets.Reset();
+	EdgeCosts.Reset();
+	EdgeOffsets.Add(0);
+	for (int32 State = 0; State < NumPortals * 2; State++)
+	{
+		const int32 Portal = StatePortal(State);
+		const uint32 Cluster = StateCluster(State);
+		for (int32 i = ClusterOffsets[Cluster]; i < ClusterOffsets[Cluster + 1]; i++)
+		{
+			const int32 Next = ClusterPortals[i];
+			if (Next == Portal) continue;
+			//Enter the next portal from this cluster, so the next state is on its other side.
+			const int32 NextState = MakeState(Next, PortalClusters[MakeState(Next, 0)] == Cluster ? 1 : 0);
+			EdgeTargets.Add(NextState);
+			EdgeCosts.Add(FVector::Distance(PortalPositions[Portal], PortalPositions[Next]));
+		}
+		EdgeOffsets.Add(EdgeTargets.Num());
+	}
+}
+
+bool FFAHPAGraph::FindPath(uint32 StartCluster, const FVector& StartLocation, uint32 EndCluster,
+                           const FVector& EndLocation, TArray<uint32>& OutClusters,
+                           float* OutCost) const
+{
+	check(!bNeedsBuild);
+	OutClusters.Reset();
+	if (StartCluster == EndCluster)
+	{
+		OutClusters.Add(StartCluster);
+		if (OutCost) *OutCost = FVector::Distance(StartLocation, EndLocation);
+		return true;
+	}
+	const int32 NumClusters = ClusterOffsets.Num() - 1;
+	if ((int32)StartCluster >= NumClusters || (int32)EndCluster >= NumClusters) return false;
+
+	const int32 NumStates = PortalClusters.Num();
+	//The goal is a virtual state after every portal state.
+	const int32 Goal = NumStates;
+	TArray<float> GCost;
+	GCost.Init(TNumericLimits<float>::Max(), NumStates + 1);
+	TArray<float> FCost;
+	FCost.SetNumUninitialized(NumStates + 1);
+	TArray<int32> Parent;
+	Parent.Init(INDEX_NONE, NumStates + 1);
+	TBitArray<> Closed(false, NumStates + 1);
+	auto Compare = [&FCost](int32 A, int32 B)
+	{
+		return FCost[A] != FCost[B] ? FCost[A] < FCost[B] : A < B;
+	};
+	TFAIndexedHeap<decltype(Compare)> OpenSet(Compare);
+
+	auto Relax = [&](int32 From, int32 State, float Cost)
+	{
+		if (Closed[State] || Cost >= GCost[State]) return;
+		GCost[State] = Cost;
+		Parent[State] = From;
+		FCost[State] = Cost + (State == Goal
+			                       ? 0
+			                       : FVector::Distance(PortalPositions[StatePortal(State)],
+			                                           EndLocation));
+		if (OpenSet.Contains(State)) OpenSet.Update(State);
+		else OpenSet.Push(State);
+	};
+
+	for (int32 i = ClusterOffsets[StartCluster]; i < ClusterOffsets[StartCluster + 1]; i++)
+	{
+		const int32 Portal = ClusterPortals[i];
+		const int32 State = MakeState(Portal, PortalClusters[MakeState(Portal, 0)] == StartCluster ? 1 : 0);
+		Relax(INDEX_NONE, State, FVector::Distance(StartLocation, PortalPositions[Portal]));
+	}
+
+	while (!OpenSet.IsEmpty())
+	{
+		const int32 Current = OpenSet.Pop();
+		Closed[Current] = true;
+		if (Current == Goal) break;
+		const FVector& Position = PortalPositions[StatePortal(Current)];
+		if (StateCluster(Current) == EndCluster)
+		{
+			Relax(Current, Goal, GCost[Current] + FVector::Distance(Position, EndLocation));
+		}
+		for (int32 i = EdgeOffsets[Current]; i < EdgeOffsets[Current + 1]; i++)
+		{
+			Relax(Current, EdgeTargets[i], GCost[Current] + EdgeCosts[i]);
+		}
+	}
+	if (!Closed[Goal]) return false;
+
+	for (int32 State = Parent[Goal]; State != INDEX_NONE; State = Parent[State])
+	{
+		OutClusters.Add(StateCluster(State));
+	}
+	OutClusters.Add(StartCluster);
+	Algo::Reverse(OutClusters);
+	if (OutCost) *OutCost = GCost[Goal];
+	return true;
+}
+
+SIZE_T FFAHPAGraph::GetAllocatedSize() const
+{
+	return PortalClusters.GetAllocatedSize() + PortalPositions.GetAllocatedSize() +
+		ClusterOffsets.GetAllocatedSize() + ClusterPortals.GetAllocatedSize() +
+		EdgeOffsets.GetAllocatedSize() + EdgeTargets.GetAllocatedSize() + EdgeCosts.
+		GetAllocatedSize();
+}
@@ -43,34 +43,43 @@ void UFALocationQuerySubsystem::OnWorldBeginPlay(UWorld& InWorld)
 FVector UFALocationQuerySubsystem::GetRandomReachableLocation(
 	FVector ColliderSize, FVector ColliderOffset, int MaxSamplings)
 {
-	TArray<FFaNodeData*> Datas;
+	TArray<uint32> Nodes;
 	UFAWorldSubsystem* System = GetWorld()->GetSubsystem<UFAWorldSubsystem>();
 	if (!bReady) return NullValue;
 	auto Bounds = System->GetRegisteredBound();
-	Bounds.RemoveAll([](AFABound* Bound) { return !Bound->GetNodesData(); });
+	Bounds.RemoveAll([](AFABound* Bound) { return !Bound || !Bound->GetNavData(); });
 	int Samplings = 0;
 	while (Samplings < MaxSamplings)
 	{
-		Datas.Empty();
+		Nodes.Reset();
 		auto Bound = *Algo::SelectRandomWeightedBy(Bounds, [](AFABound* a)
 		{
 			return a->GetHalfExtent().SquaredLength();
 		});
-		Bound->GetNodesData()->GetAllRows("", Datas);
-
-		Datas.RemoveAll([](FFaNodeData* Data)
-		{
-			return !Data->IsTraversable;
-		});
-		if (Datas.Num() == 0) return FVector::Zero();
-		Datas.Shrink();
-		auto result = *Algo::SelectRandomWeightedBy(Datas, [](FFaNodeData* a)
+		FVector Position, HalfExtent;
 		{
-			return a->HalfExtent.SquaredLength();
-		});
+			//Held while reading the nodes, an unload may unmap them meanwhile.
+			FReadScopeLock Lock(Bound->GetNodesDataLock());
+			const UFANavOctreeData* NavData = Bound->GetNavDataLocked();
+			if (!NavData)
+			{
+				Samplings++;
+				continue;
+			}
+			for (int32 i = 0; i < NavData->Num(); i++)
+			{
+				if (NavData->IsTraversable(i)) Nodes.Add(i);
+			}
+			if (Nodes.Num() == 0) return FVector::Zero();
+			const uint32 Result = *Algo::SelectRandomWeightedBy(Nodes, [NavData](uint32 a)
+			{
+				return NavData->GetHalfExtent(a).SquaredLength();
+			});
+			Position = NavData->GetPosition(Result);
+			HalfExtent = NavData->GetHalfExtent(Result);
+		}
 
-		FVector ReachableLocation = FMath::RandPointInBox(FBox(
-			result->Position - result->HalfExtent, result->Position + result->HalfExtent));
+		FVector ReachableLocation = FMath::RandPointInBox(FBox(Position - HalfExtent, Position + HalfExtent));
 		ReachableLocation -= Bound->GetBoundData()->GeneratePosition;
 		ReachableLocation += Bound->GetActorLocation();
 		TArray<AActor*> Actors;
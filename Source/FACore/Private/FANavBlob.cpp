@@ -0,0 +1,146 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FANavBlob.h"
+#include "FANodeSpatialIndex.h"
+#include "FAWorldSubsystem.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+//Sections are used in place, so the file is only valid on the byte order it is written in.
+static_assert(PLATFORM_LITTLE_ENDIAN, "Nav blobs are little endian.");
+
+namespace
+{
+	FCriticalSection MappedBlobsLock;
+	//Blobs mapped by any bound, by full filename.
+	TMap<FString, TWeakPtr<const FFANavBlob>> MappedBlobs;
+}
+
+uint32 FFANavBlob::GetElementSize(ESection Section)
+{
+	switch (Section)
+	{
+	case Positions:
+	case HalfExtents: return sizeof(FVector3f);
+	case Flags:
+	case Depths:
+	case IndexLevels: return sizeof(uint8);
+	case HPANodeIndices:
+	case NeighbourOffsets:
+	case Neighbours:
+	case IndexNodeIndices: return sizeof(uint32);
+	case Clearances: return sizeof(float);
+	case IndexCodes: return sizeof(uint64);
+	default: checkNoEntry();
+		return 1;
+	}
+}
+
+TSharedPtr<const FFANavBlob> FFANavBlob::Map(const FString& Filename)
+{
+	const FString Key = FPaths::ConvertRelativePathToFull(Filename);
+	FScopeLock Lock(&MappedBlobsLock);
+	if (TSharedPtr<const FFANavBlob> Shared = MappedBlobs.FindRef(Key).Pin()) return Shared;
+
+	TSharedPtr<FFANavBlob> Blob = MakeShareable(new FFANavBlob());
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!PlatformFile.FileExists(*Filename)) return nullptr;
+	Blob->Handle.Reset(PlatformFile.OpenMapped(*Filename));
+	if (Blob->Handle)
+	{
+		Blob->Region.Reset(Blob->Handle->MapRegion(0, Blob->Handle->GetFileSize()));
+	}
+	if (Blob->Region)
+	{
+		Blob->Data = Blob->Region->GetMappedPtr();
+		Blob->Size = Blob->Region->GetMappedSize();
+	}
+	else
+	{
+		Blob->Handle.Reset();
+		if (!FFileHelper::LoadFileToArray(Blob->Loaded, *Filename, FILEREAD_Silent)) return nullptr;
+		Blob->Data = Blob->Loaded.GetData();
+		Blob->Size = Blob->Loaded.Num();
+	}
+	if (!Blob->Validate(Filename)) return nullptr;
+
+	for (auto It = MappedBlobs.CreateIterator(); It; ++It)
+	{
+		if (!It->Value.IsValid()) It.RemoveCurrent();
+	}
+	MappedBlobs.Add(Key, Blob);
+	return Blob;
+}
+
+bool FFANavBlob::Write(const FString& Filename, FHeader Header,
+                       TConstArrayView<TConstArrayView<uint8>> Sections)
+{
+	check(Sections.Num() == NumSections);
+	Header.Magic = Magic;
+	Header.Version = Version;
+	TArray64<uint8> Bytes;
+	Bytes.SetNumZeroed(Align(sizeof(FHeader), Alignment));
+	for (uint32 i = 0; i < NumSections; i++)
+	{
+		Header.Sections[i].Offset = Bytes.Num();
+		Header.Sections[i].Num = Sections[i].Num() / GetElementSize(static_cast<ESection>(i));
+		Bytes.Append(Sections[i].GetData(), Sections[i].Num());
+		Bytes.SetNumZeroed(Align(Bytes.Num(), Alignment));
+	}
+	FMemory::Memcpy(Bytes.GetData(), &Header, sizeof(FHeader));
+	//Replace the file instead of writing over it, it may still be mapped by bounds loaded before.
+	const FString TempFilename = Filename + TEXT(".tmp");
+	return FFileHelper::SaveArrayToFile(Bytes, *TempFilename) && IFileManager::Get().Move(
+		*Filename, *TempFilename, true, true);
+}
+
+FFANavBlob::~FFANavBlob()
+{
+	//Unmap before closing the file.
+	Region.Reset();
+	Handle.Reset();
+}
+
+bool FFANavBlob::Validate(const FString& Filename) const
+{
+	if (Size < (int64)sizeof(FHeader) || GetHeader().Magic != Magic)
+	{
+		UE_LOG(LogFAWorldSubsystem, Error, TEXT("%s is not a nav blob."), *Filename);
+		return false;
+	}
+	const FHeader& Header = GetHeader();
+	if (Header.Version != Version)
+	{
+		UE_LOG(LogFAWorldSubsystem, Error, TEXT("%s has unsupported version %d, regenerate the nodes."),
+		       *Filename, Header.Version);
+		return false;
+	}
+	for (uint32 i = 0; i < NumSections; i++)
+	{
+		const FSection& Section = Header.Sections[i];
+		if (Section.Offset % Alignment || Section.Offset < sizeof(FHeader) || Section.Offset > (uint64)Size ||
+			Section.Num > ((uint64)Size - Section.Offset) / GetElementSize(static_cast<ESection>(i)))
+		{
+			UE_LOG(LogFAWorldSubsystem, Error, TEXT("%s is truncated or corrupted."), *Filename);
+			return false;
+		}
+	}
+	const uint64 NumNodes = Header.NumNodes;
+	const uint64 NumIndexEntries = Header.Sections[IndexCodes].Num;
+	bool bValidCounts = Header.Sections[NeighbourOffsets].Num == NumNodes + 1 &&
+		Header.Sections[IndexLevels].Num == NumIndexEntries && Header.Sections[IndexNodeIndices].Num ==
+		NumIndexEntries && Header.IndexNumLevels >= 0 && Header.IndexNumLevels <= FFANodeSpatialIndex::MaxLevels;
+	for (const ESection Section : {Positions, HalfExtents, Flags, Depths, HPANodeIndices, Clearances})
+	{
+		bValidCounts &= Header.Sections[Section].Num == NumNodes;
+	}
+	if (!bValidCounts || GetSection<uint32>(NeighbourOffsets).Last() != Header.Sections[Neighbours].Num)
+	{
+		UE_LOG(LogFAWorldSubsystem, Error, TEXT("%s is truncated or corrupted."), *Filename);
+		return false;
+	}
+	return true;
+}
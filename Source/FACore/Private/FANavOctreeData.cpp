@@ -0,0 +1,179 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FANavOctreeData.h"
+#include "FAWorldSubsystem.h"
+#include "Engine/DataTable.h"
+
+void UFANavOctreeData::BuildFromDataTable(const UDataTable* DataTable,
+                                          const FVector& InBoundPosition,
+                                          const FVector& InBoundHalfExtent)
+{
+	Blob.Reset();
+	BoundPosition = InBoundPosition;
+	BoundHalfExtent = InBoundHalfExtent;
+	const auto& RowMap = DataTable->GetRowMap();
+	const int32 NumNodes = RowMap.Num();
+	Positions.Reset(NumNodes);
+	HalfExtents.Reset(NumNodes);
+	Flags.Reset(NumNodes);
+	Depths.Reset(NumNodes);
+	HPANodeIndices.Reset(NumNodes);
+	Clearances.Reset(NumNodes);
+	NeighbourOffsets.Reset(NumNodes + 1);
+	Neighbours.Reset();
+
+	TMap<FName, uint32> Indices;
+	Indices.Reserve(NumNodes);
+	for (auto& Row : RowMap)
+	{
+		Indices.Add(Row.Key, Indices.Num());
+	}
+	NeighbourOffsets.Add(0);
+	for (auto& Row : RowMap)
+	{
+		const FFaNodeData* Node = reinterpret_cast<const FFaNodeData*>(Row.Value);
+		Positions.Add(FVector3f(Node->Position));
+		HalfExtents.Add(FVector3f(Node->HalfExtent));
+		Flags.Add(Node->IsTraversable ? Traversable : 0);
+		Depths.Add(static_cast<uint8>(Node->Depth));
+		HPANodeIndices.Add(Node->HPANodeIndex);
+		Clearances.Add(Node->Clearance);
+		for (auto& Neighbour : Node->Neighbour)
+		{
+			if (const uint32* Index = Indices.Find(Neighbour)) Neighbours.Add(*Index);
+		}
+		NeighbourOffsets.Add(Neighbours.Num());
+	}
+	SpatialIndex.Build(Positions, HalfExtents, BoundPosition, BoundHalfExtent);
+	BindOwnedArrays();
+}
+
+bool UFANavOctreeData::LoadFromBlob(const FString& Filename)
+{
+	TSharedPtr<const FFANavBlob> NewBlob = FFANavBlob::Map(Filename);
+	if (!NewBlob) return false;
+	Blob = NewBlob;
+	const FFANavBlob::FHeader& Header = Blob->GetHeader();
+	BoundPosition = Header.BoundPosition;
+	BoundHalfExtent = Header.BoundHalfExtent;
+	Positions.Empty();
+	HalfExtents.Empty();
+	Flags.Empty();
+	Depths.Empty();
+	HPANodeIndices.Empty();
+	Clearances.Empty();
+	NeighbourOffsets.Empty();
+	Neighbours.Empty();
+	PositionsView = Blob->GetSection<FVector3f>(FFANavBlob::Positions);
+	HalfExtentsView = Blob->GetSection<FVector3f>(FFANavBlob::HalfExtents);
+	FlagsView = Blob->GetSection<uint8>(FFANavBlob::Flags);
+	DepthsView = Blob->GetSection<uint8>(FFANavBlob::Depths);
+	HPANodeIndicesView = Blob->GetSection<uint32>(FFANavBlob::HPANodeIndices);
+	ClearancesView = Blob->GetSection<float>(FFANavBlob::Clearances);
+	NeighbourOffsetsView = Blob->GetSection<uint32>(FFANavBlob::NeighbourOffsets);
+	NeighboursView = Blob->GetSection<uint32>(FFANavBlob::Neighbours);
+	SpatialIndex.SetView({
+		Header.IndexOrigin, Header.IndexCellSize, Header.IndexNumLevels,
+		Blob->GetSection<uint64>(FFANavBlob::IndexCodes), Blob->GetSection<uint8>(FFANavBlob::IndexLevels),
+		Blob->GetSection<uint32>(FFANavBlob::IndexNodeIndices)
+	});
+	return true;
+}
+
+bool UFANavOctreeData::WriteBlob(const FString& Filename) const
+{
+	const FFANodeSpatialIndex::FView& Index = SpatialIndex.GetView();
+	FFANavBlob::FHeader Header;
+	FMemory::Memzero(Header);
+	Header.NumNodes = Num();
+	Header.IndexNumLevels = Index.NumLevels;
+	Header.BoundPosition = BoundPosition;
+	Header.BoundHalfExtent = BoundHalfExtent;
+	Header.IndexOrigin = Index.Origin;
+	Header.IndexCellSize = Index.CellSize;
+	auto Bytes = [](auto View)
+	{
+		return TConstArrayView<uint8>(reinterpret_cast<const uint8*>(View.GetData()), View.NumBytes());
+	};
+	const TConstArrayView<uint8> Sections[] = {
+		Bytes(PositionsView), Bytes(HalfExtentsView), Bytes(FlagsView), Bytes(DepthsView),
+		Bytes(HPANodeIndicesView), Bytes(ClearancesView), Bytes(NeighbourOffsetsView), Bytes(NeighboursView),
+		Bytes(Index.Codes), Bytes(Index.Levels), Bytes(Index.NodeIndices)
+	};
+	static_assert(UE_ARRAY_COUNT(Sections) == FFANavBlob::NumSections);
+	return FFANavBlob::Write(Filename, Header, Sections);
+}
+
+void UFANavOctreeData::ReleaseBlob()
+{
+	if (!Blob) return;
+	SpatialIndex.Reset();
+	BindOwnedArrays();
+	Blob.Reset();
+}
+
+void UFANavOctreeData::BindOwnedArrays()
+{
+	PositionsView = Positions;
+	HalfExtentsView = HalfExtents;
+	FlagsView = Flags;
+	DepthsView = Depths;
+	HPANodeIndicesView = HPANodeIndices;
+	ClearancesView = Clearances;
+	NeighbourOffsetsView = NeighbourOffsets;
+	NeighboursView = Neighbours;
+}
+
+void UFANavOctreeData::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+	int32 Version = Latest;
+	Ar << Version;
+	if (Ar.IsLoading() && Version != Latest)
+	{
+		UE_LOG(LogFAWorldSubsystem, Error, TEXT("%s has unsupported version %d, regenerate the nodes."),
+		       *GetName(), Version);
+		Ar.SetError();
+		return;
+	}
+	Positions.BulkSerialize(Ar);
+	HalfExtents.BulkSerialize(Ar);
+	Flags.BulkSerialize(Ar);
+	Depths.BulkSerialize(Ar);
+	HPANodeIndices.BulkSerialize(Ar);
+	Clearances.BulkSerialize(Ar);
+	NeighbourOffsets.BulkSerialize(Ar);
+	Neighbours.BulkSerialize(Ar);
+	Ar << SpatialIndex;
+	if (Ar.IsLoading())
+	{
+		Blob.Reset();
+		BindOwnedArrays();
+	}
+}
+
+void UFANavOctreeData::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(GetAllocatedSize());
+}
+
+FFaNodeData UFANavOctreeData::MakeNodeData(uint32 NodeIndex) const
+{
+	FFaNodeData NodeData;
+	NodeData.Position = GetPosition(NodeIndex);
+	NodeData.HalfExtent = GetHalfExtent(NodeIndex);
+	NodeData.Depth = GetDepth(NodeIndex);
+	NodeData.HPANodeIndex = GetHPANodeIndex(NodeIndex);
+	NodeData.IsTraversable = IsTraversable(NodeIndex);
+	NodeData.Clearance = GetClearance(NodeIndex);
+	return NodeData;
+}
+
+SIZE_T UFANavOctreeData::GetAllocatedSize() const
+{
+	return Positions.GetAllocatedSize() + HalfExtents.GetAllocatedSize() + Flags.GetAllocatedSize() +
+		Depths.GetAllocatedSize() + HPANodeIndices.GetAllocatedSize() + Clearances.
+		GetAllocatedSize() + NeighbourOffsets.GetAllocatedSize() + Neighbours.GetAllocatedSize() +
+		SpatialIndex.GetAllocatedSize() + (Blob ? Blob->GetAllocatedSize() : 0);
+}
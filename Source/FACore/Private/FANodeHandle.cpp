@@ -0,0 +1,16 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FANodeHandle.h"
+
+FFANodeHandle UFANodeHandleLibrary::MakeNodeHandle(int32 BoundIndex, int32 NodeIndex)
+{
+	return FFANodeHandle(BoundIndex < 0 ? FFANodeHandle::InvalidIndex : BoundIndex,
+	                     NodeIndex < 0 ? FFANodeHandle::InvalidIndex : NodeIndex);
+}
+
+void UFANodeHandleLibrary::BreakNodeHandle(const FFANodeHandle& Handle, int32& BoundIndex,
+                                           int32& NodeIndex)
+{
+	BoundIndex = Handle.BoundIndex == FFANodeHandle::InvalidIndex ? INDEX_NONE : Handle.BoundIndex;
+	NodeIndex = Handle.NodeIndex == FFANodeHandle::InvalidIndex ? INDEX_NONE : Handle.NodeIndex;
+}
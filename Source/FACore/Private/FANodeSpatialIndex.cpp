@@ -0,0 +1,262 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FANodeSpatialIndex.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/Unique.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	uint64 SpreadBits(uint32 Value)
+	{
+		uint64 x = Value & 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffff;
+		x = (x | x << 16) & 0x1f0000ff0000ff;
+		x = (x | x << 8) & 0x100f00f00f00f00f;
+		x = (x | x << 4) & 0x10c30c30c30c30c3;
+		x = (x | x << 2) & 0x1249249249249249;
+		return x;
+	}
+
+	uint32 CompactBits(uint64 Value)
+	{
+		uint64 x = Value & 0x1249249249249249;
+		x = (x | x >> 2) & 0x10c30c30c30c30c3;
+		x = (x | x >> 4) & 0x100f00f00f00f00f;
+		x = (x | x >> 8) & 0x1f0000ff0000ff;
+		x = (x | x >> 16) & 0x1f00000000ffff;
+		x = (x | x >> 32) & 0x1fffff;
+		return static_cast<uint32>(x);
+	}
+}
+
+uint64 FFANodeSpatialIndex::EncodeMorton(uint32 X, uint32 Y, uint32 Z)
+{
+	return SpreadBits(X) | SpreadBits(Y) << 1 | SpreadBits(Z) << 2;
+}
+
+FUintVector FFANodeSpatialIndex::DecodeMorton(uint64 Code)
+{
+	return FUintVector(CompactBits(Code), CompactBits(Code >> 1), CompactBits(Code >> 2));
+}
+
+void FFANodeSpatialIndex::Reset()
+{
+	Codes.Reset();
+	Levels.Reset();
+	NodeIndices.Reset();
+	View = FView();
+}
+
+void FFANodeSpatialIndex::SetView(const FView& InView)
+{
+	Reset();
+	View = InView;
+}
+
+void FFANodeSpatialIndex::BindOwnedArrays()
+{
+	View.Codes = Codes;
+	View.Levels = Levels;
+	View.NodeIndices = NodeIndices;
+}
+
+void FFANodeSpatialIndex::Build(TConstArrayView<FVector3f> Positions,
+                                TConstArrayView<FVector3f> HalfExtents,
+                                const FVector& BoundPosition, const FVector& BoundHalfExtent)
+{
+	Reset();
+	if (Positions.Num() == 0) return;
+
+	//Depth of a leaf from its size, the top level nodes being depth 1.
+	auto LevelOf = [&BoundHalfExtent](const FVector3f& HalfExtent)
+	{
+		return FMath::Clamp(
+			FMath::RoundToInt32(FMath::Log2(BoundHalfExtent.X / HalfExtent.X)), 0, MaxLevels);
+	};
+	for (auto& HalfExtent : HalfExtents)
+	{
+		View.NumLevels = FMath::Max(View.NumLevels, LevelOf(HalfExtent));
+	}
+	View.Origin = BoundPosition - BoundHalfExtent;
+	View.CellSize = BoundHalfExtent * 2 / static_cast<double>(1ull << View.NumLevels);
+
+	struct FEntry
+	{
+		uint64 Code;
+		uint8 Level;
+		uint32 NodeIndex;
+	};
+	TArray<FEntry> Entries;
+	Entries.Reserve(Positions.Num());
+	for (int32 i = 0; i < Positions.Num(); i++)
+	{
+		const int32 Level = LevelOf(HalfExtents[i]);
+		//First cell of the leaf: the cell of its centre aligned down to the size of the leaf.
+		const uint32 Mask = ~((1u << (View.NumLevels - Level)) - 1);
+		const FUintVector Cell = CellOf(FVector(Positions[i]));
+		Entries.Add({EncodeMorton(Cell.X & Mask, Cell.Y & Mask, Cell.Z & Mask), (uint8)Level, (uint32)i});
+	}
+	Entries.Sort([](const FEntry& A, const FEntry& B) { return A.Code < B.Code; });
+
+	Codes.Reserve(Entries.Num());
+	Levels.Reserve(Entries.Num());
+	NodeIndices.Reserve(Entries.Num());
+	for (auto& Entry : Entries)
+	{
+		Codes.Add(Entry.Code);
+		Levels.Add(Entry.Level);
+		NodeIndices.Add(Entry.NodeIndex);
+	}
+	BindOwnedArrays();
+}
+
+FUintVector FFANodeSpatialIndex::CellOf(const FVector& Point) const
+{
+	const int64 Max = (1ll << View.NumLevels) - 1;
+	const FVector Cell = (Point - View.Origin) / View.CellSize;
+	return FUintVector(FMath::Clamp<int64>(FMath::FloorToInt64(Cell.X), 0, Max),
+	                   FMath::Clamp<int64>(FMath::FloorToInt64(Cell.Y), 0, Max),
+	                   FMath::Clamp<int64>(FMath::FloorToInt64(Cell.Z), 0, Max));
+}
+
+uint32 FFANodeSpatialIndex::FindNode(const FVector& Point) const
+{
+	if (View.Codes.Num() == 0) return InvalidIndex;
+	const FUintVector Cell = CellOf(Point);
+	const uint64 Code = EncodeMorton(Cell.X, Cell.Y, Cell.Z);
+	//The last leaf starting at or before the cell.
+	const int32 Index = Algo::UpperBound(View.Codes, Code) - 1;
+	if (Index < 0) return InvalidIndex;
+	//A leaf covers 8^(levels below it) cells from its first one. Cells not covered are occupied.
+	const uint64 Span = 1ull << 3 * (View.NumLevels - View.Levels[Index]);
+	return Code - View.Codes[Index] < Span ? View.NodeIndices[Index] : InvalidIndex;
+}
+
+void FFANodeSpatialIndex::BuildNeighbours(TArray<uint32>& OutOffsets, TArray<uint32>& OutNeighbours) const
+{
+	const int32 NumNodes = View.Codes.Num();
+	//Leaves in chunks of entries, each chunk found by one task into its own arrays.
+	constexpr int32 ChunkSize = 1024;
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumNodes, ChunkSize);
+	TArray<TArray<uint32>> ChunkCounts, ChunkNeighbours;
+	ChunkCounts.SetNum(NumChunks);
+	ChunkNeighbours.SetNum(NumChunks);
+	ParallelFor(NumChunks, [this, NumNodes, &ChunkCounts, &ChunkNeighbours](int32 Chunk)
+	{
+		TArray<uint32> Touching;
+		for (int32 Entry = Chunk * ChunkSize; Entry < FMath::Min(NumNodes, (Chunk + 1) * ChunkSize); Entry++)
+		{
+			const int32 Level = View.Levels[Entry];
+			const FUintVector First = DecodeMorton(View.Codes[Entry]);
+			const int32 Shift = View.NumLevels - Level;
+			const FIntVector Cell(First.X >> Shift, First.Y >> Shift, First.Z >> Shift);
+			const int32 NumCells = 1 << Level;
+			Touching.Reset();
+			for (int32 x = -1; x <= 1; x++)
+				for (int32 y = -1; y <= 1; y++)
+					for (int32 z = -1; z <= 1; z++)
+					{
+						const FIntVector Direction(x, y, z);
+						const FIntVector Next = Cell + Direction;
+						if (Direction == FIntVector::ZeroValue || Next.GetMin() < 0 || Next.GetMax() >= NumCells)
+							continue;
+						AddTouchingLeaves(Level, Next, Direction, Touching);
+					}
+			//A larger leaf is found from every cell of it next to the leaf.
+			Touching.Sort();
+			Touching.SetNum(Algo::Unique(Touching));
+			ChunkCounts[Chunk].Add(Touching.Num());
+			ChunkNeighbours[Chunk].Append(Touching);
+		}
+	});
+
+	//Concatenate the chunks by node index.
+	TArray<uint32> EntryOffsets;
+	EntryOffsets.Reserve(NumNodes + 1);
+	EntryOffsets.Add(0);
+	TArray<uint32> EntryNeighbours;
+	for (int32 Chunk = 0; Chunk < NumChunks; Chunk++)
+	{
+		for (const uint32 Count : ChunkCounts[Chunk])
+		{
+			EntryOffsets.Add(EntryOffsets.Last() + Count);
+		}
+		EntryNeighbours.Append(ChunkNeighbours[Chunk]);
+	}
+	TArray<int32> NodeEntries;
+	NodeEntries.SetNumUninitialized(NumNodes);
+	for (int32 Entry = 0; Entry < NumNodes; Entry++)
+	{
+		NodeEntries[View.NodeIndices[Entry]] = Entry;
+	}
+	OutOffsets.Reset(NumNodes + 1);
+	OutOffsets.Add(0);
+	OutNeighbours.Reset(EntryNeighbours.Num());
+	for (int32 Node = 0; Node < NumNodes; Node++)
+	{
+		const int32 Entry = NodeEntries[Node];
+		OutNeighbours.Append(EntryNeighbours.GetData() + EntryOffsets[Entry],
+		                     EntryOffsets[Entry + 1] - EntryOffsets[Entry]);
+		OutOffsets.Add(OutNeighbours.Num());
+	}
+}
+
+void FFANodeSpatialIndex::FindNodesInBox(const FBox& Box, TArray<uint32>& OutNodes) const
+{
+	if (View.Codes.Num() == 0) return;
+	AddLeavesInBox(0, FIntVector::ZeroValue, Box, OutNodes);
+}
+
+uint32 FFANodeSpatialIndex::FindCellLeaf(int32 Level, const FIntVector& Cell, bool& bOutSubdivided) const
+{
+	bOutSubdivided = false;
+	const int32 Shift = View.NumLevels - Level;
+	const uint64 Code = EncodeMorton(Cell.X << Shift, Cell.Y << Shift, Cell.Z << Shift);
+	//A leaf as large as the cell or larger covers it.
+	const int32 Covering = Algo::UpperBound(View.Codes, Code) - 1;
+	if (Covering >= 0 && View.Levels[Covering] <= Level &&
+		Code - View.Codes[Covering] < 1ull << 3 * (View.NumLevels - View.Levels[Covering]))
+		return View.NodeIndices[Covering];
+	//Otherwise the cell is subdivided if smaller leaves start in it.
+	const int32 Inside = Algo::LowerBound(View.Codes, Code);
+	bOutSubdivided = Level < View.NumLevels && Inside < View.Codes.Num() &&
+		View.Codes[Inside] - Code < 1ull << 3 * Shift;
+	return InvalidIndex;
+}
+
+void FFANodeSpatialIndex::AddTouchingLeaves(int32 Level, const FIntVector& Cell, const FIntVector& Direction,
+                                            TArray<uint32>& OutNodes) const
+{
+	bool bSubdivided;
+	const uint32 Leaf = FindCellLeaf(Level, Cell, bSubdivided);
+	if (Leaf != InvalidIndex) OutNodes.Add(Leaf);
+	if (!bSubdivided) return;
+	for (int32 i = 0; i < 8; i++)
+	{
+		const FIntVector Child(i & 1, i >> 1 & 1, i >> 2 & 1);
+		//Only children on the side facing the leaf touch it.
+		bool bTouching = true;
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			bTouching &= Direction[Axis] == 0 || Child[Axis] == (Direction[Axis] > 0 ? 0 : 1);
+		}
+		if (bTouching) AddTouchingLeaves(Level + 1, Cell * 2 + Child, Direction, OutNodes);
+	}
+}
+
+void FFANodeSpatialIndex::AddLeavesInBox(int32 Level, const FIntVector& Cell, const FBox& Box,
+                                         TArray<uint32>& OutNodes) const
+{
+	const FVector CellSize = View.CellSize * static_cast<double>(1ull << (View.NumLevels - Level));
+	const FVector Min = View.Origin + FVector(Cell) * CellSize;
+	if (!Box.Intersect(FBox(Min, Min + CellSize))) return;
+	bool bSubdivided;
+	const uint32 Leaf = FindCellLeaf(Level, Cell, bSubdivided);
+	if (Leaf != InvalidIndex) OutNodes.Add(Leaf);
+	if (!bSubdivided) return;
+	for (int32 i = 0; i < 8; i++)
+	{
+		AddLeavesInBox(Level + 1, Cell * 2 + FIntVector(i & 1, i >> 1 & 1, i >> 2 & 1), Box, OutNodes);
+	}
+}
@@ -0,0 +1,231 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FAOccupancyGrid.h"
+#include "FANodeSpatialIndex.h"
+#include "Async/ParallelFor.h"
+
+template <typename FClassify>
+void FFAOccupancyGrid::Rasterize(int32 Level, uint64 Code, const FUintVector& Cell, const FClassify& Classify)
+{
+	const FVector CellSize = Size / static_cast<double>(1ll << Level);
+	const FVector Centre = Origin + (FVector(Cell.X, Cell.Y, Cell.Z) + 0.5) * CellSize;
+	const FVector HalfExtent = (CellSize / 2 - TouchTolerance).ComponentMax(FVector::ZeroVector);
+	switch (Classify(Centre, HalfExtent, Level == GetNumLevels()))
+	{
+	case EOverlap::Outside: return;
+	case EOverlap::Inside: SetRange(Level, Code);
+		return;
+	default: break;
+	}
+	for (uint32 i = 0; i < 8; i++)
+	{
+		Rasterize(Level + 1, Code << 3 | i,
+		          FUintVector(Cell.X * 2 + (i & 1), Cell.Y * 2 + (i >> 1 & 1), Cell.Z * 2 + (i >> 2 & 1)),
+		          Classify);
+	}
+}
+
+bool FFAOccupancyGrid::Build(const FFAOccupancyShapes& Shapes, const FVector& BoundPosition,
+                             const FVector& BoundHalfExtent, int32 NumLevels)
+{
+	Reset();
+	if (NumLevels < 0 || NumLevels > MaxLevels) return false;
+	Origin = BoundPosition - BoundHalfExtent;
+	Size = BoundHalfExtent * 2;
+	Levels.SetNum(NumLevels + 1);
+	for (int32 Level = 0; Level <= NumLevels; Level++)
+	{
+		Levels[Level].SetNumZeroed(FMath::Max<int64>(1, (1ll << 3 * Level) / 64));
+	}
+	FallbackBoxes = Shapes.FallbackBoxes;
+	const FBox GridBox(Origin, Origin + Size);
+
+	ParallelFor(Shapes.Triangles.Num() / 3, [this, &Shapes, &GridBox](int32 i)
+	{
+		const FVector& A = Shapes.Triangles[3 * i];
+		const FVector& B = Shapes.Triangles[3 * i + 1];
+		const FVector& C = Shapes.Triangles[3 * i + 2];
+		if (!GridBox.Intersect(FBox(&Shapes.Triangles[3 * i], 3))) return;
+		Rasterize(0, 0, FUintVector::ZeroValue, [&A, &B, &C](const FVector& Centre, const FVector& HalfExtent,
+		                                                     bool bFinest)
+		{
+			if (!TriangleBoxOverlap(Centre, HalfExtent, A, B, C)) return EOverlap::Outside;
+			return bFinest ? EOverlap::Inside : EOverlap::Intersecting;
+		});
+	});
+
+	ParallelFor(Shapes.Convexes.Num(), [this, &Shapes, &GridBox](int32 i)
+	{
+		const FFAOccupancyShapes::FConvex& Convex = Shapes.Convexes[i];
+		if (Convex.Vertices.Num() == 0 || !GridBox.Intersect(FBox(Convex.Vertices))) return;
+		FVector Centroid = FVector::ZeroVector;
+		for (const FVector& Vertex : Convex.Vertices)
+		{
+			Centroid += Vertex;
+		}
+		Centroid /= Convex.Vertices.Num();
+		//Face planes facing out of the convex.
+		TArray<FPlane> Planes;
+		Planes.Reserve(Convex.Indices.Num() / 3);
+		for (int32 Face = 0; Face + 2 < Convex.Indices.Num(); Face += 3)
+		{
+			const FVector& A = Convex.Vertices[Convex.Indices[Face]];
+			FVector Normal = ((Convex.Vertices[Convex.Indices[Face + 1]] - A) ^
+				(Convex.Vertices[Convex.Indices[Face + 2]] - A)).GetSafeNormal();
+			if (Normal.IsZero()) continue;
+			if ((Centroid - A | Normal) > 0) Normal = -Normal;
+			Planes.Emplace(A, Normal);
+		}
+		Rasterize(0, 0, FUintVector::ZeroValue, [&Convex, &Planes](const FVector& Centre, const FVector& HalfExtent,
+		                                                           bool bFinest)
+		{
+			bool bInside = true;
+			for (const FPlane& Plane : Planes)
+			{
+				const double Distance = Plane.PlaneDot(Centre);
+				const double Radius = FVector(Plane).GetAbs() | HalfExtent;
+				if (Distance > Radius) return EOverlap::Outside;
+				if (Distance + Radius > 0) bInside = false;
+			}
+			if (bInside) return EOverlap::Inside;
+			if (!bFinest) return EOverlap::Intersecting;
+			//Without crossing a face, the cell is either inside or outside the convex.
+			for (int32 Face = 0; Face + 2 < Convex.Indices.Num(); Face += 3)
+			{
+				if (TriangleBoxOverlap(Centre, HalfExtent, Convex.Vertices[Convex.Indices[Face]],
+				                       Convex.Vertices[Convex.Indices[Face + 1]],
+				                       Convex.Vertices[Convex.Indices[Face + 2]]))
+					return EOverlap::Inside;
+			}
+			for (const FPlane& Plane : Planes)
+			{
+				if (Plane.PlaneDot(Centre) > 0) return EOverlap::Outside;
+			}
+			return EOverlap::Inside;
+		});
+	});
+
+	ParallelFor(Shapes.Spheres.Num(), [this, &Shapes](int32 i)
+	{
+		const FSphere& Sphere = Shapes.Spheres[i];
+		const double RadiusSquared = FMath::Square(Sphere.W);
+		Rasterize(0, 0, FUintVector::ZeroValue, [&Sphere, RadiusSquared](const FVector& Centre,
+		                                                                 const FVector& HalfExtent, bool bFinest)
+		{
+			if (FMath::ComputeSquaredDistanceFromBoxToPoint(Centre - HalfExtent, Centre + HalfExtent,
+			                                                Sphere.Center) > RadiusSquared)
+				return EOverlap::Outside;
+			//The farthest corner is in the sphere.
+			if (((Centre - Sphere.Center).GetAbs() + HalfExtent).SizeSquared() <= RadiusSquared)
+				return EOverlap::Inside;
+			return bFinest ? EOverlap::Inside : EOverlap::Intersecting;
+		});
+	});
+
+	BuildCoarseLevels();
+	return true;
+}
+
+void FFAOccupancyGrid::Reset()
+{
+	Levels.Empty();
+	FallbackBoxes.Empty();
+}
+
+bool FFAOccupancyGrid::IsOccupied(int32 Level, const FVector& Point) const
+{
+	check(Level >= 0 && Level <= GetNumLevels());
+	const int64 Max = (1ll << Level) - 1;
+	const FVector Cell = (Point - Origin) / Size * static_cast<double>(1ll << Level);
+	const uint64 Code = FFANodeSpatialIndex::EncodeMorton(
+		FMath::Clamp<int64>(FMath::FloorToInt64(Cell.X), 0, Max),
+		FMath::Clamp<int64>(FMath::FloorToInt64(Cell.Y), 0, Max),
+		FMath::Clamp<int64>(FMath::FloorToInt64(Cell.Z), 0, Max));
+	return Levels[Level][Code / 64] >> (Code % 64) & 1;
+}
+
+bool FFAOccupancyGrid::NeedsQuery(const FBox& Box) const
+{
+	for (const FBox& Fallback : FallbackBoxes)
+	{
+		if (Fallback.Intersect(Box)) return true;
+	}
+	return false;
+}
+
+SIZE_T FFAOccupancyGrid::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = Levels.GetAllocatedSize() + FallbackBoxes.GetAllocatedSize();
+	for (auto& Bits : Levels)
+	{
+		AllocatedSize += Bits.GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
+
+bool FFAOccupancyGrid::TriangleBoxOverlap(const FVector& Centre, const FVector& HalfExtent,
+                                          const FVector& A, const FVector& B, const FVector& C)
+{
+	const FVector V[3] = {A - Centre, B - Centre, C - Centre};
+	//Axes of the box.
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		if (FMath::Min3(V[0][Axis], V[1][Axis], V[2][Axis]) > HalfExtent[Axis] ||
+			FMath::Max3(V[0][Axis], V[1][Axis], V[2][Axis]) < -HalfExtent[Axis])
+			return false;
+	}
+	//Cross products of the edges and the axes of the box.
+	const FVector Edges[3] = {V[1] - V[0], V[2] - V[1], V[0] - V[2]};
+	for (const FVector& Edge : Edges)
+	{
+		for (const FVector& BoxAxis : {FVector::XAxisVector, FVector::YAxisVector, FVector::ZAxisVector})
+		{
+			const FVector Axis = BoxAxis ^ Edge;
+			const double P0 = V[0] | Axis;
+			const double P1 = V[1] | Axis;
+			const double P2 = V[2] | Axis;
+			const double Radius = HalfExtent | Axis.GetAbs();
+			if (FMath::Min3(P0, P1, P2) > Radius || FMath::Max3(P0, P1, P2) < -Radius) return false;
+		}
+	}
+	//Normal of the triangle.
+	const FVector Normal = Edges[0] ^ Edges[1];
+	return FMath::Abs(Normal | V[0]) <= (HalfExtent | Normal.GetAbs());
+}
+
+void FFAOccupancyGrid::SetRange(int32 Level, uint64 Code)
+{
+	TArray<uint64>& Bits = Levels.Last();
+	const int32 Shift = 3 * (GetNumLevels() - Level);
+	const uint64 Begin = Code << Shift;
+	const uint64 End = (Code + 1) << Shift;
+	for (uint64 Word = Begin / 64; Word <= (End - 1) / 64; Word++)
+	{
+		const uint64 Low = FMath::Max(Begin, Word * 64) - Word * 64;
+		const uint64 High = FMath::Min(End, Word * 64 + 64) - Word * 64;
+		const uint64 Mask = High - Low == 64 ? MAX_uint64 : ((1ull << (High - Low)) - 1) << Low;
+		//Shapes are rasterized in parallel.
+		FPlatformAtomics::InterlockedOr(reinterpret_cast<volatile int64*>(&Bits[Word]), static_cast<int64>(Mask));
+	}
+}
+
+void FFAOccupancyGrid::BuildCoarseLevels()
+{
+	for (int32 Level = GetNumLevels() - 1; Level >= 0; Level--)
+	{
+		const TArray<uint64>& Fine = Levels[Level + 1];
+		TArray<uint64>& Coarse = Levels[Level];
+		const int64 NumBits = 1ll << 3 * Level;
+		//A cell is occupied if any of its children, the 8 bits of a byte of the finer level, is.
+		ParallelFor(Coarse.Num(), [&Fine, &Coarse, NumBits](int32 Word)
+		{
+			uint64 Bits = 0;
+			for (int64 Bit = 0; Bit < 64 && Word * 64 + Bit < NumBits; Bit++)
+			{
+				const int64 Child = Word * 64 + Bit;
+				if (Fine[Child / 8] >> (Child % 8 * 8) & 0xFF) Bits |= 1ull << Bit;
+			}
+			Coarse[Word] = Bits;
+		});
+	}
+}
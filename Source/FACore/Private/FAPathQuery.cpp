@@ -0,0 +1,387 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FAPathQuery.h"
+#include "FABound.h"
+#include "FABoundData.h"
+#include "FANeighbourData.h"
+#include "FAPathfindingSettings.h"
+#include "Algo/Reverse.h"
+#include "Kismet/KismetSystemLibrary.h"
+
+FFAPathQuery::FFAPathQuery(FFAFinePath InFinePath, const FFAPathNodeData& InEndNode, UWorld* InWorld,
+                           const UFAPathfindingSettings* InSettings, const FVector& InColliderSize,
+                           const FVector& InColliderOffset)
+	: FinePath(MoveTemp(InFinePath)),
+	  EndNode(InEndNode),
+	  World(InWorld),
+	  Settings(InSettings),
+	  ColliderSize(InColliderSize),
+	  ColliderOffset(InColliderOffset)
+{
+}
+
+FFAPathQuery::~FFAPathQuery()
+{
+	ReleaseSearch();
+}
+
+EFAPathQueryStatus FFAPathQuery::Step(int32 MaxExpansions, double MaxSeconds)
+{
+	if (IsDone()) return Status;
+	if (Token->IsCancelled())
+	{
+		OnCancelled();
+		return Status;
+	}
+	const bool bFirstStep = !bStarted;
+	if (bFirstStep)
+	{
+		Start();
+		if (IsDone()) return Status;
+	}
+
+	AFABound* Bound0 = StartBound.Get();
+	AFABound* Bound1 = EndBound.Get();
+	//Hold the bounds so they wait for this step if destroyed meanwhile.
+	if (!Bound0 || !Bound1 || !Bound0->BeginPathQueryStep())
+	{
+		Fail(false);
+		return Status;
+	}
+	ON_SCOPE_EXIT { Bound0->EndPathQueryStep(); };
+	if (bIsDifferentBound && !Bound1->BeginPathQueryStep())
+	{
+		Fail(false);
+		return Status;
+	}
+	ON_SCOPE_EXIT
+	{
+		if (bIsDifferentBound) Bound1->EndPathQueryStep();
+	};
+	//Resolved once for every query after the nodes are loaded or the bound moves, not on every expansion.
+	Bound0->UpdateSearchNodes();
+	if (bIsDifferentBound) Bound1->UpdateSearchNodes();
+	//Other queries read the bounds meanwhile. Locked in address order, as a reader waiting behind a writer
+	//while holding the other bound's lock could deadlock with a query locking the other way round.
+	AFABound* LockOrder[2] = {Bound0, Bound1};
+	if (reinterpret_cast<UPTRINT>(Bound1) < reinterpret_cast<UPTRINT>(Bound0)) Swap(LockOrder[0], LockOrder[1]);
+	LockOrder[0]->GetNodesDataLock().ReadLock();
+	if (bIsDifferentBound) LockOrder[1]->GetNodesDataLock().ReadLock();
+	ON_SCOPE_EXIT
+	{
+		if (bIsDifferentBound) LockOrder[1]->GetNodesDataLock().ReadUnlock();
+		LockOrder[0]->GetNodesDataLock().ReadUnlock();
+	};
+	if (bFirstStep)
+	{
+		StartNavData = Bound0->GetNavDataLocked();
+		EndNavData = Bound1->GetNavDataLocked();
+		StartBoundLocation = Bound0->GetSearchNodesLocationLocked();
+		EndBoundLocation = Bound1->GetSearchNodesLocationLocked();
+	}
+	//A bound moved meanwhile would mix the old and new node locations in the records.
+	if (!Bound0->GetNavDataLocked() || Bound0->GetNavDataLocked() != StartNavData || !Bound1->GetNavDataLocked() ||
+		Bound1->GetNavDataLocked() != EndNavData || !Bound0->HasSearchNodesLocked() ||
+		!Bound1->HasSearchNodesLocked() || Bound0->GetSearchNodesLocationLocked() != StartBoundLocation ||
+		Bound1->GetSearchNodesLocationLocked() != EndBoundLocation)
+	{
+		Fail(false);
+		return Status;
+	}
+	NeighbourData = bIsDifferentBound ? Bound0->FindNeighboursData(Bound0, Bound1) : nullptr;
+	if (bIsDifferentBound && !NeighbourData)
+	{
+		Fail();
+		return Status;
+	}
+
+	const double EndTime = MaxSeconds > 0 ? FPlatformTime::Seconds() + MaxSeconds : 0;
+	const FFANodeHandle EndNodeHandle = FinePath.HPAPath.EndNode.Handle;
+	for (int32 Expanded = 0; Expanded < MaxExpansions && !Scratch->OpenSet.IsEmpty(); Expanded++)
+	{
+		if (Token->IsCancelled())
+		{
+			OnCancelled();
+			return Status;
+		}
+		const int32 CurrentNode = Scratch->OpenSet.Pop();
+		Scratch->ClosedSet[CurrentNode] = true;
+		NumExpanded++;
+		const FFAPathSearchRecord& Current = Scratch->Records[CurrentNode];
+		//The end node, or any node of the end HPA node if the path goes on.
+		if (Current.Handle == EndNodeHandle ||
+			(Current.Bound->GetNodeGlobalHPANode(Current.Handle.NodeIndex) == EndHPANode && !bShouldFindEndNode))
+		{
+			Finish(CurrentNode);
+			break;
+		}
+		Expand(CurrentNode);
+		if (EndTime > 0 && FPlatformTime::Seconds() >= EndTime) break;
+	}
+	if (!IsDone() && Scratch->OpenSet.IsEmpty()) Fail();
+	return Status;
+}
+
+TSharedRef<FFAPathQuery> FFAPathQuery::MakeFinished(FFAFinePath FinePath)
+{
+	const bool bIsSuccess = FinePath.bIsSuccess;
+	TSharedRef<FFAPathQuery> Query = MakeShared<FFAPathQuery>(MoveTemp(FinePath), FFAPathNodeData(), nullptr, nullptr,
+	                                                          FVector::ZeroVector, FVector::ZeroVector);
+	Query->bStarted = true;
+	Query->Status = bIsSuccess ? EFAPathQueryStatus::Succeeded : EFAPathQueryStatus::Failed;
+	return Query;
+}
+
+bool FFAPathQuery::GetKey(uint32 InColliderSizeClass, FFAPathQueryKey& OutKey) const
+{
+	uint32 SegmentStartHPANode, SegmentEndHPANode;
+	int32 EndHPANodeIndex;
+	bool bSegmentEndsAtEndNode;
+	if (bStarted || !FindSegment(SegmentStartHPANode, SegmentEndHPANode, EndHPANodeIndex, bSegmentEndsAtEndNode))
+		return false;
+	OutKey.StartNode = FinePath.LocalStartNode.Handle;
+	OutKey.EndHPANode = SegmentEndHPANode;
+	//Every segment, as the heuristic of an earlier one aims at it too.
+	OutKey.EndNode = FinePath.HPAPath.EndNode.Handle;
+	OutKey.ColliderSizeClass = InColliderSizeClass;
+	return true;
+}
+
+void FFAPathQuery::ShareResult(const FFAPathQuery& Other)
+{
+	check(Other.IsDone());
+	bStarted = true;
+	Status = Other.Status;
+	FinePath.bBoundLoaded = Other.FinePath.bBoundLoaded;
+	ReleaseSearch();
+	if (Status != EFAPathQueryStatus::Succeeded) return;
+	FinePath.Nodes = Other.FinePath.Nodes;
+	PathLocations = Other.PathLocations;
+	//Only the ends differ, the path starts from the location of this query in the same node.
+	PathLocations[0] = FinePath.LocalStartLocation;
+	bShouldFindEndNode = Other.bShouldFindEndNode;
+	BuildControlPoints();
+}
+
+bool FFAPathQuery::FindSegment(uint32& OutStartHPANode, uint32& OutEndHPANode, int32& OutEndHPANodeIndex,
+                               bool& bOutShouldFindEndNode) const
+{
+	const TArray<uint32>& HPANodes = FinePath.HPAPath.HPANodes;
+	if (!HPANodes.IsValidIndex(FinePath.CurrentHPANodeIndex)) return false;
+	const bool bIsLastHPANode = FinePath.CurrentHPANodeIndex + 1 == HPANodes.Num();
+	OutEndHPANodeIndex = bIsLastHPANode ? FinePath.CurrentHPANodeIndex : FinePath.CurrentHPANodeIndex + 1;
+	OutStartHPANode = HPANodes[FinePath.CurrentHPANodeIndex];
+	OutEndHPANode = HPANodes[OutEndHPANodeIndex];
+	bOutShouldFindEndNode = EndNode.NodeData.HPANodeIndex == OutEndHPANode;
+	//First hpa node should be where start node in. If end node is not in the last hpa node, there is nowhere to go.
+	return FinePath.LocalStartNode.NodeData.HPANodeIndex == OutStartHPANode && (bOutShouldFindEndNode || !
+		bIsLastHPANode);
+}
+
+void FFAPathQuery::Start()
+{
+	bStarted = true;
+	int32 EndHPANodeIndex;
+	if (!FindSegment(StartHPANode, EndHPANode, EndHPANodeIndex, bShouldFindEndNode))
+	{
+		Fail();
+		return;
+	}
+	AFABound* Bound0 = FinePath.LocalStartNode.NodeBound;
+	AFABound* Bound1 = FinePath.HPAPath.HPAAssociateBounds[EndHPANodeIndex];
+	if (!Bound0 || !Bound1)
+	{
+		Fail(false);
+		return;
+	}
+	StartBound = Bound0;
+	EndBound = Bound1;
+	bIsDifferentBound = Bound0 != Bound1;
+	Bound0->AddPathQuery(Token);
+	if (bIsDifferentBound) Bound1->AddPathQuery(Token);
+
+	Subsystem = World.IsValid() ? World->GetSubsystem<UFAWorldSubsystem>() : nullptr;
+	bUseEdgeClearanceCache = Settings->bUseEdgeClearanceCache && Subsystem;
+	ColliderSizeClass = bUseEdgeClearanceCache ? Subsystem->GetColliderSizeClass(ColliderSize, ColliderOffset) : 0;
+	bUseEdgeClearanceCache &= ColliderSizeClass != INDEX_NONE;
+
+	Scratch = FFAPathSearchScratch::Acquire();
+	Scratch->Records.Add({
+		.Bound = Bound0, .Handle = FinePath.LocalStartNode.Handle, .StartLocation = FinePath.LocalStartLocation
+	});
+	Scratch->PathLink.Add(INDEX_NONE);
+	Scratch->ClosedSet.Add(false);
+	Scratch->Handles.Add(FinePath.LocalStartNode.Handle, 0);
+	Scratch->OpenSet.Push(0);
+}
+
+void FFAPathQuery::Expand(int32 CurrentNode)
+{
+	AFABound* Bound = Scratch->Records[CurrentNode].Bound;
+	const uint32 CurrentNodeIndex = Scratch->Records[CurrentNode].Handle.NodeIndex;
+	for (const uint32 NeighbourIndex : Bound->GetNavDataLocked()->GetNeighbours(CurrentNodeIndex))
+	{
+		Relax(CurrentNode, Bound, NeighbourIndex, false);
+	}
+
+	if (!bIsDifferentBound) return;
+
+	const bool bEqualBound0 = Bound == NeighbourData->Bound[0];
+	const FNeighbourBoundConnected* NeighbourConnectionData = bEqualBound0
+		                                                          ? NeighbourData->Connection0.Find(CurrentNodeIndex)
+		                                                          : NeighbourData->Connection1.Find(CurrentNodeIndex);
+	if (!NeighbourConnectionData) return;
+	Bound = bEqualBound0 ? NeighbourData->Bound[1] : NeighbourData->Bound[0];
+	for (const uint32 ConnectedNeighbour : NeighbourConnectionData->Connected)
+	{
+		Relax(CurrentNode, Bound, ConnectedNeighbour, true);
+	}
+}
+
+void FFAPathQuery::Relax(int32 CurrentNode, AFABound* NeighbourBound, uint32 NeighbourIndex,
+                         bool bHeuristicFromControlPoint)
+{
+	const uint32 NeighbourHPANode = NeighbourBound->GetNodeGlobalHPANode(NeighbourIndex);
+	if (NeighbourHPANode != INDEX_NONE && NeighbourHPANode != StartHPANode && NeighbourHPANode != EndHPANode) return;
+	if (!NeighbourBound->GetNavDataLocked()->IsTraversable(NeighbourIndex) ||
+		NeighbourBound->GetObstacleOverlay().IsBlocked(NeighbourIndex))
+		return;
+	const FFANodeHandle NeighbourHandle = NeighbourBound->MakeNodeHandle(NeighbourIndex);
+	TArray<FFAPathSearchRecord>& Records = Scratch->Records;
+	const int32* Found = Scratch->Handles.Find(NeighbourHandle);
+	if (Found && Scratch->ClosedSet[*Found]) return;
+
+	AFABound* CurrentBound = Records[CurrentNode].Bound;
+	const FFANodeHandle CurrentHandle = Records[CurrentNode].Handle;
+	const UFANavOctreeData* CurrentNavData = CurrentBound->GetNavDataLocked();
+	const FVector& CurrentPosition = CurrentBound->GetNodeLocation(CurrentHandle.NodeIndex);
+	const FVector& NeighbourPosition = NeighbourBound->GetNodeLocation(NeighbourIndex);
+	FVector ij = NeighbourPosition - CurrentPosition;
+	ij.Normalize();
+	ij *= CurrentNavData->GetHalfExtent(CurrentHandle.NodeIndex);
+	ij += CurrentPosition;
+	//Nodes only touching a dynamic obstacle are open, the collider may still reach into it. Only the obstacles of
+	//the bounds of the edge are tested, without a lock if they have none.
+	const FBox ColliderBox = FBox::BuildAABB(ij + ColliderOffset, ColliderSize);
+	if (CurrentBound->GetObstacleOverlay().OverlapsObstacle(ColliderBox) ||
+		(NeighbourBound != CurrentBound && NeighbourBound->GetObstacleOverlay().OverlapsObstacle(ColliderBox)))
+		return;
+	//The collider box lies in the free cube around the node, so the edge is clear without overlap test.
+	const bool bInClearance = CurrentBound->IsNodeClearanceValid() &&
+		((ij + ColliderOffset - CurrentPosition).GetAbs() + ColliderSize).GetMax() <=
+		CurrentNavData->GetClearance(CurrentHandle.NodeIndex);
+	if (!bInClearance)
+	{
+		const FFAEdgeClearanceKey EdgeKey(CurrentHandle, NeighbourHandle, ColliderSizeClass);
+		FFAEdgeClearanceCache& Cache = CurrentBound->GetEdgeClearanceCache();
+		//Before the test, so a result tested around an environment changed meanwhile is not cached.
+		const uint64 CacheEpoch = Cache.GetEpoch();
+		bool bClear;
+		if (!bUseEdgeClearanceCache || !Cache.Find(EdgeKey, bClear))
+		{
+			TArray<AActor*> Actors;
+			bClear = !UKismetSystemLibrary::BoxOverlapActors(World.Get(), ij + ColliderOffset, ColliderSize,
+			                                                 Settings->ObjectTypes,
+			                                                 Settings->EnvironmentActorClass, {}, Actors);
+			if (bUseEdgeClearanceCache) Cache.Add(EdgeKey, bClear, Settings->MaxEdgeClearanceCacheEntries, CacheEpoch);
+		}
+		if (!bClear) return;
+	}
+
+	const float NewMoveCost = Records[CurrentNode].Cost.X + FVector::Distance(CurrentPosition, NeighbourPosition);
+
+	//if the new move costs less or this neighbour isnt in the open set
+	if (!Found)
+	{
+		const double HCost = FVector::Distance(bHeuristicFromControlPoint ? ij : NeighbourPosition,
+		                                       EndNode.NodeData.Position);
+		const int32 Handle = Records.Add({
+			.Bound = NeighbourBound, .Handle = NeighbourHandle, .StartLocation = ij,
+			.Cost = FVector2D(NewMoveCost, HCost)
+		});
+		Scratch->PathLink.Add(CurrentNode);
+		Scratch->ClosedSet.Add(false);
+		Scratch->Handles.Add(NeighbourHandle, Handle);
+		Scratch->OpenSet.Push(Handle);
+	}
+	else if (NewMoveCost < Records[*Found].Cost.X)
+	{
+		FFAPathSearchRecord& Record = Records[*Found];
+		Record.Cost.X = NewMoveCost;
+		Record.StartLocation = ij;
+		Record.Cost.Y = FVector::Distance(ij, EndNode.NodeData.Position);
+		Scratch->PathLink[*Found] = CurrentNode;
+		Scratch->OpenSet.Update(*Found);
+	}
+}
+
+void FFAPathQuery::Finish(int32 EndRecord)
+{
+	for (int32 CurrentNode = EndRecord; CurrentNode != INDEX_NONE; CurrentNode = Scratch->PathLink[CurrentNode])
+	{
+		const FFAPathSearchRecord& Record = Scratch->Records[CurrentNode];
+		//Only the nodes on the path are made, the start node is already.
+		FinePath.Nodes.Add(Scratch->PathLink[CurrentNode] == INDEX_NONE
+			                   ? FinePath.LocalStartNode
+			                   : MakePathNodeData(Record));
+		PathLocations.Add(Record.StartLocation);
+	}
+	Algo::Reverse(FinePath.Nodes);
+	Algo::Reverse(PathLocations);
+	Status = EFAPathQueryStatus::Succeeded;
+	BuildControlPoints();
+	ReleaseSearch();
+}
+
+FFAPathNodeData FFAPathQuery::MakePathNodeData(const FFAPathSearchRecord& Record)
+{
+	const uint32 NodeIndex = Record.Handle.NodeIndex;
+	FFAPathNodeData Node{
+		.NodeData = Record.Bound->GetNavDataLocked()->MakeNodeData(NodeIndex), .NodeBound = Record.Bound,
+		.Handle = Record.Handle
+	};
+	Node.NodeData.HPANodeIndex = Record.Bound->GetNodeGlobalHPANode(NodeIndex);
+	Node.NodeData.IsTraversable &= !Record.Bound->GetObstacleOverlay().IsBlocked(NodeIndex);
+	Node.NodeData.Position = Record.Bound->GetNodeLocation(NodeIndex);
+	return Node;
+}
+
+void FFAPathQuery::BuildControlPoints()
+{
+	TArray<FVector>& ControlPoints = FinePath.ControlPoints;
+	ControlPoints.Reset();
+	//Lead in to the start of the whole path.
+	if (FinePath.CurrentHPANodeIndex == 0 && PathLocations.Num() > 1)
+	{
+		ControlPoints.Add(2 * PathLocations[0] - PathLocations[1]);
+	}
+	ControlPoints.Append(PathLocations);
+	if (bShouldFindEndNode)
+	{
+		ControlPoints.Add(FinePath.HPAPath.EndLocation);
+	}
+	if (ControlPoints.Num() > 1)
+	{
+		ControlPoints.Add(2 * ControlPoints.Last() - ControlPoints.Last(1));
+	}
+	FinePath.bIsSuccess = true;
+}
+
+void FFAPathQuery::Fail(bool bBoundLoaded)
+{
+	FinePath.bBoundLoaded = bBoundLoaded;
+	Status = EFAPathQueryStatus::Failed;
+	ReleaseSearch();
+}
+
+void FFAPathQuery::OnCancelled()
+{
+	Fail(false);
+	Status = EFAPathQueryStatus::Cancelled;
+}
+
+void FFAPathQuery::ReleaseSearch()
+{
+	//A finished query may wait to be handed over, keep only the path.
+	FFAPathSearchScratch::Release(MoveTemp(Scratch));
+}
@@ -0,0 +1,232 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FAPathQueryScheduler.h"
+#include "FAPathQuery.h"
+#include "FAStats.h"
+#include "Algo/StableSort.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending Path Queries"), STAT_FA_PendingPathQueries, STATGROUP_FlyingAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending Path Searches"), STAT_FA_PendingPathSearches, STATGROUP_FlyingAI);
+
+int32 FFAPathQueryScheduler::Schedule(const TSharedRef<FFAPathQuery>& Query, const TOptional<FFAPathQueryKey>& Key,
+                                      EFAPathQueryPriority Priority, FObjectKey Owner, int32 MaxSearches,
+                                      FFAOnPathQueryFinished OnFinished)
+{
+	check(Priority < EFAPathQueryPriority::Num);
+	UE::TScopeLock ScopeLock(Lock);
+	FPriorityStats& PriorityStats = Stats[static_cast<int32>(Priority)];
+	PriorityStats.Requests++;
+
+	const TSharedRef<FSearch>* Shared = Key.IsSet() ? SharedSearches.Find(Key.GetValue()) : nullptr;
+	if (!Shared && Searches[static_cast<int32>(Priority)].Num() >= MaxSearches)
+	{
+		PriorityStats.Rejected++;
+		return INDEX_NONE;
+	}
+	TSharedRef<FSearch> Search = Shared
+		                             ? *Shared
+		                             : MakeShared<FSearch>(FSearch{.Query = Query, .Key = Key, .Priority = Priority});
+	if (Shared)
+	{
+		PriorityStats.Coalesced++;
+		//Move the search up to the most important request sharing it.
+		if (Priority > Search->Priority)
+		{
+			Searches[static_cast<int32>(Search->Priority)].Remove(Search);
+			Search->Priority = Priority;
+			Searches[static_cast<int32>(Priority)].Add(Search);
+		}
+	}
+	else
+	{
+		Searches[static_cast<int32>(Priority)].Add(Search);
+		if (Key.IsSet()) SharedSearches.Add(Key.GetValue(), Search);
+	}
+
+	const int32 RequestId = NextRequestId++;
+	Search->RequestIds.Add(RequestId);
+	Requests.Add(RequestId, FRequest{
+		             .Query = Query, .Search = Search, .Priority = Priority, .Owner = Owner,
+		             .OnFinished = MoveTemp(OnFinished), .RequestTime = FPlatformTime::Seconds()
+	             });
+	PriorityStats.QueueDepth++;
+	return RequestId;
+}
+
+void FFAPathQueryScheduler::Cancel(int32 RequestId)
+{
+	UE::TScopeLock ScopeLock(Lock);
+	if (const FRequest* Request = Requests.Find(RequestId))
+	{
+		Stats[static_cast<int32>(Request->Priority)].Cancelled++;
+		RemoveRequest(RequestId);
+	}
+}
+
+int32 FFAPathQueryScheduler::CancelOwner(FObjectKey Owner)
+{
+	if (Owner == FObjectKey()) return 0;
+	UE::TScopeLock ScopeLock(Lock);
+	TArray<int32> Cancelled;
+	for (const TPair<int32, FRequest>& Request : Requests)
+	{
+		if (Request.Value.Owner == Owner) Cancelled.Add(Request.Key);
+	}
+	for (const int32 RequestId : Cancelled)
+	{
+		Stats[static_cast<int32>(Requests[RequestId].Priority)].Cancelled++;
+		RemoveRequest(RequestId);
+	}
+	return Cancelled.Num();
+}
+
+bool FFAPathQueryScheduler::IsPending(int32 RequestId) const
+{
+	UE::TScopeLock ScopeLock(Lock);
+	return Requests.Contains(RequestId);
+}
+
+int32 FFAPathQueryScheduler::Num() const
+{
+	UE::TScopeLock ScopeLock(Lock);
+	return Requests.Num();
+}
+
+void FFAPathQueryScheduler::Reset()
+{
+	UE::TScopeLock ScopeLock(Lock);
+	Requests.Empty();
+	SharedSearches.Empty();
+	for (int32 Priority = 0; Priority < NumPriorities; Priority++)
+	{
+		Searches[Priority].Empty();
+		NextTurns[Priority] = 0;
+		Stats[Priority].QueueDepth = 0;
+	}
+}
+
+void FFAPathQueryScheduler::Tick(double BudgetSeconds, int32 ExpansionsPerStep)
+{
+	{
+		UE::TScopeLock ScopeLock(Lock);
+		SET_DWORD_STAT(STAT_FA_PendingPathQueries, Requests.Num());
+		if (Requests.Num() == 0) return;
+		int32 NumSearches = 0;
+		for (int32 Priority = 0; Priority < NumPriorities; Priority++)
+		{
+			SteppingSearches[Priority] = Searches[Priority];
+			NumSearches += Searches[Priority].Num();
+		}
+		SET_DWORD_STAT(STAT_FA_PendingPathSearches, NumSearches);
+	}
+
+	const double EndTime = FPlatformTime::Seconds() + BudgetSeconds;
+	double Now = FPlatformTime::Seconds();
+	for (int32 Priority = NumPriorities - 1; Priority >= 0 && Now < EndTime; Priority--)
+	{
+		TArray<TSharedRef<FSearch>>& Stepping = SteppingSearches[Priority];
+		if (Stepping.Num() == 0) continue;
+		int32 Turn = NextTurns[Priority] % Stepping.Num();
+		//Take turns until a whole round has nothing left to step.
+		bool bStepped = true;
+		while (bStepped && Now < EndTime)
+		{
+			bStepped = false;
+			for (int32 i = 0; i < Stepping.Num() && Now < EndTime; i++)
+			{
+				FFAPathQuery& Query = *Stepping[Turn]->Query;
+				Turn = (Turn + 1) % Stepping.Num();
+				if (Query.IsDone()) continue;
+				Query.Step(ExpansionsPerStep, EndTime - Now);
+				bStepped = true;
+				Now = FPlatformTime::Seconds();
+			}
+		}
+		NextTurns[Priority] = Turn;
+	}
+	for (TArray<TSharedRef<FSearch>>& Stepping : SteppingSearches)
+	{
+		Stepping.Reset();
+	}
+
+	//Requests of the ended searches, the more important first.
+	TArray<FRequest> Ended;
+	{
+		UE::TScopeLock ScopeLock(Lock);
+		for (int32 Priority = NumPriorities - 1; Priority >= 0; Priority--)
+		{
+			//Copied as ended searches are removed from it.
+			for (const TSharedRef<FSearch>& Search : TArray<TSharedRef<FSearch>>(Searches[Priority]))
+			{
+				if (!Search->Query->IsDone()) continue;
+				for (const int32 RequestId : Search->RequestIds)
+				{
+					FRequest Request = Requests.FindAndRemoveChecked(RequestId);
+					FPriorityStats& PriorityStats = Stats[static_cast<int32>(Request.Priority)];
+					const double Latency = (Now - Request.RequestTime) * 1000;
+					PriorityStats.QueueDepth--;
+					PriorityStats.Completed++;
+					PriorityStats.TotalLatency += Latency;
+					PriorityStats.MaxLatency = FMath::Max(PriorityStats.MaxLatency, Latency);
+					Ended.Add(MoveTemp(Request));
+				}
+				Search->RequestIds.Reset();
+				RemoveSearch(Search);
+			}
+		}
+	}
+	//Outside the lock, callbacks may request the next segment.
+	Algo::StableSortBy(Ended, [](const FRequest& Request) { return Request.Priority; }, TGreater<>());
+	for (FRequest& Request : Ended)
+	{
+		if (Request.Query != Request.Search->Query) Request.Query->ShareResult(*Request.Search->Query);
+		Request.OnFinished.ExecuteIfBound(Request.Query->GetFinePath());
+	}
+}
+
+FFAPathQuerySchedulerStats FFAPathQueryScheduler::GetStats(EFAPathQueryPriority Priority) const
+{
+	UE::TScopeLock ScopeLock(Lock);
+	const FPriorityStats& PriorityStats = Stats[static_cast<int32>(Priority)];
+	FFAPathQuerySchedulerStats Result;
+	Result.QueueDepth = PriorityStats.QueueDepth;
+	Result.Searches = Searches[static_cast<int32>(Priority)].Num();
+	Result.Requests = PriorityStats.Requests;
+	Result.Coalesced = PriorityStats.Coalesced;
+	Result.Rejected = PriorityStats.Rejected;
+	Result.Cancelled = PriorityStats.Cancelled;
+	Result.Completed = PriorityStats.Completed;
+	Result.AverageLatency = PriorityStats.Completed ? PriorityStats.TotalLatency / PriorityStats.Completed : 0;
+	Result.MaxLatency = PriorityStats.MaxLatency;
+	return Result;
+}
+
+void FFAPathQueryScheduler::ResetStats()
+{
+	UE::TScopeLock ScopeLock(Lock);
+	for (FPriorityStats& PriorityStats : Stats)
+	{
+		PriorityStats = FPriorityStats{.QueueDepth = PriorityStats.QueueDepth};
+	}
+}
+
+void FFAPathQueryScheduler::RemoveRequest(int32 RequestId)
+{
+	const FRequest Request = Requests.FindAndRemoveChecked(RequestId);
+	Stats[static_cast<int32>(Request.Priority)].QueueDepth--;
+	Request.Search->RequestIds.Remove(RequestId);
+	if (Request.Search->RequestIds.Num() > 0) return;
+	//Nobody waits for it, stop it if a step is running.
+	Request.Search->Query->Cancel();
+	RemoveSearch(Request.Search);
+}
+
+void FFAPathQueryScheduler::RemoveSearch(const TSharedRef<FSearch>& Search)
+{
+	Searches[static_cast<int32>(Search->Priority)].Remove(Search);
+	if (Search->Key.IsSet())
+	{
+		const TSharedRef<FSearch>* Shared = SharedSearches.Find(Search->Key.GetValue());
+		if (Shared && *Shared == Search) SharedSearches.Remove(Search->Key.GetValue());
+	}
+}
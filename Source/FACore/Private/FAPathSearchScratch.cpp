@@ -0,0 +1,98 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FAPathSearchScratch.h"
+#include "FAStats.h"
+#include <atomic>
+
+DECLARE_MEMORY_STAT(TEXT("Path Search Scratch Peak"), STAT_FA_PathSearchScratchPeak, STATGROUP_FlyingAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path Search Scratches"), STAT_FA_PathSearchScratches, STATGROUP_FlyingAI);
+
+namespace
+{
+	//Enough for every search the scheduler may step on the game thread at once with the default settings.
+	constexpr int32 MaxCachedPerThread = 256;
+	//Scratches grown by an unusually large search are freed instead of held by the cache.
+	constexpr SIZE_T MaxCachedSize = 2 * 1024 * 1024;
+	//Bounds what a thread holds between searches, however many scratches it cached.
+	constexpr SIZE_T MaxCachedSizePerThread = 8 * 1024 * 1024;
+
+	std::atomic<SIZE_T> PeakAllocatedSize{0};
+	std::atomic<int32> NumAllocated{0};
+
+	//Fixed size so taking from and giving back to it never allocates either.
+	struct FThreadCache
+	{
+		TUniquePtr<FFAPathSearchScratch> Scratches[MaxCachedPerThread];
+		SIZE_T Sizes[MaxCachedPerThread];
+		int32 Num = 0;
+		SIZE_T CachedSize = 0;
+
+		~FThreadCache() { NumAllocated -= Num; }
+	};
+
+	FThreadCache& GetThreadCache()
+	{
+		thread_local FThreadCache Cache;
+		return Cache;
+	}
+}
+
+TUniquePtr<FFAPathSearchScratch> FFAPathSearchScratch::Acquire()
+{
+	FThreadCache& Cache = GetThreadCache();
+	if (Cache.Num > 0)
+	{
+		--Cache.Num;
+		Cache.CachedSize -= Cache.Sizes[Cache.Num];
+		return MoveTemp(Cache.Scratches[Cache.Num]);
+	}
+	SET_DWORD_STAT(STAT_FA_PathSearchScratches, NumAllocated.fetch_add(1) + 1);
+	return MakeUnique<FFAPathSearchScratch>();
+}
+
+void FFAPathSearchScratch::Release(TUniquePtr<FFAPathSearchScratch> Scratch)
+{
+	if (!Scratch) return;
+	const SIZE_T Size = Scratch->GetAllocatedSize();
+	SIZE_T Peak = PeakAllocatedSize.load();
+	while (Size > Peak && !PeakAllocatedSize.compare_exchange_weak(Peak, Size))
+	{
+	}
+	if (Size > Peak) SET_MEMORY_STAT(STAT_FA_PathSearchScratchPeak, Size);
+
+	FThreadCache& Cache = GetThreadCache();
+	if (Cache.Num >= MaxCachedPerThread || Size > MaxCachedSize || Cache.CachedSize + Size > MaxCachedSizePerThread)
+	{
+		SET_DWORD_STAT(STAT_FA_PathSearchScratches, NumAllocated.fetch_sub(1) - 1);
+		return;
+	}
+	Scratch->Reset();
+	Cache.Sizes[Cache.Num] = Size;
+	Cache.CachedSize += Size;
+	Cache.Scratches[Cache.Num++] = MoveTemp(Scratch);
+}
+
+SIZE_T FFAPathSearchScratch::GetPeakAllocatedSize()
+{
+	return PeakAllocatedSize.load();
+}
+
+int32 FFAPathSearchScratch::GetNumAllocated()
+{
+	return NumAllocated.load();
+}
+
+void FFAPathSearchScratch::Reset()
+{
+	Records.Reset();
+	PathLink.Reset();
+	Handles.Reset();
+	ClosedSet.Reset();
+	OpenSet.Reset();
+}
+
+SIZE_T FFAPathSearchScratch::GetAllocatedSize() const
+{
+	return Records.GetAllocatedSize() + PathLink.GetAllocatedSize() + Handles.GetAllocatedSize() +
+		ClosedSet.GetAllocatedSize() + OpenSet.GetAllocatedSize();
+}
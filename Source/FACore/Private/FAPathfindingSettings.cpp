@@ -7,3 +7,22 @@ UFAPathfindingSettings::UFAPathfindingSettings()
 	CategoryName = "Plugins";
 	SectionName = "Flying AI Plugin";
 }
+
+int32 UFAPathfindingSettings::GetNumPathfindingWorkers() const
+{
+	if (PathfindingWorkerCount > 0) return PathfindingWorkerCount;
+	return FMath::Max(FPlatformMisc::NumberOfCores() / 2, 1);
+}
+
+EThreadPriority UFAPathfindingSettings::GetPathfindingWorkerThreadPriority() const
+{
+	switch (PathfindingWorkerPriority)
+	{
+	case EFAThreadPriority::Lowest: return TPri_Lowest;
+	case EFAThreadPriority::BelowNormal: return TPri_BelowNormal;
+	case EFAThreadPriority::Normal: return TPri_Normal;
+	case EFAThreadPriority::AboveNormal: return TPri_AboveNormal;
+	default: checkNoEntry();
+		return TPri_Normal;
+	}
+}
@@ -6,23 +6,30 @@
 #include "FANode.h"
 #include "EngineUtils.h"
 #include "FALevelData.h"
+#include "FADisjointSet.h"
 #include "FANeighbourData.h"
+#include "FANodeSpatialIndex.h"
+#include "Algo/Accumulate.h"
+#include "Algo/AnyOf.h"
 #include "Async/Async.h"
 #include "Async/ParallelFor.h"
 #include "FAPathfindingSettings.h"
+#include "FAPathQuery.h"
 #include "Engine/Engine.h"
 #include "Engine/AssetManager.h"
 #include "Engine/CompositeDataTable.h"
 #include "Logging/LogVerbosity.h"
 #include "VisualLogger/VisualLogger.h"
-#include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "Interfaces/Interface_CollisionDataProvider.h"
+#include "PhysicsEngine/BodySetup.h"
 #include "Tasks/Pipe.h"
 #include "Tasks/Task.h"
 
 DEFINE_LOG_CATEGORY(LogFAWorldSubsystem)
 
+
 bool UFAWorldSubsystem::ShouldCreateSubsystem(UObject* Outer) const
 {
 	if (!Super::ShouldCreateSubsystem(Outer)) return false;
@@ -58,6 +65,12 @@ void UFAWorldSubsystem::OnWorldBeginPlay(UWorld& InWorld)
 	});
 	if (ptr)
 	{
+		ActorSpawnedHandle = InWorld.AddOnActorSpawnedHandler(
+			FOnActorSpawned::FDelegate::CreateUObject(
+				this, &UFAWorldSubsystem::OnEnvironmentActorChanged));
+		ActorDestroyedHandle = InWorld.AddOnActorDestroyedHandler(
+			FOnActorDestroyed::FDelegate::CreateUObject(
+				this, &UFAWorldSubsystem::OnEnvironmentActorChanged));
 		RegisterBoundInWorldStartUp();
 	}
 	else
@@ -73,25 +86,53 @@ void UFAWorldSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 	PathfindingAlgoClass = Settings->PathfindingAlgorithmToUse;
 	PathfindingAlgo = NewObject<UFAPathfindingAlgo>(Settings->PathfindingAlgorithmToUse);
 	ThreadPool = FQueuedThreadPool::Allocate();
-	verify(
-		ThreadPool->Create(16, (128 * 1024),TPri_AboveNormal, TEXT("FAWorldSubsystemThreadPool") ));
+	WorkerAffinityMask = static_cast<uint64>(Settings->PathfindingWorkerAffinityMask);
+	verify(ThreadPool->Create(Settings->GetNumPathfindingWorkers(), Settings->PathfindingWorkerStackSizeKB * 1024,
+		       Settings->GetPathfindingWorkerThreadPriority(), TEXT("FAWorldSubsystemThreadPool")));
+}
+
+void UFAWorldSubsystem::PinWorkerThread() const
+{
+	//The pool takes no affinity when created, so each thread pins itself on its first job.
+	thread_local uint64 PinnedMask = 0;
+	if (WorkerAffinityMask == 0 || PinnedMask == WorkerAffinityMask) return;
+	FPlatformProcess::SetThreadAffinityMask(WorkerAffinityMask);
+	PinnedMask = WorkerAffinityMask;
+}
+
+void UFAWorldSubsystem::Deinitialize()
+{
+	if (UWorld* World = GetWorld())
+	{
+		World->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		World->RemoveOnActorDestroyededHandler(ActorDestroyedHandle);
+	}
+	PathQueryScheduler.Reset();
+	Super::Deinitialize();
 }
 
 void UFAWorldSubsystem::BeginDestroy()
 {
-	UE::Tasks::Wait(SetHPATasks);
+	WaitSetHPATasks();
 	OnSystemReady.Clear();
-	FPlatformProcess::ConditionalSleep([this]
-	{
-		return !UFAPathfindingAlgo::IsGenerating();
-	});
+	//The searches running on the pool stop after their current node, deleting it waits only for that.
+	PathQueryToken->Cancel();
 	if (ThreadPool) delete ThreadPool;
-	for (auto Data : NeighboursData)
+	Super::BeginDestroy();
+}
+
+void UFAWorldSubsystem::WaitSetHPATasks()
+{
+	if (!IsInGameThread())
 	{
-		if (UGameplayStatics::DoesSaveGameExist(Data.Key, 0)) UGameplayStatics::DeleteGameInSlot(
-			Data.Key, 0);
+		UE::Tasks::Wait(SetHPATasks);
+		return;
+	}
+	//Connecting neighbours waits for their nodes loaded on the game thread.
+	while (!UE::Tasks::Wait(SetHPATasks, FTimespan::FromMilliseconds(1)))
+	{
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
 	}
-	Super::BeginDestroy();
 }
 
 void UFAWorldSubsystem::RegisterBoundInWorld(AFABound* Bound)
@@ -99,7 +140,7 @@ void UFAWorldSubsystem::RegisterBoundInWorld(AFABound* Bound)
 	Bound->LoadBoundData();
 	if (!Bound->GetBoundData()) return;
 	csHPAIndex.Lock();
-	RegisteredBound.Add(Bound);
+	AddRegisteredBound(Bound);
 	for (auto hpaIndex : Bound->GetBoundData()->ContainingHPANodes)
 	{
 		Bound->GetLocalToGlobalHPANodes().Add(hpaIndex, HPAIndex.Num());
@@ -116,13 +157,17 @@ void UFAWorldSubsystem::RegisterBoundInWorld(AFABound* Bound)
 				Bound->GetLocalToGlobalHPANodes()[i]);
 		}
 	}
+	Bound->UpdateGlobalHPANodes();
+	AddBoundToHPAGraph(Bound);
 	csHPAIndex.Unlock();
 
-	for (int i = 0; i < RegisteredBound.Num() - 1; i++)
+	for (auto Other : FindBoundsInBox(FBox::BuildAABB(Bound->GetActorLocation(),
+	                                                  Bound->GetHalfExtent())))
 	{
-		SetHPATasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, i, Bound]
+		if (Other == Bound) continue;
+		SetHPATasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, Other, Bound]
 		{
-			SetBoundNeighbour(RegisteredBound[i], Bound);
+			SetBoundNeighbour(Other, Bound);
 		}));
 	}
 	SetHPATasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, Bound]
@@ -134,37 +179,173 @@ void UFAWorldSubsystem::RegisterBoundInWorld(AFABound* Bound)
 	}, SetHPATasks));
 }
 
+void UFAWorldSubsystem::UnregisterBoundInWorld(AFABound* Bound)
+{
+	{
+		FWriteScopeLock Lock(BoundTreeLock);
+		int32 Proxy;
+		if (!BoundProxies.RemoveAndCopyValue(Bound, Proxy)) return;
+		BoundTree.Remove(Proxy);
+	}
+	if (USceneComponent* Root = Bound->GetRootComponent()) Root->TransformUpdated.RemoveAll(this);
+	//The searches through it would go on with HPA nodes that no longer exist.
+	Bound->CancelPathQueries();
+	//Connecting neighbours may still read the bound.
+	WaitSetHPATasks();
+	UE::TScopeLock HPALock(csHPAIndex);
+	{
+		UE::TScopeLock Lock(RegisteredBoundLock);
+		RegisteredBound[Bound->GetBoundIndex()] = nullptr;
+	}
+	TSet<uint32> Clusters;
+	for (auto& Pair : Bound->GetLocalToGlobalHPANodes())
+	{
+		Clusters.Add(Pair.Value);
+		HPAIndex[Pair.Value] = nullptr;
+	}
+	{
+		FScopeLock Lock(&HPAConnectionLock);
+		for (auto& Connection : HPAConnection)
+		{
+			if (Clusters.Contains(Connection.Key)) Connection.Value.Values.Empty();
+			else Connection.Value.Values.RemoveAll([&Clusters](uint32 a) { return Clusters.Contains(a); });
+		}
+	}
+	{
+		FWriteScopeLock Lock(HPAGraphLock);
+		HPAGraph.RemoveClusters(Clusters);
+	}
+	for (const UFANeighbourData* Data : Bound->GetNeighboursData())
+	{
+		AFABound* Other = Data->Bound[0] == Bound ? Data->Bound[1] : Data->Bound[0];
+		if (Other) Other->RemoveNeighbourData(Bound);
+	}
+	//Every connection of the bound has it on one side.
+	Bound->RemoveNeighbourData(Bound);
+	Bound->GetLocalToGlobalHPANodes().Empty();
+	Bound->UpdateGlobalHPANodes();
+	Bound->SetBoundIndex(FFANodeHandle::InvalidIndex);
+}
+
+void UFAWorldSubsystem::AddRegisteredBound(AFABound* Bound)
+{
+	{
+		UE::TScopeLock Lock(RegisteredBoundLock);
+		Bound->SetBoundIndex(RegisteredBound.Num());
+		RegisteredBound.Add(Bound);
+	}
+	{
+		FWriteScopeLock Lock(BoundTreeLock);
+		BoundProxies.Add(Bound, BoundTree.Insert(
+			                 FBox::BuildAABB(Bound->GetActorLocation(), Bound->GetHalfExtent()),
+			                 Bound->GetBoundIndex()));
+	}
+	if (USceneComponent* Root = Bound->GetRootComponent())
+		Root->TransformUpdated.AddUObject(this, &UFAWorldSubsystem::OnBoundTransformUpdated);
+}
+
+void UFAWorldSubsystem::OnBoundTransformUpdated(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags,
+                                                ETeleportType Teleport)
+{
+	AFABound* Bound = Cast<AFABound>(Component->GetOwner());
+	if (!Bound) return;
+	FWriteScopeLock Lock(BoundTreeLock);
+	if (const int32* Proxy = BoundProxies.Find(Bound))
+		BoundTree.Move(*Proxy, FBox::BuildAABB(Bound->GetActorLocation(), Bound->GetHalfExtent()));
+}
+
+TArray<AFABound*> UFAWorldSubsystem::GetBoundsByIndices(const TArray<uint32>& Indices)
+{
+	TArray<AFABound*> Bounds;
+	Bounds.Reserve(Indices.Num());
+	UE::TScopeLock Lock(RegisteredBoundLock);
+	for (auto Index : Indices)
+	{
+		if (RegisteredBound[Index]) Bounds.Add(RegisteredBound[Index]);
+	}
+	return Bounds;
+}
+
+TArray<AFABound*> UFAWorldSubsystem::FindBoundsAtPoint(const FVector& Point)
+{
+	TArray<uint32> Indices;
+	{
+		FReadScopeLock Lock(BoundTreeLock);
+		BoundTree.QueryPoint(Point, [&Indices](uint32 Index) { Indices.Add(Index); });
+	}
+	return GetBoundsByIndices(Indices);
+}
+
+TArray<AFABound*> UFAWorldSubsystem::FindBoundsInBox(const FBox& Box)
+{
+	TArray<uint32> Indices;
+	{
+		FReadScopeLock Lock(BoundTreeLock);
+		BoundTree.QueryBox(Box, [&Indices](uint32 Index) { Indices.Add(Index); });
+	}
+	return GetBoundsByIndices(Indices);
+}
+
+TArray<AFABound*> UFAWorldSubsystem::FindBoundsAlongSegment(const FVector& Start, const FVector& End)
+{
+	TArray<uint32> Indices;
+	{
+		FReadScopeLock Lock(BoundTreeLock);
+		BoundTree.QueryRay(Start, End, [&Indices](uint32 Index) { Indices.Add(Index); });
+	}
+	return GetBoundsByIndices(Indices);
+}
+
 //Return 0 == Nothing within box
 //Return 1 == Partially filled.
 //Return 2 == Fully filled.
 //Return 3 == Reached Max Depth.
 uint8 UFAWorldSubsystem::GenerateNodeBranch(const UFABoundData* BoundData, UWorld* World,
-                                            TSharedPtr<FFaNodeData> Node, FName NodeName,
-                                            int nodeIndex, UE::FSpinLock* DataLock,
-                                            UDataTable* Data)
+                                            TSharedPtr<FFaNodeData> Node, const FString& TableName,
+                                            int64 nodeIndex, int32 ParallelDepth,
+                                            FFANodeGenRows& OutRows, const FFAOccupancyGrid* Grid)
 {
-	if (!IsNodeOverlapping(Node.Get(), Settings->ObjectTypes, Settings->EnvironmentActorClass,
-	                       ActorsToIgnore, World)) return 0;
+	if (!IsNodeOccupied(Node.Get(), Grid, World)) return 0;
 	if (Node->Depth == BoundData->MaxDepth) return 3;
 	FFANewNodeChildType NodeChildren;
+	const int64 cnodeIndex = 8 * nodeIndex + 8;
+	for (int i = 0; i < 8; i++)
 	{
-		int cnodeIndex = 8 * nodeIndex + 8;
+		FString name = FString::Printf(TEXT("%s_%lld_FAN"), *TableName, cnodeIndex + i);
+		NodeChildren.ChildrenName[i] = FName(*name);
+	}
+	Subdivide(Node, NodeChildren);
+	uint8 Tasks[8];
+	if ((int32)Node->Depth < ParallelDepth)
+	{
+		FFANodeGenRows ChildRows[8];
+		TArray<UE::Tasks::FTask> ChildTasks;
+		ChildTasks.Reserve(8);
 		for (int i = 0; i < 8; i++)
 		{
-			FString name = FString::Printf(TEXT("%s_%d_FAN"), *Data->GetName(), cnodeIndex);
-			NodeChildren.ChildrenName[i] = FName(*name);
-			cnodeIndex++;
+			ChildTasks.Add(UE::Tasks::Launch(
+				UE_SOURCE_LOCATION,
+				[this, BoundData, World, &NodeChildren, &TableName, cnodeIndex, ParallelDepth, &Tasks, &ChildRows, i,
+					Grid]
+				{
+					Tasks[i] = GenerateNodeBranch(BoundData, World, NodeChildren.Children[i], TableName,
+					                              cnodeIndex + i, ParallelDepth, ChildRows[i], Grid);
+				}));
+		}
+		//Children not started yet are run by this thread instead of blocking it.
+		UE::Tasks::Wait(ChildTasks);
+		for (auto& Rows : ChildRows)
+		{
+			OutRows.Append(MoveTemp(Rows));
 		}
 	}
-	Subdivide(Node, NodeChildren);
-	TArray<uint8> Tasks;
-	Tasks.Reserve(8);
-	int cnodeIndex = 8 * nodeIndex + 8;
-	for (int i = 0; i < 8; i++)
+	else
 	{
-		Tasks.Add(GenerateNodeBranch(BoundData, World, NodeChildren.Children[i],
-		                             NodeChildren.ChildrenName[i], cnodeIndex, DataLock, Data));
-		cnodeIndex++;
+		for (int i = 0; i < 8; i++)
+		{
+			Tasks[i] = GenerateNodeBranch(BoundData, World, NodeChildren.Children[i], TableName,
+			                              cnodeIndex + i, ParallelDepth, OutRows, Grid);
+		}
 	}
 	uint8 Results = 0;
 
@@ -177,105 +358,140 @@ uint8 UFAWorldSubsystem::GenerateNodeBranch(const UFABoundData* BoundData, UWorl
 	//All children are filled and reach max depth.
 	if (Results == 24) return 2;
 
+	for (int i = 0; i < 8; i++)
 	{
-		UE::TScopeLock Lock(*DataLock);
-		for (int i = 0; i < 8; i++)
+		if (Tasks[i] != 1)
 		{
-			if (Tasks[i] != 1)
-			{
-				NodeChildren.Children[i]->IsTraversable = Tasks[i] == 0;
-				Data->AddRow(NodeChildren.ChildrenName[i], *NodeChildren.Children[i]);
-			}
+			NodeChildren.Children[i]->IsTraversable = Tasks[i] == 0;
+			OutRows.Emplace(NodeChildren.ChildrenName[i], *NodeChildren.Children[i]);
 		}
 	}
 
 	return 1;
 }
 
-void UFAWorldSubsystem::SetHPAIndex(UDataTable* CombinedNodes, UDataTable* DataTable,
-                                    TArray<AFABound*>& InHPAIndex, UE::FSpinLock& _csHPAIndex)
+TArray<bool> UFAWorldSubsystem::SetNodeNeighbours(const TArray<UDataTable*>& DataTables,
+                                                  const FVector& BoundPosition, const FVector& BoundHalfExtent)
 {
-	TArray<TPair<FName, uint8*>> RowMap = CombinedNodes->GetRowMap().Array();
-	RowMap.Sort([](TPair<FName, uint8*> a, TPair<FName, uint8*> b)
+	TArray<TPair<FName, FFaNodeData*>> Rows;
+	TArray<int32> RowTables;
+	for (int32 t = 0; t < DataTables.Num(); t++)
 	{
-		return reinterpret_cast<FFaNodeData*>(a.Value)->Depth < reinterpret_cast<FFaNodeData*>(b.
-			Value)->Depth;
-	});
-	UE::FSpinLock Lock;
-	//Change to use ue task.
-	TArray<TFuture<void>> Tasks;
-	Tasks.Reserve(2000);
-	for (int x = 0; x < RowMap.Num() - 1; x++)
-	{
-		auto r0 = reinterpret_cast<FFaNodeData*>(RowMap[x].Value);
-		Tasks.Add(AsyncPool(*ThreadPool, [&RowMap, x, r0, &Lock, DataTable]
+		for (auto& Row : DataTables[t]->GetRowMap())
 		{
-			for (int y = x + 1; y < RowMap.Num(); y++)
-			{
-				auto r1 = reinterpret_cast<FFaNodeData*>(RowMap[y].Value);
-				if (AABBOverlap(r0->Position, r1->Position, r0->HalfExtent, r1->HalfExtent))
-				{
-					UE::TScopeLock SL(Lock);
-					if (auto d = DataTable->FindRow<FFaNodeData>(RowMap[x].Key, "", false)) d->
-						Neighbour.AddUnique(RowMap[y].Key);
-					if (auto d = DataTable->FindRow<FFaNodeData>(RowMap[y].Key, "", false)) d->
-						Neighbour.AddUnique(RowMap[x].Key);
-				}
-			}
-		}));
-		if (Tasks.Num() == 2000)
-		{
-			for (auto& Task : Tasks)
-			{
-				FPlatformProcess::ConditionalSleep([&Task] { return Task.IsReady(); });
-			}
-			Tasks.Empty(2000);
+			Rows.Emplace(Row.Key, reinterpret_cast<FFaNodeData*>(Row.Value));
+			RowTables.Add(t);
 		}
 	}
-	for (auto& Task : Tasks)
+	TArray<FVector3f> Positions, HalfExtents;
+	Positions.Reserve(Rows.Num());
+	HalfExtents.Reserve(Rows.Num());
+	for (auto& Row : Rows)
+	{
+		Positions.Add(FVector3f(Row.Value->Position));
+		HalfExtents.Add(FVector3f(Row.Value->HalfExtent));
+	}
+	FFANodeSpatialIndex SpatialIndex;
+	SpatialIndex.Build(Positions, HalfExtents, BoundPosition, BoundHalfExtent);
+	TArray<uint32> Offsets, Neighbours;
+	SpatialIndex.BuildNeighbours(Offsets, Neighbours);
+	//Each row is only written by its own task.
+	TArray<bool> RowsChanged;
+	RowsChanged.SetNumZeroed(Rows.Num());
+	ParallelFor(Rows.Num(), [&Rows, &Offsets, &Neighbours, &RowsChanged](int32 i)
+	{
+		TArray<FName> Neighbour;
+		Neighbour.Reserve(Offsets[i + 1] - Offsets[i]);
+		for (uint32 n = Offsets[i]; n < Offsets[i + 1]; n++)
+		{
+			Neighbour.Add(Rows[Neighbours[n]].Key);
+		}
+		if (Neighbour == Rows[i].Value->Neighbour) return;
+		Rows[i].Value->Neighbour = MoveTemp(Neighbour);
+		RowsChanged[i] = true;
+	});
+	TArray<bool> TablesChanged;
+	TablesChanged.SetNumZeroed(DataTables.Num());
+	for (int32 i = 0; i < Rows.Num(); i++)
 	{
-		FPlatformProcess::ConditionalSleep([&Task] { return Task.IsReady(); });
+		TablesChanged[RowTables[i]] |= RowsChanged[i];
 	}
-	Tasks.Empty();
-	for (auto pair : DataTable->GetRowMap())
+	return TablesChanged;
+}
+
+int32 UFAWorldSubsystem::SetHPAIndex(const TArray<UDataTable*>& DataTables, TArray<AFABound*>& InHPAIndex)
+{
+	//Connected traversable nodes of each table, labelled in order of their rows.
+	TArray<TArray<TPair<FFaNodeData*, int32>>> TableLabels;
+	TArray<int32> TableNumClusters;
+	TableLabels.SetNum(DataTables.Num());
+	TableNumClusters.SetNumZeroed(DataTables.Num());
+	ParallelFor(DataTables.Num(), [&DataTables, &TableLabels, &TableNumClusters](int32 t)
 	{
-		TArray<FName> OpenSet, ClosedSet;
-		OpenSet.Reserve(DataTable->GetRowMap().Num());
-		ClosedSet.Reserve(DataTable->GetRowMap().Num());
+		TableNumClusters[t] = LabelTableClusters(DataTables[t], TableLabels[t]);
+	});
 
-		auto nodeValue = reinterpret_cast<FFaNodeData*>(pair.Value);
-		if (!nodeValue->IsTraversable) continue;
-		FName Current = pair.Key;
-		OpenSet.Add(Current);
-		int32 Idx;
+	//Clusters of the tables in order, so the indices don't depend on which table finishes first.
+	const int32 NumClusters = Algo::Accumulate(TableNumClusters, 0);
+	for (int32 t = 0; t < DataTables.Num(); t++)
+	{
+		const int32 FirstIndex = InHPAIndex.Num();
+		for (auto& Label : TableLabels[t])
 		{
-			UE::TScopeLock HPALock(_csHPAIndex);
-			Idx = nodeValue->HPANodeIndex == INDEX_NONE
-				      ? InHPAIndex.Num()
-				      : nodeValue->HPANodeIndex;
-			if (nodeValue->HPANodeIndex == INDEX_NONE)
-			{
-				InHPAIndex.Add(nullptr);
-			}
+			Label.Key->HPANodeIndex = FirstIndex + Label.Value;
 		}
+		InHPAIndex.AddZeroed(TableNumClusters[t]);
+	}
+	return NumClusters;
+}
 
-		while (OpenSet.Num() > 0)
+int32 UFAWorldSubsystem::RelabelHPAIndex(const UDataTable* DataTable, TArray<uint32> ReusedIndices,
+                                         TArray<AFABound*>& InOutHPAIndex)
+{
+	TArray<TPair<FFaNodeData*, int32>> Labels;
+	const int32 NumClusters = LabelTableClusters(DataTable, Labels);
+	ReusedIndices.Sort();
+	while (ReusedIndices.Num() < NumClusters)
+	{
+		ReusedIndices.Add(InOutHPAIndex.AddZeroed());
+	}
+	for (auto& Label : Labels)
+	{
+		Label.Key->HPANodeIndex = ReusedIndices[Label.Value];
+	}
+	return NumClusters;
+}
+
+int32 UFAWorldSubsystem::LabelTableClusters(const UDataTable* DataTable,
+                                            TArray<TPair<FFaNodeData*, int32>>& OutLabels)
+{
+	const auto& RowMap = DataTable->GetRowMap();
+	TArray<FFaNodeData*> Nodes;
+	TMap<FName, int32> NodeIndices;
+	Nodes.Reserve(RowMap.Num());
+	NodeIndices.Reserve(RowMap.Num());
+	for (auto& Row : RowMap)
+	{
+		FFaNodeData* Node = reinterpret_cast<FFaNodeData*>(Row.Value);
+		if (!Node->IsTraversable) continue;
+		NodeIndices.Add(Row.Key, Nodes.Add(Node));
+	}
+	FFADisjointSet Clusters(Nodes.Num());
+	for (int32 i = 0; i < Nodes.Num(); i++)
+	{
+		for (const FName& Neighbour : Nodes[i]->Neighbour)
 		{
-			Current = OpenSet.Pop();
-			ClosedSet.Add(Current);
-			auto n = DataTable->FindRow<FFaNodeData>(Current, "", false);
-			if (!n) continue;
-			if (!n->IsTraversable || n->HPANodeIndex != INDEX_NONE) continue;
-			n->HPANodeIndex = Idx;
-			for (auto neighbour : n->Neighbour)
-			{
-				if (DataTable->FindRowUnchecked(neighbour) && !ClosedSet.Contains(neighbour))
-				{
-					OpenSet.AddUnique(neighbour);
-				}
-			}
+			if (const int32* Found = NodeIndices.Find(Neighbour)) Clusters.Union(i, *Found);
 		}
 	}
+	TArray<int32> Labels;
+	const int32 NumClusters = Clusters.Label(Labels);
+	OutLabels.Reset(Nodes.Num());
+	for (int32 i = 0; i < Nodes.Num(); i++)
+	{
+		OutLabels.Emplace(Nodes[i], Labels[i]);
+	}
+	return NumClusters;
 }
 
 void UFAWorldSubsystem::SetBoundNeighbour(AFABound* Bound0, AFABound* Bound1)
@@ -283,106 +499,154 @@ void UFAWorldSubsystem::SetBoundNeighbour(AFABound* Bound0, AFABound* Bound1)
 	if (!AABBOverlap(Bound0->GetActorLocation(), Bound1->GetActorLocation(),
 	                 Bound0->GetHalfExtent(), Bound1->GetHalfExtent())) return;
 
-	AsyncTask(ENamedThreads::GameThread, [this, Bound0, Bound1]
+	auto LoadBoundNodes = [Bound0, Bound1]
 	{
 		Bound0->LoadNodes();
 		Bound1->LoadNodes();
-		Bound0->GetNodeData()->WaitUntilComplete();
-		Bound1->GetNodeData()->WaitUntilComplete();
-	});
-
-	if (!Bound0->GetNodesData() || !Bound1->GetNodesData()) return;
-	TArray<TPair<FName, uint8*>> Rows1 = Bound0->GetNodesData()->GetRowMap().Array();
-	TArray<TPair<FName, uint8*>> Rows2 = Bound1->GetNodesData()->GetRowMap().Array();
-
-	Rows1.RemoveAll([](TPair<FName, uint8*>& d)
+		//No handle if the nodes are mapped from a nav blob.
+		if (Bound0->GetNodeData()) Bound0->GetNodeData()->WaitUntilComplete();
+		if (Bound1->GetNodeData()) Bound1->GetNodeData()->WaitUntilComplete();
+	};
+	if (IsInGameThread())
 	{
-		auto dd = reinterpret_cast<FFaNodeData*>(d.Value);
-		return !dd->IsTraversable || dd->HPANodeIndex == INDEX_NONE;
-	});
-	Rows2.RemoveAll([](TPair<FName, uint8*>& d)
+		LoadBoundNodes();
+	}
+	else
 	{
-		auto dd = reinterpret_cast<FFaNodeData*>(d.Value);
-		return !dd->IsTraversable || dd->HPANodeIndex == INDEX_NONE;
-	});
-	UFANeighbourData* NeighbourData = Cast<UFANeighbourData>(
-		UGameplayStatics::CreateSaveGameObject(UFANeighbourData::StaticClass()));
+		//The nodes are read below, wait for them loaded on the game thread.
+		FScopedEvent Event;
+		AsyncTask(ENamedThreads::GameThread, [&LoadBoundNodes, &Event]
+		{
+			LoadBoundNodes();
+			Event.Trigger();
+		});
+	}
+
+	UFANeighbourData* NeighbourData = NewObject<UFANeighbourData>(GetTransientPackage());
 	NeighbourData->Bound[0] = Bound0;
 	NeighbourData->Bound[1] = Bound1;
-
 	TMap<uint32, FFAConnectedHPANode> LocalHPAConnection;
+	//Sum and count of the centres of the faces shared by each pair of HPA nodes.
+	TMap<TPair<uint32, uint32>, TPair<FVector, int32>> LocalPortals;
+	{
+		//Held while reading the nodes, an unload may unmap them meanwhile. Taken in the same order by every thread
+		//stitching the two bounds.
+		AFABound* FirstLocked = Bound0 < Bound1 ? Bound0 : Bound1;
+		AFABound* SecondLocked = FirstLocked == Bound0 ? Bound1 : Bound0;
+		FReadScopeLock Lock0(FirstLocked->GetNodesDataLock());
+		FReadScopeLock Lock1(SecondLocked->GetNodesDataLock());
+		const UFANavOctreeData* NavData0 = Bound0->GetNavDataLocked();
+		const UFANavOctreeData* NavData1 = Bound1->GetNavDataLocked();
+		if (!NavData0 || !NavData1 || !Bound0->HasSearchNodesLocked() || !Bound1->HasSearchNodesLocked()) return;
+		//Cooked with the bound data if both bounds are placed as they were generated.
+		TArray<TPair<uint32, uint32>> Pairs;
+		if (!FindBoundStitch(Bound0, Bound1, Pairs))
+			FindBoundaryNodePairs(Bound0, NavData0, Bound1, NavData1, Pairs);
 
-	UE::FSpinLock LocalHPAConnectionLock, LocalNeighbourDataLock;
-
-	TArray<TFuture<void>> Tasks;
-	Tasks.Reserve(2000);
-	for (auto& Row1 : Rows1)
-	{
-		auto d1 = reinterpret_cast<FFaNodeData*>(Row1.Value);
-		Tasks.Add(AsyncPool(*ThreadPool,
-		                    [&Rows2, d1, Bound0, Bound1, &LocalNeighbourDataLock, &NeighbourData,
-			                    Row1, &LocalHPAConnectionLock, &LocalHPAConnection]
-		                    {
-			                    for (auto& Row2 : Rows2)
-			                    {
-				                    auto d2 = reinterpret_cast<FFaNodeData*>(Row2.Value);
-
-				                    if (!AABBOverlap(
-					                    d1->Position + Bound0->GetActorLocation() - Bound0->
-					                    GetBoundData()->GeneratePosition,
-					                    d2->Position + Bound1->GetActorLocation() - Bound1->
-					                    GetBoundData()->GeneratePosition, d1->HalfExtent,
-					                    d2->HalfExtent)) continue;
-				                    {
-					                    UE::TScopeLock Lock(LocalNeighbourDataLock);
-					                    NeighbourData->Connection0.FindOrAdd(Row1.Key).Connected.
-					                                   AddUnique(Row2.Key);
-					                    NeighbourData->Connection1.FindOrAdd(Row2.Key).Connected.
-					                                   AddUnique(Row1.Key);
-				                    }
-				                    {
-					                    UE::TScopeLock Lock(LocalHPAConnectionLock);
-					                    LocalHPAConnection.FindOrAdd(
-						                                       Bound0->GetLocalToGlobalHPANodes()[d1
-							                                       ->HPANodeIndex]).
-					                                       Values.AddUnique(
-						                                       Bound1->GetLocalToGlobalHPANodes()[d2
-							                                       ->HPANodeIndex]);
-					                    LocalHPAConnection.FindOrAdd(
-						                                       Bound1->GetLocalToGlobalHPANodes()[d2
-							                                       ->HPANodeIndex]).
-					                                       Values.AddUnique(
-						                                       Bound0->GetLocalToGlobalHPANodes()[d1
-							                                       ->HPANodeIndex]);
-				                    }
-			                    }
-		                    }));
-		if (Tasks.Num() == 2000)
+		const FVector Offset0 = Bound0->GetActorLocation() - Bound0->GetBoundData()->GeneratePosition;
+		const FVector Offset1 = Bound1->GetActorLocation() - Bound1->GetBoundData()->GeneratePosition;
+		for (auto& Pair : Pairs)
 		{
-			for (auto& Task : Tasks)
-			{
-				FPlatformProcess::ConditionalSleep([&Task] { return Task.IsReady(); });
-			}
-			Tasks.Empty(2000);
+			const uint32 Row1 = Pair.Key, Row2 = Pair.Value;
+			NeighbourData->Connection0.FindOrAdd(Row1).Connected.AddUnique(Row2);
+			NeighbourData->Connection1.FindOrAdd(Row2).Connected.AddUnique(Row1);
+			//Resolved when the bounds were registered, INDEX_NONE for nodes in no HPA node.
+			const uint32 HPANode1 = Bound0->GetNodeGlobalHPANode(Row1);
+			const uint32 HPANode2 = Bound1->GetNodeGlobalHPANode(Row2);
+			if (HPANode1 == INDEX_NONE || HPANode2 == INDEX_NONE) continue;
+			LocalHPAConnection.FindOrAdd(HPANode1).Values.AddUnique(HPANode2);
+			LocalHPAConnection.FindOrAdd(HPANode2).Values.AddUnique(HPANode1);
+			auto& Portal = LocalPortals.FindOrAdd(TPair<uint32, uint32>(HPANode1, HPANode2),
+			                                      TPair<FVector, int32>(FVector::ZeroVector, 0));
+			Portal.Key += AABBOverlapCentre(NavData0->GetPosition(Row1) + Offset0,
+			                                NavData1->GetPosition(Row2) + Offset1,
+			                                NavData0->GetHalfExtent(Row1), NavData1->GetHalfExtent(Row2));
+			Portal.Value++;
 		}
 	}
-	for (auto& Task : Tasks)
-	{
-		FPlatformProcess::ConditionalSleep([&Task] { return Task.IsReady(); });
-	}
-	Tasks.Empty();
 	for (auto& connection : LocalHPAConnection)
 	{
 		FScopeLock Lock(&HPAConnectionLock);
 		HPAConnection[connection.Key].Values.Append(connection.Value.Values);
 	}
-	UGameplayStatics::AsyncSaveGameToSlot(NeighbourData,
-	                                      FString::Printf(TEXT("%p%p"), Bound0, Bound1), 0);
-	Bound0->AddNeighbourData(FString::Printf(TEXT("%p%p"), Bound0, Bound1), NeighbourData);
-	Bound1->AddNeighbourData(FString::Printf(TEXT("%p%p"), Bound0, Bound1), NeighbourData);
-	NeighboursDataLock.Lock();
-	NeighboursData.Add(FString::Printf(TEXT("%p%p"), Bound0, Bound1), NeighbourData);
-	NeighboursDataLock.Unlock();
+	{
+		FWriteScopeLock Lock(HPAGraphLock);
+		for (auto& Portal : LocalPortals)
+		{
+			HPAGraph.AddPortal(Portal.Key.Key, Portal.Key.Value,
+			                   Portal.Value.Key / Portal.Value.Value);
+		}
+	}
+	Bound0->AddNeighbourData(NeighbourData);
+	Bound1->AddNeighbourData(NeighbourData);
+}
+
+void UFAWorldSubsystem::FindBoundaryNodePairs(const AFABound* Bound0, const UFANavOctreeData* NavData0,
+                                              const AFABound* Bound1, const UFANavOctreeData* NavData1,
+                                              TArray<TPair<uint32, uint32>>& OutPairs)
+{
+	//Only leaves touching the overlap of the bounds can touch leaves of the other bound.
+	const FBox Overlap = FBox::BuildAABB(Bound0->GetActorLocation(), Bound0->GetHalfExtent()).Overlap(
+		FBox::BuildAABB(Bound1->GetActorLocation(), Bound1->GetHalfExtent()));
+	auto GatherBoundaryLeaves = [&Overlap](const AFABound* Bound, const UFANavOctreeData* NavData,
+	                                       TArray<uint32>& OutRows, TArray<FBox>& OutBoxes)
+	{
+		const FVector Offset = Bound->GetActorLocation() - Bound->GetBoundData()->GeneratePosition;
+		TArray<uint32> Leaves;
+		//Leaves exactly on the faces of the overlap may round outside it.
+		NavData->FindNodesInBox(Overlap.ShiftBy(-Offset).ExpandBy(1), Leaves);
+		for (const uint32 Leaf : Leaves)
+		{
+			if (!NavData->IsTraversable(Leaf) || NavData->GetHPANodeIndex(Leaf) == INDEX_NONE) continue;
+			OutRows.Add(Leaf);
+			OutBoxes.Add(FBox::BuildAABB(NavData->GetPosition(Leaf) + Offset, NavData->GetHalfExtent(Leaf)));
+		}
+	};
+	TArray<uint32> Rows1, Rows2;
+	TArray<FBox> Boxes1, Boxes2;
+	GatherBoundaryLeaves(Bound0, NavData0, Rows1, Boxes1);
+	GatherBoundaryLeaves(Bound1, NavData1, Rows2, Boxes2);
+	//Sweep along the longest side of the overlap, where the leaves spread the most.
+	int32 SweepAxis = 0;
+	const FVector OverlapSize = Overlap.GetSize();
+	if (OverlapSize.Y > OverlapSize[SweepAxis]) SweepAxis = 1;
+	if (OverlapSize.Z > OverlapSize[SweepAxis]) SweepAxis = 2;
+	TArray<TPair<int32, int32>> Pairs;
+	SweepAndPrune(Boxes1, Boxes2, SweepAxis, Pairs);
+	for (auto& Pair : Pairs)
+	{
+		OutPairs.Emplace(Rows1[Pair.Key], Rows2[Pair.Value]);
+	}
+}
+
+bool UFAWorldSubsystem::FindBoundStitch(const AFABound* Bound0, const AFABound* Bound1,
+                                        TArray<TPair<uint32, uint32>>& OutPairs)
+{
+	const UFABoundData* BoundData0 = Bound0->GetBoundData();
+	const UFABoundData* BoundData1 = Bound1->GetBoundData();
+	//Stitched from either bound, the nodes of the other one second.
+	for (const bool bSwapped : {false, true})
+	{
+		const UFABoundData* Data = bSwapped ? BoundData1 : BoundData0;
+		const UFABoundData* Other = bSwapped ? BoundData0 : BoundData1;
+		const FVector OtherOffset = bSwapped
+			                            ? Bound0->GetActorLocation() - Bound1->GetActorLocation()
+			                            : Bound1->GetActorLocation() - Bound0->GetActorLocation();
+		for (const FFABoundStitch& Stitch : Data->Stitches)
+		{
+			if (Stitch.Other.Get() != Other || Stitch.OtherNavDataGuid != Other->NavDataGuid ||
+				!Stitch.OtherOffset.Equals(OtherOffset) || Stitch.Nodes.Num() != Stitch.OtherNodes.Num())
+				continue;
+			OutPairs.Reserve(Stitch.Nodes.Num());
+			for (int32 i = 0; i < Stitch.Nodes.Num(); i++)
+			{
+				OutPairs.Emplace(bSwapped ? Stitch.OtherNodes[i] : Stitch.Nodes[i],
+				                 bSwapped ? Stitch.Nodes[i] : Stitch.OtherNodes[i]);
+			}
+			return true;
+		}
+	}
+	return false;
 }
 
 void UFAWorldSubsystem::RegisterBoundInWorldStartUp()
@@ -393,7 +657,7 @@ void UFAWorldSubsystem::RegisterBoundInWorldStartUp()
 		Bound->LoadBoundData();
 		if (!Bound->GetBoundData()) continue;
 		csHPAIndex.Lock();
-		RegisteredBound.Add(*Bound);
+		AddRegisteredBound(*Bound);
 		for (auto hpaIndex : Bound->GetBoundData()->ContainingHPANodes)
 		{
 			Bound->GetLocalToGlobalHPANodes().Add(hpaIndex, HPAIndex.Num());
@@ -411,6 +675,8 @@ void UFAWorldSubsystem::RegisterBoundInWorldStartUp()
 					Bound->GetLocalToGlobalHPANodes()[i]);
 			}
 		}
+		Bound->UpdateGlobalHPANodes();
+		AddBoundToHPAGraph(*Bound);
 		//If System is not loaded and destroy, it will crash.
 		OnSystemReady.AddLambda([Bound]
 		{
@@ -418,13 +684,16 @@ void UFAWorldSubsystem::RegisterBoundInWorldStartUp()
 		});
 		csHPAIndex.Unlock();
 	}
-	for (int i = 0; i < RegisteredBound.Num() - 1; i++)
+	for (auto Bound : RegisteredBound)
 	{
-		for (int j = i + 1; j < RegisteredBound.Num(); j++)
+		for (auto Other : FindBoundsInBox(FBox::BuildAABB(Bound->GetActorLocation(),
+		                                                  Bound->GetHalfExtent())))
 		{
-			SetHPATasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, i, j]
+			//Each pair once.
+			if (Other->GetBoundIndex() <= Bound->GetBoundIndex()) continue;
+			SetHPATasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, Bound, Other]
 			{
-				SetBoundNeighbour(RegisteredBound[i], RegisteredBound[j]);
+				SetBoundNeighbour(Bound, Other);
 			}));
 		}
 	}
@@ -461,40 +730,61 @@ void UFAWorldSubsystem::Subdivide(TSharedPtr<FFaNodeData> Node, FFANewNodeChildT
 	}
 }
 
-FFAHPAPath UFAWorldSubsystem::CreateHPAPath(const FVector& StartLocation,
-                                            const FVector& EndLocation)
-{
-	return InternalCreateHPAPath(StartLocation, EndLocation, RegisteredBound);
-}
-
-UFANeighbourData* UFAWorldSubsystem::GetNeighbourData(FString Key)
+void UFAWorldSubsystem::AddBoundToHPAGraph(AFABound* Bound)
 {
-	UE::TScopeLock Lock(NeighboursDataLock);
-	if (NeighboursData.Contains(Key))
+	const UFABoundData* BoundData = Bound->GetBoundData();
+	auto& LocalToGlobal = Bound->GetLocalToGlobalHPANodes();
+	const FVector Offset = Bound->GetActorLocation() - BoundData->GeneratePosition;
+	FWriteScopeLock Lock(HPAGraphLock);
+	const bool bHasConnections = Algo::AnyOf(BoundData->InternalHPAConnection, [](auto& Connection)
+	{
+		return Connection.Value.Values.Num() > 0;
+	});
+	if (BoundData->InternalHPAPortals.Num() > 0 || !bHasConnections)
 	{
-		if (NeighboursData[Key].IsValid())
+		for (auto& Portal : BoundData->InternalHPAPortals)
 		{
-			return NeighboursData[Key].Get();
+			HPAGraph.AddPortal(LocalToGlobal[Portal.HPANodeA], LocalToGlobal[Portal.HPANodeB],
+			                   Portal.Position + Offset);
 		}
-		auto result = Cast<UFANeighbourData>(UGameplayStatics::LoadGameFromSlot(Key, 0));
-		NeighboursData[Key] = result;
-		return result;
+		return;
 	}
-	//Should not return value if the key does not exist.
-	return nullptr;
+	//Generated before portals are saved, every crossing costs the same and the search finds the fewest HPA nodes.
+	UE_LOG(LogFAWorldSubsystem, Warning,
+	       TEXT("%s has no HPA portals, regenerate the nodes for the shortest HPA path."),
+	       *Bound->GetName());
+	for (auto& Connection : BoundData->InternalHPAConnection)
+	{
+		for (auto Other : Connection.Value.Values)
+		{
+			if (Connection.Key < Other)
+				HPAGraph.AddPortal(LocalToGlobal[Connection.Key], LocalToGlobal[Other],
+				                   Bound->GetActorLocation());
+		}
+	}
+}
+
+FFAHPAPath UFAWorldSubsystem::CreateHPAPath(const FVector& StartLocation,
+                                            const FVector& EndLocation)
+{
+	return InternalCreateHPAPath(StartLocation, EndLocation);
 }
 
-FFAHPAPath UFAWorldSubsystem::InternalCreateHPAPath(FVector StartLocation, FVector EndLocation,
-                                                    TArray<AFABound*> Bounds)
+FFAHPAPath UFAWorldSubsystem::InternalCreateHPAPath(FVector StartLocation, FVector EndLocation)
 {
 	FFAPathNodeData StartNode, EndNode;
-	for (auto Bound : Bounds)
+	for (auto Bound : FindBoundsAtPoint(StartLocation))
 	{
-		if (StartNode.NodeName.IsNone()) StartNode = PointToNodeInBound(StartLocation, Bound);
-		if (EndNode.NodeName.IsNone()) EndNode = PointToNodeInBound(EndLocation, Bound);
+		StartNode = PointToNodeInBound(StartLocation, Bound);
+		if (StartNode.Handle.IsValid()) break;
+	}
+	for (auto Bound : FindBoundsAtPoint(EndLocation))
+	{
+		EndNode = PointToNodeInBound(EndLocation, Bound);
+		if (EndNode.Handle.IsValid()) break;
 	}
 	FFAHPAPath Result;
-	if (StartNode.NodeName.IsNone() || EndNode.NodeName.IsNone())
+	if (!StartNode.Handle.IsValid() || !EndNode.Handle.IsValid())
 	{
 		UE_LOG(LogTemp, Display, TEXT("Point not in Bound"));
 		return Result;
@@ -521,44 +811,23 @@ FFAHPAPath UFAWorldSubsystem::InternalCreateHPAPath(FVector StartLocation, FVect
 		return Result;
 	}
 
-	TArray<uint32> Visited;
-	TArray<TPair<uint32, uint32>> Paths;
-	TArray<uint32> Queue;
-	Queue.Add(StartHPANode);
-	uint32 Current = -1;
-	while (Queue.Num() > 0)
+	TArray<uint32> Clusters;
 	{
-		uint32 i = Queue[0];
-		Queue.RemoveAt(0);
-		Visited.AddUnique(i);
-		for (auto x : HPAConnection[i].Values)
+		FRWScopeLock Lock(HPAGraphLock, SLT_ReadOnly);
+		if (HPAGraph.NeedsBuild())
 		{
-			if (Visited.Contains(x)) continue;
-			Paths.Add(TPair<uint32, uint32>(x, i));
-			if (x == EndHPANode)
-			{
-				Current = x;
-				break;
-			}
-			Queue.AddUnique(x);
-			Visited.AddUnique(x);
+			Lock.ReleaseReadOnlyLockAndAcquireWriteLock_USE_WITH_CAUTION();
+			if (HPAGraph.NeedsBuild()) HPAGraph.Build();
 		}
+		if (!HPAGraph.FindPath(StartHPANode, StartLocation, EndHPANode, EndLocation, Clusters))
+			return Result;
 	}
-	if (Current == -1) return Result;
-
-	while (Current != StartHPANode)
+	Result.HPANodes = MoveTemp(Clusters);
+	Result.HPAAssociateBounds.Reserve(Result.HPANodes.Num());
+	for (auto Cluster : Result.HPANodes)
 	{
-		Result.HPANodes.Add(Current);
-		Result.HPAAssociateBounds.Add(HPAIndex[Current]);
-		Current = Paths.FindByPredicate([Current](TPair<uint32, uint32>& a)
-		{
-			return Current == a.Key;
-		})->Value;
+		Result.HPAAssociateBounds.Add(HPAIndex[Cluster]);
 	}
-	Result.HPANodes.Add(Current);
-	Result.HPAAssociateBounds.Add(HPAIndex[Current]);
-	Algo::Reverse(Result.HPANodes);
-	Algo::Reverse(Result.HPAAssociateBounds);
 	Result.bIsSuccess = true;
 	return Result;
 }
@@ -570,6 +839,325 @@ bool UFAWorldSubsystem::AABBOverlap(FVector P1, FVector P2, FVector H1, FVector
 		P1Min.Z <= P2Max.Z && P1Max.Z >= P2Min.Z;
 }
 
+FVector UFAWorldSubsystem::AABBOverlapCentre(FVector P1, FVector P2, FVector H1, FVector H2)
+{
+	const FVector Min = FVector::Max(P1 - H1, P2 - H2), Max = FVector::Min(P1 + H1, P2 + H2);
+	return (Min + Max) / 2;
+}
+
+void UFAWorldSubsystem::SweepAndPrune(TConstArrayView<FBox> BoxesA, TConstArrayView<FBox> BoxesB, int32 Axis,
+                                      TArray<TPair<int32, int32>>& OutPairs)
+{
+	struct FEvent
+	{
+		double Min;
+		int32 Set;
+		int32 Index;
+	};
+	TArray<FEvent> Events;
+	Events.Reserve(BoxesA.Num() + BoxesB.Num());
+	for (int32 i = 0; i < BoxesA.Num(); i++)
+	{
+		Events.Add({BoxesA[i].Min[Axis], 0, i});
+	}
+	for (int32 i = 0; i < BoxesB.Num(); i++)
+	{
+		Events.Add({BoxesB[i].Min[Axis], 1, i});
+	}
+	Events.StableSort([](const FEvent& A, const FEvent& B) { return A.Min < B.Min; });
+	//Boxes of each set whose range on the axis may still overlap the next box.
+	TArray<int32> Active[2];
+	for (const FEvent& Event : Events)
+	{
+		const FBox& Box = (Event.Set == 0 ? BoxesA : BoxesB)[Event.Index];
+		const TConstArrayView<FBox> OtherBoxes = Event.Set == 0 ? BoxesB : BoxesA;
+		TArray<int32>& Others = Active[1 - Event.Set];
+		for (int32 i = 0; i < Others.Num();)
+		{
+			const FBox& Other = OtherBoxes[Others[i]];
+			//Ends before this box starts, so before every later box starts too.
+			if (Other.Max[Axis] < Event.Min)
+			{
+				Others.RemoveAtSwap(i);
+				continue;
+			}
+			if (Box.Intersect(Other))
+			{
+				OutPairs.Emplace(Event.Set == 0 ? Event.Index : Others[i], Event.Set == 0 ? Others[i] : Event.Index);
+			}
+			i++;
+		}
+		Active[Event.Set].Add(Event.Index);
+	}
+}
+
+uint32 UFAWorldSubsystem::GetColliderSizeClass(const FVector& ColliderSize,
+                                               const FVector& ColliderOffset)
+{
+	UE::TScopeLock Lock(ColliderSizeClassesLock);
+	const TPair<FVector, FVector> Key(ColliderSize, ColliderOffset);
+	if (const uint32* SizeClass = ColliderSizeClasses.Find(Key)) return *SizeClass;
+	//Colliders of continuously varying sizes would grow the table without bound.
+	if (ColliderSizeClasses.Num() >= Settings->MaxColliderSizeClasses) return INDEX_NONE;
+	MaxColliderReach = FMath::Max(MaxColliderReach,
+	                              ColliderSize.GetAbsMax() + ColliderOffset.GetAbsMax());
+	return ColliderSizeClasses.Add(Key, ColliderSizeClasses.Num());
+}
+
+void UFAWorldSubsystem::NotifyEnvironmentChanged(const FBox& Box)
+{
+	double Reach;
+	{
+		UE::TScopeLock Lock(ColliderSizeClassesLock);
+		Reach = MaxColliderReach;
+	}
+	//Edges are tested by boxes reaching out of the bound by the collider size.
+	for (auto Bound : FindBoundsInBox(Box.ExpandBy(Reach)))
+	{
+		Bound->GetEdgeClearanceCache().Invalidate();
+		Bound->InvalidateNodeClearance();
+	}
+}
+
+void UFAWorldSubsystem::InvalidateEdgeClearanceCaches()
+{
+	UE::TScopeLock Lock(RegisteredBoundLock);
+	for (auto Bound : RegisteredBound)
+	{
+		if (!Bound) continue;
+		Bound->GetEdgeClearanceCache().Invalidate();
+	}
+}
+
+FFAEdgeClearanceCacheStats UFAWorldSubsystem::GetEdgeClearanceCacheStats()
+{
+	FFAEdgeClearanceCacheStats Stats;
+	UE::TScopeLock Lock(RegisteredBoundLock);
+	for (auto Bound : RegisteredBound)
+	{
+		if (!Bound) continue;
+		Stats += Bound->GetEdgeClearanceCacheStats();
+	}
+	return Stats;
+}
+
+int32 UFAWorldSubsystem::AddDynamicObstacle(const FBox& Box)
+{
+	int32 ObstacleId;
+	{
+		FWriteScopeLock Lock(DynamicObstaclesLock);
+		ObstacleId = NextDynamicObstacleId++;
+		DynamicObstacles.Add(ObstacleId);
+	}
+	SetDynamicObstacle(ObstacleId, &Box);
+	return ObstacleId;
+}
+
+void UFAWorldSubsystem::UpdateDynamicObstacle(int32 ObstacleId, const FBox& Box)
+{
+	SetDynamicObstacle(ObstacleId, &Box);
+}
+
+void UFAWorldSubsystem::RemoveDynamicObstacle(int32 ObstacleId)
+{
+	SetDynamicObstacle(ObstacleId, nullptr);
+}
+
+bool UFAWorldSubsystem::OverlapsDynamicObstacle(const FBox& Box)
+{
+	FReadScopeLock Lock(DynamicObstaclesLock);
+	for (auto& Obstacle : DynamicObstacles)
+	{
+		const FBox& Other = Obstacle.Value.Box;
+		if (Box.Min.X < Other.Max.X && Other.Min.X < Box.Max.X && Box.Min.Y < Other.Max.Y &&
+			Other.Min.Y < Box.Max.Y && Box.Min.Z < Other.Max.Z && Other.Min.Z < Box.Max.Z)
+			return true;
+	}
+	return false;
+}
+
+void UFAWorldSubsystem::SetDynamicObstacle(int32 ObstacleId, const FBox* Box)
+{
+	//Searches read the obstacles with the nodes data of their bounds locked, so nav data is not got with the
+	//obstacles locked.
+	TArray<TWeakObjectPtr<AFABound>> OldBounds;
+	{
+		FWriteScopeLock Lock(DynamicObstaclesLock);
+		FFADynamicObstacle* Obstacle = DynamicObstacles.Find(ObstacleId);
+		if (!Obstacle) return;
+		OldBounds = MoveTemp(Obstacle->Bounds);
+		if (Box) Obstacle->Box = *Box;
+		else DynamicObstacles.Remove(ObstacleId);
+	}
+	TMap<AFABound*, TArray<uint32>> ChangedNodes;
+	for (auto& Bound : OldBounds)
+	{
+		if (Bound.IsValid())
+			Bound->GetObstacleOverlay().RemoveObstacle(ObstacleId, ChangedNodes.FindOrAdd(Bound.Get()));
+	}
+	if (Box)
+	{
+		TArray<TWeakObjectPtr<AFABound>> Bounds;
+		for (auto Bound : FindBoundsInBox(*Box))
+		{
+			//Kept for the bounds not loaded too, they are blocked by ApplyDynamicObstacles when loaded.
+			Bounds.Add(Bound);
+			Bound->GetObstacleOverlay().SetObstacleBox(ObstacleId, *Box);
+			const UFANavOctreeData* NavData = Bound->GetNavData();
+			if (!NavData) continue;
+			const FVector Offset = Bound->GetActorLocation() - Bound->GetBoundData()->GeneratePosition;
+			Bound->GetObstacleOverlay().AddObstacle(ObstacleId, Box->ShiftBy(-Offset), NavData,
+			                                        ChangedNodes.FindOrAdd(Bound));
+		}
+		FWriteScopeLock Lock(DynamicObstaclesLock);
+		if (FFADynamicObstacle* Obstacle = DynamicObstacles.Find(ObstacleId)) Obstacle->Bounds = MoveTemp(Bounds);
+	}
+	for (auto& Changed : ChangedNodes)
+	{
+		UpdateObstacleClusters(Changed.Key, Changed.Value);
+	}
+}
+
+void UFAWorldSubsystem::ApplyDynamicObstacles(AFABound* Bound)
+{
+	const UFANavOctreeData* NavData = Bound->GetNavData();
+	if (!NavData || !Bound->GetBoundData()) return;
+	TArray<uint32> ChangedNodes;
+	//Nodes blocked in other nodes data may be open now, every HPA node of the bound is recomputed.
+	if (Bound->ResetObstacleOverlay(NavData))
+	{
+		ChangedNodes.SetNumUninitialized(NavData->Num());
+		for (int32 i = 0; i < ChangedNodes.Num(); i++)
+		{
+			ChangedNodes[i] = i;
+		}
+	}
+	TArray<TPair<int32, FBox>> Obstacles;
+	{
+		FReadScopeLock Lock(DynamicObstaclesLock);
+		const TWeakObjectPtr<AFABound> WeakBound(Bound);
+		for (auto& Obstacle : DynamicObstacles)
+		{
+			if (Obstacle.Value.Bounds.Contains(WeakBound)) Obstacles.Emplace(Obstacle.Key, Obstacle.Value.Box);
+		}
+	}
+	const FVector Offset = Bound->GetActorLocation() - Bound->GetBoundData()->GeneratePosition;
+	for (auto& Obstacle : Obstacles)
+	{
+		//Obstacles still blocking the nodes since before an unload are skipped by the overlay.
+		Bound->GetObstacleOverlay().AddObstacle(Obstacle.Key, Obstacle.Value.ShiftBy(-Offset), NavData,
+		                                        ChangedNodes);
+	}
+	UpdateObstacleClusters(Bound, ChangedNodes);
+}
+
+void UFAWorldSubsystem::UpdateObstacleClusters(AFABound* Bound, const TArray<uint32>& ChangedNodes)
+{
+	if (ChangedNodes.Num() == 0) return;
+	const UFANavOctreeData* NavData = Bound->GetNavData();
+	if (!NavData) return;
+	const double StartTime = FPlatformTime::Seconds();
+	const auto& LocalToGlobal = Bound->GetLocalToGlobalHPANodes();
+	TSet<uint32> LocalClusters, Clusters;
+	for (const uint32 Node : ChangedNodes)
+	{
+		const uint32 LocalCluster = NavData->GetHPANodeIndex(Node);
+		if (LocalCluster == INDEX_NONE || !LocalToGlobal.Contains(LocalCluster)) continue;
+		LocalClusters.Add(LocalCluster);
+		Clusters.Add(LocalToGlobal[LocalCluster]);
+	}
+	if (Clusters.Num() == 0) return;
+
+	auto IsOpen = [](const UFANavOctreeData* Data, const AFABound* DataBound, uint32 Node)
+	{
+		return Data->IsTraversable(Node) && Data->GetHPANodeIndex(Node) != INDEX_NONE && !DataBound->
+			GetObstacleOverlay().IsBlocked(Node);
+	};
+	//Sum and count of the centres of the faces shared by each pair of HPA nodes, the smaller one first.
+	TMap<TPair<uint32, uint32>, TPair<FVector, int32>> Faces;
+	auto AddFace = [&Faces](uint32 ClusterA, uint32 ClusterB, const FVector& Centre)
+	{
+		auto& Face = Faces.FindOrAdd(TPair<uint32, uint32>(FMath::Min(ClusterA, ClusterB),
+		                                                   FMath::Max(ClusterA, ClusterB)),
+		                             TPair<FVector, int32>(FVector::ZeroVector, 0));
+		Face.Key += Centre;
+		Face.Value++;
+	};
+	const FVector Offset = Bound->GetActorLocation() - Bound->GetBoundData()->GeneratePosition;
+	for (uint32 Node = 0; Node < (uint32)NavData->Num(); Node++)
+	{
+		const uint32 LocalCluster = NavData->GetHPANodeIndex(Node);
+		if (!LocalClusters.Contains(LocalCluster) || !IsOpen(NavData, Bound, Node)) continue;
+		for (const uint32 Neighbour : NavData->GetNeighbours(Node))
+		{
+			const uint32 NeighbourCluster = NavData->GetHPANodeIndex(Neighbour);
+			if (NeighbourCluster == LocalCluster || !IsOpen(NavData, Bound, Neighbour)) continue;
+			//Faces between two changed clusters are found from both, keep one.
+			if (LocalClusters.Contains(NeighbourCluster) && NeighbourCluster < LocalCluster) continue;
+			AddFace(LocalToGlobal[LocalCluster], LocalToGlobal[NeighbourCluster],
+			        AABBOverlapCentre(NavData->GetPosition(Node), NavData->GetPosition(Neighbour),
+			                          NavData->GetHalfExtent(Node), NavData->GetHalfExtent(Neighbour)) + Offset);
+		}
+	}
+	for (const UFANeighbourData* Data : Bound->GetNeighboursData())
+	{
+		const bool bBound0 = Data->Bound[0] == Bound;
+		AFABound* Other = bBound0 ? Data->Bound[1] : Data->Bound[0];
+		const UFANavOctreeData* OtherNavData = Other ? Other->GetNavData() : nullptr;
+		if (!OtherNavData) continue;
+		const FVector OtherOffset = Other->GetActorLocation() - Other->GetBoundData()->GeneratePosition;
+		for (auto& Connection : bBound0 ? Data->Connection0 : Data->Connection1)
+		{
+			const uint32 Node = Connection.Key;
+			if (!LocalClusters.Contains(NavData->GetHPANodeIndex(Node)) || !IsOpen(NavData, Bound, Node)) continue;
+			for (const uint32 Connected : Connection.Value.Connected)
+			{
+				if (!IsOpen(OtherNavData, Other, Connected)) continue;
+				//Missing once the other bound is unregistered meanwhile.
+				const uint32* OtherCluster = Other->GetLocalToGlobalHPANodes().Find(
+					OtherNavData->GetHPANodeIndex(Connected));
+				if (!OtherCluster) continue;
+				AddFace(LocalToGlobal[NavData->GetHPANodeIndex(Node)], *OtherCluster,
+				        AABBOverlapCentre(NavData->GetPosition(Node) + Offset,
+				                          OtherNavData->GetPosition(Connected) + OtherOffset,
+				                          NavData->GetHalfExtent(Node), OtherNavData->GetHalfExtent(Connected)));
+			}
+		}
+	}
+	{
+		FWriteScopeLock Lock(HPAGraphLock);
+		HPAGraph.RemoveClusters(Clusters);
+		for (auto& Face : Faces)
+		{
+			HPAGraph.AddPortal(Face.Key.Key, Face.Key.Value, Face.Value.Key / Face.Value.Value);
+		}
+	}
+	UE_LOG(LogFAWorldSubsystem, Verbose, TEXT("Updated %d HPA nodes of %s around obstacles, %d Portals in %.2f ms"),
+	       Clusters.Num(), *Bound->GetName(), Faces.Num(), (FPlatformTime::Seconds() - StartTime) * 1000);
+}
+
+void UFAWorldSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	PathQueryScheduler.Tick(Settings->PathQueryFrameBudgetMicroseconds / 1e6, Settings->PathQueryExpansionsPerStep);
+}
+
+TStatId UFAWorldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFAWorldSubsystem, STATGROUP_Tickables);
+}
+
+void UFAWorldSubsystem::OnEnvironmentActorChanged(AActor* Actor)
+{
+	if (AFABound* Bound = Cast<AFABound>(Actor); Bound && Bound->IsActorBeingDestroyed())
+	{
+		UnregisterBoundInWorld(Bound);
+		return;
+	}
+	if (!Actor || !Settings || !Actor->IsA(Settings->EnvironmentActorClass)) return;
+	NotifyEnvironmentChanged(Actor->GetComponentsBoundingBox(true));
+}
+
 FFAFinePath UFAWorldSubsystem::CreateFinePathByHPA(FFAHPAPath HPAPath, const FVector ColliderSize,
                                                    const FVector& ColliderOffset)
 {
@@ -582,18 +1170,11 @@ TFuture<FFAFinePath> UFAWorldSubsystem::CreateFinePathByHPAAsync(FFAHPAPath& HPA
                                                                  const FVector& ColliderSize,
                                                                  const FVector& ColliderOffset)
 {
-	auto AResult = AsyncPool(*ThreadPool, [this, HPAPath, ColliderSize, ColliderOffset]
+	auto AResult = LaunchOnThreadPool([this, HPAPath, ColliderSize, ColliderOffset]
 	{
-		FFAFinePath Result{};
-		if (HPAPath.HPANodes.Num() == 0) return Result;
-		Result.HPAPath = HPAPath;
-		Result.CurrentHPANodeIndex = 0;
-		Result.LocalStartNode = HPAPath.StartNode;
-		Result.LocalStartLocation = HPAPath.StartLocation;
-
-		PathfindingAlgo->GeneratePath(Result, HPAPath.EndNode, GetWorld(), Settings, ColliderSize,
-		                              ColliderOffset);
-		return Result;
+		if (HPAPath.HPANodes.Num() == 0) return FFAFinePath{};
+		return RunPathQuery(PathfindingAlgo->CreatePathQuery(MakeFinePathByHPA(HPAPath), HPAPath.EndNode, GetWorld(),
+		                                                     Settings, ColliderSize, ColliderOffset));
 	});
 	return AResult;
 }
@@ -612,32 +1193,162 @@ FFAFinePath UFAWorldSubsystem::CreateNextFinePath(const FFAFinePath& InFinePath,
 TFuture<FFAFinePath> UFAWorldSubsystem::CreateNextFinePathAsync(
 	const FFAFinePath& InFinePath, const FVector& ColliderSize, const FVector& ColliderOffset)
 {
-	return AsyncPool(*ThreadPool, [this, InFinePath, ColliderSize,ColliderOffset]
+	return LaunchOnThreadPool([this, InFinePath, ColliderSize, ColliderOffset]
 	{
-		if (!InFinePath.bIsSuccess) return InFinePath;
-
 		FFAFinePath Result;
-		Result.HPAPath = InFinePath.HPAPath;
-		Result.CurrentHPANodeIndex = InFinePath.CurrentHPANodeIndex + 1;
-		Result.bBoundLoaded = true;
-		if (Result.CurrentHPANodeIndex >= InFinePath.HPAPath.HPANodes.Num()) return Result;
-		if (!Result.HPAPath.HPAAssociateBounds[Result.CurrentHPANodeIndex]->GetNodesData() || !
-			Result.HPAPath.HPAAssociateBounds[InFinePath.CurrentHPANodeIndex]->GetNodesData())
-		{
-			Result.bBoundLoaded = false;
-			return Result;
-		}
-		Result.bBoundLoaded = true;
-		Result.LocalStartNode = InFinePath.Nodes.Last();
-		Result.LocalStartLocation = InFinePath.InterpolatedPoints.Last();
+		if (!MakeNextFinePath(InFinePath, Result)) return Result;
 
-		PathfindingAlgo->GeneratePath(Result, InFinePath.HPAPath.EndNode, GetWorld(), Settings,
-		                              ColliderSize, ColliderOffset);
+		Result = RunPathQuery(PathfindingAlgo->CreatePathQuery(MoveTemp(Result), InFinePath.HPAPath.EndNode,
+		                                                       GetWorld(), Settings, ColliderSize, ColliderOffset));
 		Result.ControlPoints.Insert(InFinePath.InterpolatedPoints.Last(), 0);
 		return Result;
 	});
 }
 
+FFAFinePath UFAWorldSubsystem::RunPathQuery(const TSharedRef<FFAPathQuery>& Query) const
+{
+	Query->SetToken(MakeShared<FFAPathQueryToken, ESPMode::ThreadSafe>(PathQueryToken));
+	Query->Run();
+	return MoveTemp(Query->GetFinePath());
+}
+
+FFAFinePath UFAWorldSubsystem::MakeFinePathByHPA(const FFAHPAPath& HPAPath)
+{
+	FFAFinePath Result{};
+	Result.HPAPath = HPAPath;
+	Result.CurrentHPANodeIndex = 0;
+	Result.LocalStartNode = HPAPath.StartNode;
+	Result.LocalStartLocation = HPAPath.StartLocation;
+	return Result;
+}
+
+bool UFAWorldSubsystem::MakeNextFinePath(const FFAFinePath& InFinePath, FFAFinePath& OutFinePath)
+{
+	if (!InFinePath.bIsSuccess)
+	{
+		OutFinePath = InFinePath;
+		return false;
+	}
+	OutFinePath = FFAFinePath();
+	OutFinePath.HPAPath = InFinePath.HPAPath;
+	OutFinePath.CurrentHPANodeIndex = InFinePath.CurrentHPANodeIndex + 1;
+	OutFinePath.bBoundLoaded = true;
+	if (OutFinePath.CurrentHPANodeIndex >= InFinePath.HPAPath.HPANodes.Num()) return false;
+	if (!OutFinePath.HPAPath.HPAAssociateBounds[OutFinePath.CurrentHPANodeIndex]->GetNavData() || !
+		OutFinePath.HPAPath.HPAAssociateBounds[InFinePath.CurrentHPANodeIndex]->GetNavData())
+	{
+		OutFinePath.bBoundLoaded = false;
+		return false;
+	}
+	OutFinePath.LocalStartNode = InFinePath.Nodes.Last();
+	OutFinePath.LocalStartLocation = InFinePath.InterpolatedPoints.Last();
+	return true;
+}
+
+int32 UFAWorldSubsystem::RequestFinePathByHPA(const FFAHPAPath& HPAPath, FFAOnPathQueryFinished OnFinished,
+                                              const FVector& ColliderSize, const FVector& ColliderOffset,
+                                              EFAPathQueryPriority Priority, const UObject* Owner)
+{
+	const TSharedRef<FFAPathQuery> Query = HPAPath.HPANodes.Num() > 0
+		                                       ? PathfindingAlgo->CreatePathQuery(
+			                                       MakeFinePathByHPA(HPAPath), HPAPath.EndNode, GetWorld(), Settings,
+			                                       ColliderSize, ColliderOffset)
+		                                       : FFAPathQuery::MakeFinished(FFAFinePath());
+	return SchedulePathQuery(Query, ColliderSize, ColliderOffset, Priority, Owner, MoveTemp(OnFinished));
+}
+
+int32 UFAWorldSubsystem::RequestNextFinePath(const FFAFinePath& InFinePath, FFAOnPathQueryFinished OnFinished,
+                                             const FVector& ColliderSize, const FVector& ColliderOffset,
+                                             EFAPathQueryPriority Priority, const UObject* Owner)
+{
+	FFAFinePath Result;
+	if (!MakeNextFinePath(InFinePath, Result))
+	{
+		return SchedulePathQuery(FFAPathQuery::MakeFinished(MoveTemp(Result)), ColliderSize, ColliderOffset,
+		                         Priority, Owner, MoveTemp(OnFinished));
+	}
+	const TSharedRef<FFAPathQuery> Query = PathfindingAlgo->CreatePathQuery(
+		MoveTemp(Result), InFinePath.HPAPath.EndNode, GetWorld(), Settings, ColliderSize, ColliderOffset);
+	//Continue from the end of the path it follows.
+	const FVector StartControlPoint = InFinePath.InterpolatedPoints.Last();
+	FFAOnPathQueryFinished OnNextFinished = FFAOnPathQueryFinished::CreateLambda(
+		[OnFinished = MoveTemp(OnFinished), StartControlPoint](const FFAFinePath& FinePath)
+		{
+			FFAFinePath NextFinePath = FinePath;
+			NextFinePath.ControlPoints.Insert(StartControlPoint, 0);
+			OnFinished.ExecuteIfBound(NextFinePath);
+		});
+	return SchedulePathQuery(Query, ColliderSize, ColliderOffset, Priority, Owner, MoveTemp(OnNextFinished));
+}
+
+int32 UFAWorldSubsystem::K2_RequestFinePathByHPA(const FFAHPAPath& HPAPath,
+                                                 const FFAOnPathQueryFinishedDynamic& OnFinished,
+                                                 FVector ColliderSize, FVector ColliderOffset,
+                                                 EFAPathQueryPriority Priority, UObject* Owner)
+{
+	return RequestFinePathByHPA(HPAPath, FFAOnPathQueryFinished::CreateLambda(
+		                            [OnFinished](const FFAFinePath& FinePath)
+		                            {
+			                            OnFinished.ExecuteIfBound(FinePath);
+		                            }), ColliderSize, ColliderOffset, Priority, Owner);
+}
+
+int32 UFAWorldSubsystem::K2_RequestNextFinePath(const FFAFinePath& InFinePath,
+                                                const FFAOnPathQueryFinishedDynamic& OnFinished,
+                                                FVector ColliderSize, FVector ColliderOffset,
+                                                EFAPathQueryPriority Priority, UObject* Owner)
+{
+	return RequestNextFinePath(InFinePath, FFAOnPathQueryFinished::CreateLambda(
+		                           [OnFinished](const FFAFinePath& FinePath)
+		                           {
+			                           OnFinished.ExecuteIfBound(FinePath);
+		                           }), ColliderSize, ColliderOffset, Priority, Owner);
+}
+
+int32 UFAWorldSubsystem::SchedulePathQuery(const TSharedRef<FFAPathQuery>& Query, const FVector& ColliderSize,
+                                           const FVector& ColliderOffset, EFAPathQueryPriority Priority,
+                                           const UObject* Owner, FFAOnPathQueryFinished OnFinished)
+{
+	TOptional<FFAPathQueryKey> Key;
+	const uint32 ColliderSizeClass = GetColliderSizeClass(ColliderSize, ColliderOffset);
+	if (FFAPathQueryKey SegmentKey; ColliderSizeClass != INDEX_NONE && Query->GetKey(ColliderSizeClass, SegmentKey))
+	{
+		Key = SegmentKey;
+	}
+	return PathQueryScheduler.Schedule(Query, Key, Priority, FObjectKey(Owner), Settings->MaxQueuedPathSearches,
+	                                   MoveTemp(OnFinished));
+}
+
+void UFAWorldSubsystem::CancelPathQuery(int32 QueryId)
+{
+	PathQueryScheduler.Cancel(QueryId);
+}
+
+void UFAWorldSubsystem::CancelPathQueriesOf(const UObject* Owner)
+{
+	PathQueryScheduler.CancelOwner(FObjectKey(Owner));
+}
+
+bool UFAWorldSubsystem::IsPathQueryPending(int32 QueryId)
+{
+	return PathQueryScheduler.IsPending(QueryId);
+}
+
+int32 UFAWorldSubsystem::GetNumPendingPathQueries()
+{
+	return PathQueryScheduler.Num();
+}
+
+FFAPathQuerySchedulerStats UFAWorldSubsystem::GetPathQueryStats(EFAPathQueryPriority Priority)
+{
+	return PathQueryScheduler.GetStats(Priority);
+}
+
+void UFAWorldSubsystem::ResetPathQueryStats()
+{
+	PathQueryScheduler.ResetStats();
+}
+
 void UFAWorldSubsystem::InterpolateFinePath(FFAFinePath& InFinePath)
 {
 	if (!InFinePath.bIsSuccess) return;
@@ -680,41 +1391,150 @@ FFAPathNodeData UFAWorldSubsystem::PointToNodeInBound(FVector Point, AFABound* B
 	FVector BoundPosition = Bound->GetActorLocation();
 	if (!UKismetMathLibrary::IsPointInBox(Point, BoundPosition, Bound->GetHalfExtent())) return
 		FFAPathNodeData();
+	//Held while reading the nodes, an unload may unmap them meanwhile.
+	FReadScopeLock Lock(Bound->GetNodesDataLock());
 	//Bound is not loaded.
-	if (!Bound->GetNodesData()) return FFAPathNodeData();;
-	FFaNodeData* RData = nullptr;
+	const UFANavOctreeData* NavData = Bound->GetNavDataLocked();
+	if (!NavData) return FFAPathNodeData();
 	FFAPathNodeData Result;
 	FVector Transformed = BoundPosition - Bound->GetBoundData()->GeneratePosition;
 	Result.NodeBound = Bound;
-	for (auto row : Bound->GetNodesData()->GetRowMap())
+	const uint32 NodeIndex = NavData->FindNode(Point - Transformed);
+	if (NodeIndex == FFANodeHandle::InvalidIndex) return FFAPathNodeData();
+	Result.Handle = Bound->MakeNodeHandle(NodeIndex);
+	Result.NodeData = NavData->MakeNodeData(NodeIndex);
+	Result.NodeData.IsTraversable &= !Bound->GetObstacleOverlay().IsBlocked(NodeIndex);
+	//Resolved when the bound was registered, the local HPA node may be missing from the global ones meanwhile.
+	Result.NodeData.HPANodeIndex = Bound->HasSearchNodesLocked() ? Bound->GetNodeGlobalHPANode(NodeIndex) : INDEX_NONE;
+	Result.NodeData.Position += Transformed;
+	return Result;
+}
+
+AFABound* UFAWorldSubsystem::GetBoundByHandle(const FFANodeHandle& Handle)
+{
+	UE::TScopeLock Lock(RegisteredBoundLock);
+	return RegisteredBound.IsValidIndex(static_cast<int32>(Handle.BoundIndex))
+		       ? RegisteredBound[Handle.BoundIndex]
+		       : nullptr;
+}
+
+bool UFAWorldSubsystem::IsNodeOccupied(FFaNodeData* NodeData, const FFAOccupancyGrid* Grid,
+                                       UWorld* World) const
+{
+	if (!Grid || Grid->IsEmpty())
+		return IsNodeOverlapping(NodeData, Settings->ObjectTypes, Settings->EnvironmentActorClass,
+		                         ActorsToIgnore, World);
+	//Top level nodes are depth 0, one level below the bound.
+	if (Grid->IsOccupied(NodeData->Depth + 1, NodeData->Position)) return true;
+	return Grid->NeedsQuery(FBox::BuildAABB(NodeData->Position, NodeData->HalfExtent)) &&
+		IsNodeOverlapping(NodeData, Settings->ObjectTypes, Settings->EnvironmentActorClass, ActorsToIgnore,
+		                  World);
+}
+
+namespace
+{
+	/** Corners of a unit box by the bits of their index, x in the lowest bit. */
+	void AddBoxShape(const FTransform& Transform, const FVector& Extent, FFAOccupancyShapes& OutShapes)
 	{
-		auto Node = reinterpret_cast<FFaNodeData*>(row.Value);
-		if (UKismetMathLibrary::IsPointInBox(Point, Node->Position + Transformed, Node->HalfExtent))
+		static const TArray<int32> Indices{
+			0, 2, 6, 0, 6, 4, 1, 3, 7, 1, 7, 5, 0, 1, 5, 0, 5, 4,
+			2, 3, 7, 2, 7, 6, 0, 1, 3, 0, 3, 2, 4, 5, 7, 4, 7, 6
+		};
+		FFAOccupancyShapes::FConvex& Convex = OutShapes.Convexes.AddDefaulted_GetRef();
+		for (int32 i = 0; i < 8; i++)
 		{
-			if (RData)
+			Convex.Vertices.Add(Transform.TransformPosition(
+				Extent * FVector(i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1)));
+		}
+		Convex.Indices = Indices;
+	}
+
+	void AddComponentShapes(const UPrimitiveComponent* Component, FFAOccupancyShapes& OutShapes)
+	{
+		UBodySetup* BodySetup = Component->GetBodySetup();
+		const FTransform& Transform = Component->GetComponentTransform();
+		if (!BodySetup)
+		{
+			OutShapes.FallbackBoxes.Add(Component->Bounds.GetBox());
+			return;
+		}
+		if (BodySetup->GetCollisionTraceFlag() == CTF_UseComplexAsSimple)
+		{
+			//Triangle meshes are surfaces, a node inside one doesn't overlap it.
+			IInterface_CollisionDataProvider* Provider = Cast<IInterface_CollisionDataProvider>(
+				BodySetup->GetOuter());
+			FTriMeshCollisionData TriMesh;
+			if (!Provider || !Provider->ContainsPhysicsTriMeshData(true) ||
+				!Provider->GetPhysicsTriMeshData(&TriMesh, true))
 			{
-				if (FVector::DistSquared(Point, Node->Position) < FVector::DistSquared(
-					Point, RData->Position))
-				{
-					Result.NodeName = row.Key;
-					RData = Node;
-				}
+				OutShapes.FallbackBoxes.Add(Component->Bounds.GetBox());
+				return;
 			}
-			else
+			for (const FTriIndices& Triangle : TriMesh.Indices)
 			{
-				Result.NodeName = row.Key;
-				RData = Node;
+				OutShapes.Triangles.Add(Transform.TransformPosition(FVector(TriMesh.Vertices[Triangle.v0])));
+				OutShapes.Triangles.Add(Transform.TransformPosition(FVector(TriMesh.Vertices[Triangle.v1])));
+				OutShapes.Triangles.Add(Transform.TransformPosition(FVector(TriMesh.Vertices[Triangle.v2])));
 			}
+			return;
+		}
+		const FKAggregateGeom& AggGeom = BodySetup->AggGeom;
+		for (const FKBoxElem& Box : AggGeom.BoxElems)
+		{
+			AddBoxShape(Box.GetTransform() * Transform, FVector(Box.X, Box.Y, Box.Z) / 2, OutShapes);
 		}
+		for (const FKConvexElem& Convex : AggGeom.ConvexElems)
+		{
+			const FTransform ElemTransform = Convex.GetTransform() * Transform;
+			if (Convex.IndexData.Num() == 0)
+			{
+				//Faces are not kept, use the box of the hull.
+				const FBox Box(Convex.VertexData);
+				AddBoxShape(FTransform(Box.GetCenter()) * ElemTransform, Box.GetExtent(), OutShapes);
+				continue;
+			}
+			FFAOccupancyShapes::FConvex& Shape = OutShapes.Convexes.AddDefaulted_GetRef();
+			for (const FVector& Vertex : Convex.VertexData)
+			{
+				Shape.Vertices.Add(ElemTransform.TransformPosition(Vertex));
+			}
+			Shape.Indices = Convex.IndexData;
+		}
+		for (const FKSphereElem& Sphere : AggGeom.SphereElems)
+		{
+			//Spheres scale by the smallest axis, as physics does.
+			OutShapes.Spheres.Emplace(Transform.TransformPosition(Sphere.Center),
+			                          Sphere.Radius * Transform.GetScale3D().GetAbsMin());
+		}
+		//Capsules and other elements are queried instead.
+		if (AggGeom.GetElementCount() > AggGeom.BoxElems.Num() + AggGeom.ConvexElems.Num() + AggGeom.SphereElems.
+			Num())
+			OutShapes.FallbackBoxes.Add(Component->Bounds.GetBox());
 	}
+}
 
-	Result.NodeData = *RData;
-	Result.NodeData.HPANodeIndex = Result.NodeData.HPANodeIndex == INDEX_NONE
-		                               ? INDEX_NONE
-		                               : Result.NodeBound->GetLocalToGlobalHPANodes()[Result.
-			                               NodeData.HPANodeIndex];
-	Result.NodeData.Position += Transformed;
-	return Result;
+void UFAWorldSubsystem::GatherOccupancyShapes(UWorld* World, const FBox& Bounds,
+                                              FFAOccupancyShapes& OutShapes) const
+{
+	check(IsInGameThread());
+	TSet<ECollisionChannel> Channels;
+	for (auto ObjectType : Settings->ObjectTypes)
+	{
+		Channels.Add(UEngineTypes::ConvertToCollisionChannel(ObjectType));
+	}
+	UClass* ActorClass = Settings->EnvironmentActorClass ? *Settings->EnvironmentActorClass : AActor::StaticClass();
+	for (TActorIterator<AActor> It(World, ActorClass); It; ++It)
+	{
+		if (ActorsToIgnore.Contains(*It)) continue;
+		TInlineComponentArray<UPrimitiveComponent*> Components(*It);
+		for (const UPrimitiveComponent* Component : Components)
+		{
+			if (!CollisionEnabledHasQuery(Component->GetCollisionEnabled()) || !Channels.Contains(
+				Component->GetCollisionObjectType()) || !Component->Bounds.GetBox().Intersect(Bounds))
+				continue;
+			AddComponentShapes(Component, OutShapes);
+		}
+	}
 }
 
 bool UFAWorldSubsystem::IsNodeOverlapping(FFaNodeData* NodeData,
@@ -729,6 +1549,43 @@ bool UFAWorldSubsystem::IsNodeOverlapping(FFaNodeData* NodeData,
 	return Actors.Num() > 0;
 }
 
+float UFAWorldSubsystem::ComputeNodeClearance(const FFaNodeData* NodeData, float MaxClearance,
+                                              int32 RefinementSteps,
+                                              const TArray<TEnumAsByte<EObjectTypeQuery>>&
+                                              ObjectTypes,
+                                              TSubclassOf<AActor> ActorClassToConsider,
+                                              const TArray<AActor*>& ActorsToIgnore,
+                                              UWorld* World)
+{
+	auto IsFree = [&](float Clearance)
+	{
+		TArray<AActor*> Actors;
+		return !UKismetSystemLibrary::BoxOverlapActors(World, NodeData->Position, FVector(Clearance),
+		                                               ObjectTypes, ActorClassToConsider,
+		                                               ActorsToIgnore, Actors);
+	};
+	//The node itself is free, so is the largest cube inside it.
+	float Free = NodeData->HalfExtent.GetMin();
+	float Blocked = Free * 2;
+	while (Blocked < MaxClearance && IsFree(Blocked))
+	{
+		Free = Blocked;
+		Blocked *= 2;
+	}
+	if (Blocked >= MaxClearance)
+	{
+		if (IsFree(MaxClearance)) return MaxClearance;
+		Blocked = MaxClearance;
+	}
+	for (int32 i = 0; i < RefinementSteps; i++)
+	{
+		const float Mid = (Free + Blocked) / 2;
+		if (IsFree(Mid)) Free = Mid;
+		else Blocked = Mid;
+	}
+	return Free;
+}
+
 // BEGIN_DEFINE_SPEC(FGenerateBranchTest,
 //                   "FlyingAIPlugin.FACore.FANewWorldSubsystem.GenerateBranchTest",
 //                   EAutomationTestFlags::ProductFilter | EAutomationTestFlags::
@@ -4,6 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "FABoundData.h"
+#include "FADynamicObstacleOverlay.h"
+#include "FAEdgeClearanceCache.h"
+#include "FANodeHandle.h"
+#include "FANavOctreeData.h"
+#include "FAPathQueryToken.h"
 #include "Components/BoxComponent.h"
 #include "Engine/StreamableManager.h"
 #include "GameFramework/Actor.h"
@@ -13,6 +18,7 @@
 #include "FABound.generated.h"
 
 class UFANeighbourData;
+struct FFaNodeData;
 
 UCLASS()
 class FACORE_API AFABound : public AActor
@@ -31,12 +37,15 @@ public:
 
 	TSharedPtr<FStreamableHandle> GetNodeData();
 
+	/** The loaded nodes data, nullptr if not loaded. */
 	UFUNCTION(BlueprintCallable, Category = "FA|Bound")
-	UDataTable* GetNodesData()
+	UFANavOctreeData* GetNavData()
 	{
-		UE::TScopeLock Lock(NodesDataLock);
-		return NodesData;
+		FReadScopeLock Lock(NodesDataLock);
+		return NavData;
 	}
+	/** The loaded nodes data, for callers already holding the nodes data lock, which is not reentrant. */
+	UFANavOctreeData* GetNavDataLocked() const { return NavData; }
 
 	UFUNCTION(BlueprintCallable, Category = "FA|Bound")
 	void SetLOD(uint8 InLOD);
@@ -82,20 +91,98 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "FA|Bound")
 	/** Unload Nodes data associate with the bound sync. */
 	void UnloadNodes();
+	/** Use nodes data built in memory instead of loading the one of the bound data, e.g. by tests. */
+	void SetNavData(UFANavOctreeData* InNavData);
+
+	/** Index of the bound in the world subsystem, \c FFANodeHandle::InvalidIndex if not registered. */
+	uint32 GetBoundIndex() const { return BoundIndex; }
+	void SetBoundIndex(uint32 InBoundIndex) { BoundIndex = InBoundIndex; }
+
+	/** Number of nodes in the loaded nodes data. */
+	uint32 GetNumNodes() const { return NavData ? NavData->Num() : 0; }
+	FFANodeHandle MakeNodeHandle(uint32 NodeIndex) const { return FFANodeHandle(BoundIndex, NodeIndex); }
+	/** Index of the leaf containing a location in generation space, \c FFANodeHandle::InvalidIndex if not loaded. */
+	uint32 FindNodeIndex(const FVector& GeneratedLocation) const
+	{
+		return NavData ? NavData->FindNode(GeneratedLocation) : FFANodeHandle::InvalidIndex;
+	}
+
+	/** Collider overlap results of edges starting in this bound. */
+	FFAEdgeClearanceCache& GetEdgeClearanceCache() { return EdgeClearanceCache; }
+	UFUNCTION(BlueprintCallable, Category = "FA|Bound")
+	FFAEdgeClearanceCacheStats GetEdgeClearanceCacheStats() const
+	{
+		return EdgeClearanceCache.GetStats();
+	}
 
-	void AddNeighbourData(FString InName, UFANeighbourData* Data = nullptr);
+	/** Nodes blocked by the dynamic obstacles of the world subsystem. */
+	FFADynamicObstacleOverlay& GetObstacleOverlay() { return ObstacleOverlay; }
+	const FFADynamicObstacleOverlay& GetObstacleOverlay() const { return ObstacleOverlay; }
+	/**
+	 * @brief Clear the obstacle overlay if it blocks the nodes of other nodes data, whose node indices don't match.
+	 * @return Whether blocked nodes were cleared.
+	 */
+	bool ResetObstacleOverlay(const UFANavOctreeData* InNavData);
+
+	/**
+	 * Whether the clearance of nodes computed at generation still describes the environment around the bound.
+	 * False once the bound is moved from the generated position or the environment around it changed.
+	 */
+	bool IsNodeClearanceValid() const;
+	void InvalidateNodeClearance() { bNodeClearanceValid = false; }
+
+	void AddNeighbourData(UFANeighbourData* Data);
+	/** Drop the connections to a bound. */
+	void RemoveNeighbourData(const AFABound* Other);
+	const TArray<TObjectPtr<UFANeighbourData>>& GetNeighboursData() const { return NeighboursData; }
 	UFANeighbourData* FindNeighboursData(AFABound* Bound0, AFABound* Bound1);
-	FCriticalSection& GetNodesDataLock() { return NodesDataLock; }
+	/** Read by any number of path queries at once, written only to load and unload the nodes. */
+	FRWLock& GetNodesDataLock() { return NodesDataLock; }
+
+	/** Cancel a path query searching the nodes when they are unloaded or the bound is destroyed. */
+	void AddPathQuery(const TSharedRef<FFAPathQueryToken, ESPMode::ThreadSafe>& Token);
+	/**
+	 * @brief Keep the bound from being destroyed while a path query step reads it. Pair with \c EndPathQueryStep .
+	 * @return False if the bound is being destroyed, then don't read it and don't call \c EndPathQueryStep .
+	 */
+	bool BeginPathQueryStep();
+	void EndPathQueryStep() { NumPathQuerySteps.fetch_sub(1); }
+	/** Cancel the path queries searching the nodes. Other bounds' queries go on. */
+	void CancelPathQueries();
+
+	/**
+	 * @brief Resolve the world locations of the loaded nodes again if the bound moved since, once for every path
+	 * query instead of by each query for every node it expands. Takes the nodes data lock, call without holding it.
+	 */
+	void UpdateSearchNodes();
+	/**
+	 * @brief Resolve the global HPA nodes of the loaded nodes, after the HPA nodes of the bound are registered or
+	 * unregistered. Path queries read the resolved nodes only, never \c LocalToGlobalHPANodes . Takes the nodes data
+	 * lock, call without holding it.
+	 */
+	void UpdateGlobalHPANodes();
+	/** Whether the loaded nodes are resolved. Call with the nodes data lock read. */
+	bool HasSearchNodesLocked() const
+	{
+		return NavData && NodeLocations.Num() == NavData->Num() && NodeGlobalHPANodes.Num() == NavData->Num();
+	}
+	/** The actor location the loaded nodes are resolved at. Call with the nodes data lock read. */
+	const FVector& GetSearchNodesLocationLocked() const { return SearchNodesLocation; }
+	/** World location of a loaded node. Call with the nodes data lock read. */
+	const FVector& GetNodeLocation(uint32 NodeIndex) const { return NodeLocations[NodeIndex]; }
+	/** Global HPA node of a loaded node, INDEX_NONE if it is in none. Call with the nodes data lock read. */
+	uint32 GetNodeGlobalHPANode(uint32 NodeIndex) const { return NodeGlobalHPANodes[NodeIndex]; }
 
 protected:
 	UPROPERTY(EditAnywhere, Category = "FA|Bound")
 	UBoxComponent* BoxComponent;
 	UPROPERTY(EditAnywhere, Category = "FA|Bound")
 	TSoftObjectPtr<UFABoundData> BoundDataSoft;
-	//The data table holding the nodes data. Reset when unload.
+	//The handle of the loaded nodes data. Reset when unload.
 	TSharedPtr<FStreamableHandle> LoadedDataHandle;
 	UPROPERTY()
-	TObjectPtr<UDataTable> NodesData;
+	//The nodes data. Converted from the nodes data table if the bound data has no nav data.
+	TObjectPtr<UFANavOctreeData> NavData;
 	UPROPERTY()
 	//Should not unload in anytime unless new Bound Data Soft is set.
 	UFABoundData* BoundData;
@@ -106,8 +193,45 @@ protected:
 	//Should be init when spawned on game start.
 	TMap<uint32, uint32> LocalToGlobalHPANodes;
 	UPROPERTY()
-	//The Connections to nodes in different nodes. The key is the save slot name.
-	TMap<FString, TObjectPtr<UFANeighbourData>> NeighboursData;
-	//Mutex for accessing the nodes' data.
-	FCriticalSection NodesDataLock;
+	//The Connections to nodes in overlapping bounds.
+	TArray<TObjectPtr<UFANeighbourData>> NeighboursData;
+	//Mutex for accessing NeighboursData, added to by stitching tasks.
+	UE::FSpinLock NeighboursDataLock;
+	//Lock for accessing the nodes' data, shared by the readers.
+	FRWLock NodesDataLock;
+
+	/** The asset to load the nodes data from: the nav data, or the nodes data table of bounds generated before it. */
+	FSoftObjectPath GetNodesDataPath() const;
+	/** Map the nav blob of the bound data if it has one. Call with NodesDataLock written. */
+	bool LoadNavBlob();
+	/** Use a loaded nodes data asset. Call with NodesDataLock written. */
+	void SetLoadedNodesData(UObject* Asset);
+	/** Block the loaded nodes by the dynamic obstacles of the world. Call without NodesDataLock held. */
+	void OnNodesDataLoaded();
+	/** Resolve the world locations and global HPA nodes of the loaded nodes. Call with NodesDataLock written. */
+	void ResolveSearchNodes();
+	/** Call with NodesDataLock written. */
+	void ResolveNodeLocations();
+	/** Call with NodesDataLock written. */
+	void ResolveGlobalHPANodes();
+	uint32 BoundIndex = FFANodeHandle::InvalidIndex;
+	FFAEdgeClearanceCache EdgeClearanceCache;
+	FFADynamicObstacleOverlay ObstacleOverlay;
+	//The nodes data the overlay blocks nodes of.
+	TWeakObjectPtr<const UFANavOctreeData> ObstacleOverlayNavData;
+	std::atomic<bool> bNodeClearanceValid{true};
+	//Tokens of the path queries that searched the nodes, expired once a query is dropped.
+	TArray<TWeakPtr<FFAPathQueryToken, ESPMode::ThreadSafe>> PathQueryTokens;
+	//Tokens at the last pruning of the expired ones.
+	int32 NumPrunedPathQueryTokens = 0;
+	UE::FSpinLock PathQueryTokensLock;
+	//Path query steps reading the bound, waited for when destroyed instead of every query of the world.
+	std::atomic<int32> NumPathQuerySteps{0};
+	//Set when destroyed, no step may start after.
+	std::atomic<bool> bPathQueriesClosed{false};
+	//Per loaded node, read by the path queries instead of transforming the nodes data.
+	TArray<FVector> NodeLocations;
+	TArray<uint32> NodeGlobalHPANodes;
+	//The actor location the nodes were resolved at.
+	FVector SearchNodesLocation = FVector::ZeroVector;
 };
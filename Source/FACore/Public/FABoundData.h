@@ -9,6 +9,31 @@
 #include "FABoundData.generated.h"
 
 class UCompositeDataTable;
+class UFANavOctreeData;
+class UFABoundData;
+
+/**
+ * @brief Pairs of nodes touching across the overlap with another bound, found when the bounds were generated.
+ * Only valid while the other bound keeps the same generation and the same location relative to this bound.
+ */
+USTRUCT()
+struct FFABoundStitch
+{
+	GENERATED_BODY()
+	UPROPERTY(VisibleAnywhere, Category = "FA")
+	TSoftObjectPtr<UFABoundData> Other;
+	//NavDataGuid of the other bound data when stitched.
+	UPROPERTY(VisibleAnywhere, Category = "FA")
+	FGuid OtherNavDataGuid;
+	//Location of the other bound relative to this bound when stitched.
+	UPROPERTY(VisibleAnywhere, Category = "FA")
+	FVector OtherOffset = FVector::ZeroVector;
+	//Node indices in this bound, each touching the node at the same position in OtherNodes.
+	UPROPERTY(VisibleAnywhere, Category = "FA")
+	TArray<uint32> Nodes;
+	UPROPERTY(VisibleAnywhere, Category = "FA")
+	TArray<uint32> OtherNodes;
+};
 /**
  *
  */
@@ -22,11 +47,29 @@ public:
 	TArray<TSoftObjectPtr<AActor>> ActorsToIgnore;
 	UPROPERTY(VisibleAnywhere, Category = "FA|BoundData")
 	TSoftObjectPtr<UCompositeDataTable> CombinedNodes;
+	//Cooked nodes data used at runtime. CombinedNodes is loaded and converted if not set.
+	UPROPERTY(VisibleAnywhere, Category = "FA|BoundData")
+	TSoftObjectPtr<UFANavOctreeData> NavData;
+	/**
+	 * Long package name of the nav blob file, mapped in place of loading NavData when set.
+	 * The file is not an asset, add its directory to Additional Non-Asset Directories to Package.
+	 */
+	UPROPERTY(VisibleAnywhere, Category = "FA|BoundData")
+	FString NavBlobPath;
 	//Connection between HPANodes.
 	UPROPERTY(VisibleAnywhere, Category = "FA|BoundData")
 	TMap<uint32, FFAConnectedHPANode> InternalHPAConnection;
+	//Portals between connected HPANodes, in generation space.
+	UPROPERTY(VisibleAnywhere, Category = "FA|BoundData")
+	TArray<FFAHPAPortal> InternalHPAPortals;
 	UPROPERTY(VisibleAnywhere, Category = "FA|BoundData")
 	TArray<uint32> ContainingHPANodes;
+	//Changed every generation, to tell stitches made with an older generation.
+	UPROPERTY(VisibleAnywhere, Category = "FA|BoundData")
+	FGuid NavDataGuid;
+	//Stitches to bounds placed next to this one in the level, cooked so they aren't found at runtime.
+	UPROPERTY(VisibleAnywhere, Category = "FA|BoundData")
+	TArray<FFABoundStitch> Stitches;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "FA|BoundData")
 	FVector GeneratePosition;
 	UPROPERTY(VisibleAnywhere, Category = "FA|BoundData")
@@ -0,0 +1,110 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * @brief Dynamic AABB tree of bounds.
+ * Leaves hold a box and a user value, inner nodes the union of their children. Insertion picks the sibling with
+ * the least increase of surface area and the tree is kept balanced by rotations, so queries visit O(log n) nodes.
+ * Not thread safe.
+ */
+class FACORE_API FFABoundTree
+{
+public:
+	static constexpr int32 NullNode = INDEX_NONE;
+
+	/**
+	 * @brief Add a box to the tree.
+	 * @return The proxy used to remove or move the box.
+	 */
+	int32 Insert(const FBox& Box, uint32 UserData);
+	void Remove(int32 Proxy);
+	/** Change the box of a proxy. */
+	void Move(int32 Proxy, const FBox& Box);
+	void Reset();
+
+	uint32 GetUserData(int32 Proxy) const { return Nodes[Proxy].UserData; }
+	const FBox& GetBox(int32 Proxy) const { return Nodes[Proxy].Box; }
+	int32 Num() const { return NumLeaves; }
+	/** Height of the tree, 0 for a single leaf. */
+	int32 GetHeight() const { return Root == NullNode ? 0 : Nodes[Root].Height; }
+
+	/** Call Visitor(UserData) for every box containing the point, including its surface. */
+	template <typename VisitorType>
+	void QueryPoint(const FVector& Point, VisitorType&& Visitor) const
+	{
+		Query([&Point](const FBox& Box) { return Box.IsInsideOrOn(Point); }, Visitor);
+	}
+
+	/** Call Visitor(UserData) for every box intersecting the box, touching included. */
+	template <typename VisitorType>
+	void QueryBox(const FBox& InBox, VisitorType&& Visitor) const
+	{
+		Query([&InBox](const FBox& Box) { return Box.Intersect(InBox); }, Visitor);
+	}
+
+	/** Call Visitor(UserData) for every box hit by the segment from Start to End. */
+	template <typename VisitorType>
+	void QueryRay(const FVector& Start, const FVector& End, VisitorType&& Visitor) const
+	{
+		const FVector Direction = End - Start;
+		const FVector InvDirection(Direction.X != 0 ? 1 / Direction.X : UE_BIG_NUMBER,
+		                           Direction.Y != 0 ? 1 / Direction.Y : UE_BIG_NUMBER,
+		                           Direction.Z != 0 ? 1 / Direction.Z : UE_BIG_NUMBER);
+		Query([&Start, &Direction, &InvDirection](const FBox& Box)
+		{
+			return FMath::LineBoxIntersection(Box, Start, Start + Direction, Direction, InvDirection);
+		}, Visitor);
+	}
+
+private:
+	struct FNode
+	{
+		FBox Box = FBox(ForceInit);
+		int32 Parent = NullNode;
+		int32 Child1 = NullNode;
+		int32 Child2 = NullNode;
+		//Leaves are 0, free nodes are -1.
+		int32 Height = -1;
+		uint32 UserData = 0;
+
+		bool IsLeaf() const { return Child1 == NullNode; }
+	};
+
+	template <typename OverlapType, typename VisitorType>
+	void Query(OverlapType&& Overlap, VisitorType&& Visitor) const
+	{
+		if (Root == NullNode) return;
+		TArray<int32, TInlineAllocator<64>> Stack;
+		Stack.Add(Root);
+		while (Stack.Num() > 0)
+		{
+			const FNode& Node = Nodes[Stack.Pop()];
+			if (!Overlap(Node.Box)) continue;
+			if (Node.IsLeaf())
+			{
+				Visitor(Node.UserData);
+				continue;
+			}
+			Stack.Add(Node.Child1);
+			Stack.Add(Node.Child2);
+		}
+	}
+
+	int32 AllocateNode();
+	void FreeNode(int32 Node);
+	void InsertLeaf(int32 Leaf);
+	void RemoveLeaf(int32 Leaf);
+	/** Rotate the subtree if unbalanced, returns the new root of the subtree. */
+	int32 Balance(int32 Node);
+	/** Recompute the boxes and heights from the node to the root, balancing on the way. */
+	void Refit(int32 Node);
+	static double Area(const FBox& Box);
+
+	TArray<FNode> Nodes;
+	int32 Root = NullNode;
+	int32 FreeList = NullNode;
+	int32 NumLeaves = 0;
+};
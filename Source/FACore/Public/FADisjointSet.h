@@ -0,0 +1,92 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * @brief Union-find over dense integer elements, with path compression and union by rank.
+ * Finding and merging are nearly constant time, so the connected components of a graph are labelled in one pass
+ * over its edges.
+ */
+class FFADisjointSet
+{
+public:
+	FFADisjointSet() = default;
+
+	explicit FFADisjointSet(int32 Number)
+	{
+		Reset(Number);
+	}
+
+	/** Make every element of [0, Number) a set of its own. */
+	void Reset(int32 Number)
+	{
+		Parents.SetNumUninitialized(Number);
+		for (int32 i = 0; i < Number; i++)
+		{
+			Parents[i] = i;
+		}
+		Ranks.Reset(Number);
+		Ranks.AddZeroed(Number);
+	}
+
+	int32 Num() const { return Parents.Num(); }
+
+	/** The representative element of the set containing an element. */
+	int32 Find(int32 Element)
+	{
+		int32 Root = Element;
+		while (Parents[Root] != Root)
+		{
+			Root = Parents[Root];
+		}
+		//Point the path straight to the root.
+		while (Parents[Element] != Root)
+		{
+			const int32 Next = Parents[Element];
+			Parents[Element] = Root;
+			Element = Next;
+		}
+		return Root;
+	}
+
+	/**
+	 * @brief Merge the sets of two elements, the shallower tree under the deeper one.
+	 * @return False if they are already in the same set.
+	 */
+	bool Union(int32 A, int32 B)
+	{
+		A = Find(A);
+		B = Find(B);
+		if (A == B) return false;
+		if (Ranks[A] < Ranks[B]) Swap(A, B);
+		Parents[B] = A;
+		if (Ranks[A] == Ranks[B]) Ranks[A]++;
+		return true;
+	}
+
+	/**
+	 * @brief Number the sets in order of their first element.
+	 * @param OutLabels The number of the set of each element.
+	 * @return The number of sets.
+	 */
+	int32 Label(TArray<int32>& OutLabels)
+	{
+		OutLabels.SetNumUninitialized(Num());
+		TArray<int32> RootLabels;
+		RootLabels.Init(INDEX_NONE, Num());
+		int32 NumSets = 0;
+		for (int32 i = 0; i < Num(); i++)
+		{
+			int32& RootLabel = RootLabels[Find(i)];
+			if (RootLabel == INDEX_NONE) RootLabel = NumSets++;
+			OutLabels[i] = RootLabel;
+		}
+		return NumSets;
+	}
+
+private:
+	TArray<int32> Parents;
+	TArray<uint8> Ranks;
+};
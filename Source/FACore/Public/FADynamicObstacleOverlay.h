@@ -0,0 +1,72 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UFANavOctreeData;
+
+/**
+ * @brief Nodes of a bound blocked at runtime by dynamic obstacles, e.g. closed doors, on top of its static nav data.
+ * Each node counts the obstacles overlapping it, so obstacles may overlap and be removed in any order.
+ * Thread safe, searches read it while obstacles are added and removed.
+ */
+class FACORE_API FFADynamicObstacleOverlay
+{
+public:
+	/**
+	 * @brief Block the traversable nodes overlapping an obstacle. Nodes only touching it are not blocked.
+	 * @param GeneratedBox Box of the obstacle in generation space.
+	 * @param OutChangedNodes Nodes not blocked by any obstacle before are added.
+	 */
+	void AddObstacle(int32 ObstacleId, const FBox& GeneratedBox, const UFANavOctreeData* NavData,
+	                 TArray<uint32>& OutChangedNodes);
+	/**
+	 * @brief Unblock the nodes of an obstacle and forget its box.
+	 * @param OutChangedNodes Nodes not blocked by any other obstacle are added.
+	 */
+	void RemoveObstacle(int32 ObstacleId, TArray<uint32>& OutChangedNodes);
+	/** Unblock every node, e.g. before blocking the nodes of other nav data. The boxes are kept. */
+	void Reset();
+	/** Keep the world box of an obstacle overlapping the bound, whether its nodes are loaded or not. */
+	void SetObstacleBox(int32 ObstacleId, const FBox& Box);
+
+	/** Whether a world box overlaps an obstacle of the bound, touch excluded. */
+	bool OverlapsObstacle(const FBox& Box) const
+	{
+		//Most bounds have no obstacle, skip the lock.
+		if (NumObstacleBoxes.load(std::memory_order_relaxed) == 0) return false;
+		FReadScopeLock ReadLock(Lock);
+		for (const TPair<int32, FBox>& Obstacle : ObstacleBoxes)
+		{
+			const FBox& Other = Obstacle.Value;
+			if (Box.Min.X < Other.Max.X && Other.Min.X < Box.Max.X && Box.Min.Y < Other.Max.Y &&
+				Other.Min.Y < Box.Max.Y && Box.Min.Z < Other.Max.Z && Other.Min.Z < Box.Max.Z)
+				return true;
+		}
+		return false;
+	}
+
+	bool IsBlocked(uint32 NodeIndex) const
+	{
+		//Most bounds have no obstacle, skip the lock.
+		if (NumBlocked.load(std::memory_order_relaxed) == 0) return false;
+		FReadScopeLock ReadLock(Lock);
+		return BlockCounts.IsValidIndex(NodeIndex) && BlockCounts[NodeIndex] > 0;
+	}
+
+	/** Number of nodes blocked by any obstacle. */
+	int32 GetNumBlocked() const { return NumBlocked; }
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	mutable FRWLock Lock;
+	/** Nodes blocked by each obstacle. */
+	TMap<int32, TArray<uint32>> ObstacleNodes;
+	/** Number of obstacles blocking each node, sized to the nav data with the first obstacle. */
+	TArray<uint16> BlockCounts;
+	std::atomic<int32> NumBlocked{0};
+	/** Boxes of the obstacles overlapping the bound, in world space. */
+	TArray<TPair<int32, FBox>> ObstacleBoxes;
+	std::atomic<int32> NumObstacleBoxes{0};
+};
@@ -0,0 +1,93 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FANodeHandle.h"
+#include "FAEdgeClearanceCache.generated.h"
+
+/** Key of a cached edge: the node the edge starts from, the node it goes to and the collider size class. */
+struct FFAEdgeClearanceKey
+{
+	FFAEdgeClearanceKey(const FFANodeHandle& InFrom, const FFANodeHandle& InTo, uint32 InSizeClass)
+		: From(InFrom),
+		  To(InTo),
+		  SizeClass(InSizeClass)
+	{
+	}
+
+	FFANodeHandle From;
+	FFANodeHandle To;
+	uint32 SizeClass;
+
+	bool operator==(const FFAEdgeClearanceKey& Other) const
+	{
+		return From == Other.From && To == Other.To && SizeClass == Other.SizeClass;
+	}
+
+	friend uint32 GetTypeHash(const FFAEdgeClearanceKey& Key)
+	{
+		return HashCombineFast(HashCombineFast(GetTypeHash(Key.From), GetTypeHash(Key.To)),
+		                       GetTypeHash(Key.SizeClass));
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FFAEdgeClearanceCacheStats
+{
+	GENERATED_BODY()
+	UPROPERTY(BlueprintReadOnly, Category = "FA|EdgeClearanceCache")
+	int64 Hits = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "FA|EdgeClearanceCache")
+	int64 Misses = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "FA|EdgeClearanceCache")
+	int64 Invalidations = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "FA|EdgeClearanceCache")
+	int64 Entries = 0;
+
+	FFAEdgeClearanceCacheStats& operator+=(const FFAEdgeClearanceCacheStats& Other)
+	{
+		Hits += Other.Hits;
+		Misses += Other.Misses;
+		Invalidations += Other.Invalidations;
+		Entries += Other.Entries;
+		return *this;
+	}
+};
+
+/**
+ * @brief Results of collider overlap tests on edges, filled lazily by the pathfinding and shared by every query through the bound.
+ * Thread safe. Has to be invalidated when the environment around the bound changes.
+ */
+class FACORE_API FFAEdgeClearanceCache
+{
+public:
+	/**
+	 * @brief Find a cached result.
+	 * @param bOutClear Whether the edge is clear of the environment, only set when found.
+	 * @return Whether the edge is cached.
+	 */
+	bool Find(const FFAEdgeClearanceKey& Key, bool& bOutClear) const;
+	/** Changed by every invalidation. Get it before testing an edge, to add the result with. */
+	uint64 GetEpoch() const { return Epoch.load(); }
+	/**
+	 * @brief Cache a result. The oldest results are evicted to hold at most MaxEntries.
+	 * @param InEpoch The epoch when the edge was tested. The result is dropped if invalidated since, as it may be of
+	 * the environment before the change.
+	 */
+	void Add(const FFAEdgeClearanceKey& Key, bool bClear, int32 MaxEntries, uint64 InEpoch);
+	/** Drop every cached result, and the results of tests running meanwhile. */
+	void Invalidate();
+	FFAEdgeClearanceCacheStats GetStats() const;
+
+private:
+	mutable FRWLock Lock;
+	TMap<FFAEdgeClearanceKey, bool> Entries;
+	//Keys in the order they were added, a ring once full. NextEvicted is the oldest.
+	TArray<FFAEdgeClearanceKey> Order;
+	int32 NextEvicted = 0;
+	std::atomic<uint64> Epoch{0};
+	mutable std::atomic<int64> Hits{0};
+	mutable std::atomic<int64> Misses{0};
+	std::atomic<int64> Invalidations{0};
+};
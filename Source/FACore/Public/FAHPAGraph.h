@@ -0,0 +1,59 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * @brief Abstract graph for HPA* search.
+ * Search states are portals between two adjacent HPA nodes (clusters). Every portal is entered from one of its
+ * clusters, so a portal gives two states. The states of a cluster are connected to the other portals of the
+ * cluster with the distance between the portals as cost, stored as a flat CSR adjacency.
+ * \c Build has to be called after portals are added before searching.
+ */
+class FACORE_API FFAHPAGraph
+{
+public:
+	/** Remove every portal. */
+	void Reset();
+	/** Add a portal between two clusters. Portals are in world space. */
+	void AddPortal(uint32 ClusterA, uint32 ClusterB, const FVector& Position);
+	/** Remove every portal of the clusters. */
+	void RemoveClusters(const TSet<uint32>& Clusters);
+	/** Build the adjacency of the portals added. */
+	void Build();
+	bool NeedsBuild() const { return bNeedsBuild; }
+
+	/**
+	 * @brief Find the cheapest sequence of clusters between two locations.
+	 * @param OutClusters Clusters passed through, including the start and end cluster.
+	 * @param OutCost Length of the path through the portals.
+	 * @return Whether a path is found.
+	 */
+	bool FindPath(uint32 StartCluster, const FVector& StartLocation, uint32 EndCluster,
+	              const FVector& EndLocation, TArray<uint32>& OutClusters,
+	              float* OutCost = nullptr) const;
+
+	int32 GetNumPortals() const { return PortalPositions.Num(); }
+	int32 GetNumEdges() const { return EdgeTargets.Num(); }
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	/** State of the portal entered into its cluster on Side. */
+	static int32 MakeState(int32 Portal, int32 Side) { return Portal * 2 + Side; }
+	static int32 StatePortal(int32 State) { return State / 2; }
+	/** The cluster the state is in. */
+	uint32 StateCluster(int32 State) const { return PortalClusters[State]; }
+
+	/** Two clusters of each portal, indexed by state. */
+	TArray<uint32> PortalClusters;
+	TArray<FVector> PortalPositions;
+	/** Portals of each cluster. Portals of cluster c are ClusterPortals[ClusterOffsets[c], ClusterOffsets[c + 1]). */
+	TArray<int32> ClusterOffsets;
+	TArray<int32> ClusterPortals;
+	/** Edges of each state. Edges of state s are EdgeTargets[EdgeOffsets[s], EdgeOffsets[s + 1]). */
+	TArray<int32> EdgeOffsets;
+	TArray<int32> EdgeTargets;
+	TArray<float> EdgeCosts;
+	bool bNeedsBuild = false;
+};
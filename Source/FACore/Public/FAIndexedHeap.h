@@ -0,0 +1,147 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * @brief Binary min-heap over compact integer handles, supporting decrease-key.
+ * Handles are expected to be small, dense indices (e.g. indices into a search record array).
+ * @tparam PredicateType Callable (int32 A, int32 B) -> bool, true when A should be popped before B.
+ */
+template <typename PredicateType>
+class TFAIndexedHeap
+{
+public:
+	explicit TFAIndexedHeap(PredicateType InPredicate)
+		: Predicate(MoveTemp(InPredicate))
+	{
+	}
+
+	/** Remove every handle but keep the allocated memory. */
+	void Reset()
+	{
+		Heap.Reset();
+		Positions.Reset();
+		Count = 0;
+	}
+
+	/** Remove every handle and free the memory. */
+	void Empty()
+	{
+		Heap.Empty();
+		Positions.Empty();
+		Count = 0;
+	}
+
+	void Reserve(int32 Number)
+	{
+		Heap.Reserve(Number);
+		Positions.Reserve(Number);
+	}
+
+	bool IsEmpty() const { return Count == 0; }
+	int32 Num() const { return Count; }
+
+	bool Contains(int32 Handle) const
+	{
+		return Positions.IsValidIndex(Handle) && Positions[Handle] != INDEX_NONE;
+	}
+
+	void Push(int32 Handle)
+	{
+		check(Handle >= 0);
+		if (Handle >= Positions.Num())
+		{
+			const int32 OldNum = Positions.Num();
+			Positions.AddUninitialized(Handle + 1 - OldNum);
+			for (int32 i = OldNum; i < Positions.Num(); i++)
+			{
+				Positions[i] = INDEX_NONE;
+			}
+		}
+		check(Positions[Handle] == INDEX_NONE);
+		//The backing array never shrinks so a reset heap can be refilled without allocating.
+		if (Count == Heap.Num()) Heap.Add(Handle);
+		else Heap[Count] = Handle;
+		Positions[Handle] = Count;
+		SiftUp(Count++);
+	}
+
+	/** Remove and return the top handle. */
+	int32 Pop()
+	{
+		check(Count > 0);
+		const int32 Top = Heap[0];
+		const int32 Last = Heap[--Count];
+		Positions[Top] = INDEX_NONE;
+		if (Count > 0)
+		{
+			Heap[0] = Last;
+			Positions[Last] = 0;
+			SiftDown(0);
+		}
+		return Top;
+	}
+
+	int32 Top() const
+	{
+		check(Count > 0);
+		return Heap[0];
+	}
+
+	/** Restore the heap order after the key of Handle changed, in either direction. */
+	void Update(int32 Handle)
+	{
+		check(Contains(Handle));
+		const int32 Position = Positions[Handle];
+		SiftUp(Position);
+		SiftDown(Positions[Handle]);
+	}
+
+	/** Bytes currently reserved by the heap. */
+	SIZE_T GetAllocatedSize() const
+	{
+		return Heap.GetAllocatedSize() + Positions.GetAllocatedSize();
+	}
+
+private:
+	void SiftUp(int32 Position)
+	{
+		const int32 Handle = Heap[Position];
+		while (Position > 0)
+		{
+			const int32 Parent = (Position - 1) / 2;
+			if (!Predicate(Handle, Heap[Parent])) break;
+			Heap[Position] = Heap[Parent];
+			Positions[Heap[Position]] = Position;
+			Position = Parent;
+		}
+		Heap[Position] = Handle;
+		Positions[Handle] = Position;
+	}
+
+	void SiftDown(int32 Position)
+	{
+		const int32 Handle = Heap[Position];
+		while (true)
+		{
+			int32 Child = 2 * Position + 1;
+			if (Child >= Count) break;
+			if (Child + 1 < Count && Predicate(Heap[Child + 1], Heap[Child])) Child++;
+			if (!Predicate(Heap[Child], Handle)) break;
+			Heap[Position] = Heap[Child];
+			Positions[Heap[Position]] = Position;
+			Position = Child;
+		}
+		Heap[Position] = Handle;
+		Positions[Handle] = Position;
+	}
+
+	PredicateType Predicate;
+	//Handles in heap order, only the first Count entries are valid.
+	TArray<int32> Heap;
+	int32 Count = 0;
+	//Position of each handle in Heap, INDEX_NONE when the handle is not in the heap.
+	TArray<int32> Positions;
+};
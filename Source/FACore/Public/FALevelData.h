@@ -16,3 +16,19 @@ struct FFAConnectedHPANode
 	UPROPERTY(VisibleAnywhere, Category = "FA")
 	TArray<uint32> Values;
 };
+
+/**
+ * @brief Crossing between two adjacent HPA nodes.
+ */
+USTRUCT(BlueprintType)
+struct FFAHPAPortal
+{
+	GENERATED_BODY()
+	UPROPERTY(VisibleAnywhere, Category = "FA")
+	uint32 HPANodeA = 0;
+	UPROPERTY(VisibleAnywhere, Category = "FA")
+	uint32 HPANodeB = 0;
+	//Centre of the faces shared by the nodes of the two HPA nodes.
+	UPROPERTY(VisibleAnywhere, Category = "FA")
+	FVector Position = FVector::ZeroVector;
+};
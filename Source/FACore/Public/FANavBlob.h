@@ -0,0 +1,100 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * @brief Flat binary file of the nodes data of a bound, searched in place without deserialising.
+ * A header followed by the arrays of the nav data, each aligned to \c Alignment bytes from the start of the file.
+ * The file is memory-mapped read only, so bounds share its pages between worlds and processes.
+ * Falls back to reading the whole file where the platform can't map it, e.g. a file inside a pak.
+ */
+class FACORE_API FFANavBlob
+{
+public:
+	/** "FANV" */
+	static constexpr uint32 Magic = 0x564E4146;
+	static constexpr uint32 Version = 1;
+	static constexpr uint32 Alignment = 16;
+	static constexpr const TCHAR* Extension = TEXT(".fanav");
+
+	enum ESection : uint32
+	{
+		Positions,
+		HalfExtents,
+		Flags,
+		Depths,
+		HPANodeIndices,
+		Clearances,
+		NeighbourOffsets,
+		Neighbours,
+		IndexCodes,
+		IndexLevels,
+		IndexNodeIndices,
+		NumSections
+	};
+
+	struct FSection
+	{
+		uint64 Offset;
+		uint64 Num;
+	};
+
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumNodes;
+		int32 IndexNumLevels;
+		FVector3d BoundPosition;
+		FVector3d BoundHalfExtent;
+		FVector3d IndexOrigin;
+		FVector3d IndexCellSize;
+		FSection Sections[NumSections];
+	};
+
+	/** Size in bytes of an element of each section. */
+	static uint32 GetElementSize(ESection Section);
+
+	/**
+	 * @brief Map a blob file. Bounds mapping the same file share the mapping.
+	 * @return nullptr if the file is missing or not a valid blob of this version.
+	 */
+	static TSharedPtr<const FFANavBlob> Map(const FString& Filename);
+	/**
+	 * @brief Write a blob file.
+	 * @param Sections The bytes of each section, the number of elements being their size by \c GetElementSize .
+	 */
+	static bool Write(const FString& Filename, FHeader Header, TConstArrayView<TConstArrayView<uint8>> Sections);
+
+	~FFANavBlob();
+	const FHeader& GetHeader() const { return *reinterpret_cast<const FHeader*>(Data); }
+
+	template <typename T>
+	TConstArrayView<T> GetSection(ESection Section) const
+	{
+		check(sizeof(T) == GetElementSize(Section));
+		const FSection& Found = GetHeader().Sections[Section];
+		return TConstArrayView<T>(reinterpret_cast<const T*>(Data + Found.Offset), Found.Num);
+	}
+
+	/** Whether the blob is mapped instead of read into memory. */
+	bool IsMapped() const { return Region.IsValid(); }
+	/** Bytes allocated for the blob, 0 if mapped. */
+	SIZE_T GetAllocatedSize() const { return Loaded.GetAllocatedSize(); }
+
+private:
+	FFANavBlob() = default;
+	/** Check the header and that every section lies inside the file. */
+	bool Validate(const FString& Filename) const;
+
+	TUniquePtr<IMappedFileHandle> Handle;
+	TUniquePtr<IMappedFileRegion> Region;
+	TArray64<uint8> Loaded;
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+};
@@ -0,0 +1,121 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FANavBlob.h"
+#include "FANode.h"
+#include "FANodeSpatialIndex.h"
+#include "Engine/DataAsset.h"
+#include "FANavOctreeData.generated.h"
+
+class UDataTable;
+
+/**
+ * @brief Cooked nodes data of a bound, stored structure-of-arrays.
+ * A node is an index into every array. Neighbours are a CSR adjacency of node indices, so no row names are loaded.
+ * Positions are in generation space, the same as the nodes data table it is converted from.
+ * The arrays are either owned, or used in place from a mapped nav blob.
+ */
+UCLASS(BlueprintType)
+class FACORE_API UFANavOctreeData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr uint32 InvalidIndex = MAX_uint32;
+
+	enum ENodeFlags : uint8
+	{
+		Traversable = 1 << 0,
+	};
+
+	/**
+	 * @brief Convert the rows of a nodes data table. Neighbours that are not rows of the table are dropped.
+	 * @param InBoundPosition Location of the bound when generated.
+	 * @param InBoundHalfExtent Half extent of the bound.
+	 */
+	void BuildFromDataTable(const UDataTable* DataTable, const FVector& InBoundPosition,
+	                        const FVector& InBoundHalfExtent);
+	/**
+	 * @brief Search the arrays of a nav blob in place, replacing the arrays of this.
+	 * @return False if the file is missing or invalid, leaving this unchanged.
+	 */
+	bool LoadFromBlob(const FString& Filename);
+	/** Write the arrays to a nav blob file. */
+	bool WriteBlob(const FString& Filename) const;
+	bool IsBlobLoaded() const { return Blob.IsValid(); }
+	/** Stop using the nav blob so its file can be unmapped, leaving this empty. */
+	void ReleaseBlob();
+	virtual void Serialize(FArchive& Ar) override;
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+	int32 Num() const { return PositionsView.Num(); }
+	FVector GetPosition(uint32 NodeIndex) const { return FVector(PositionsView[NodeIndex]); }
+	FVector GetHalfExtent(uint32 NodeIndex) const { return FVector(HalfExtentsView[NodeIndex]); }
+	bool IsTraversable(uint32 NodeIndex) const { return FlagsView[NodeIndex] & Traversable; }
+	uint32 GetHPANodeIndex(uint32 NodeIndex) const { return HPANodeIndicesView[NodeIndex]; }
+	float GetClearance(uint32 NodeIndex) const { return ClearancesView[NodeIndex]; }
+	uint32 GetDepth(uint32 NodeIndex) const { return DepthsView[NodeIndex]; }
+
+	TConstArrayView<uint32> GetNeighbours(uint32 NodeIndex) const
+	{
+		return TConstArrayView<uint32>(NeighboursView.GetData() + NeighbourOffsetsView[NodeIndex],
+		                               NeighbourOffsetsView[NodeIndex + 1] - NeighbourOffsetsView[NodeIndex]);
+	}
+
+	/** Index of the leaf containing a location in generation space, \c InvalidIndex if none. */
+	uint32 FindNode(const FVector& GeneratedLocation) const
+	{
+		return SpatialIndex.FindNode(GeneratedLocation);
+	}
+
+	/** Indices of the leaves overlapping or touching a box in generation space. */
+	void FindNodesInBox(const FBox& GeneratedBox, TArray<uint32>& OutNodes) const
+	{
+		SpatialIndex.FindNodesInBox(GeneratedBox, OutNodes);
+	}
+
+	/** Node data of the node, without the neighbours. */
+	FFaNodeData MakeNodeData(uint32 NodeIndex) const;
+	FVector GetBoundPosition() const { return BoundPosition; }
+	FVector GetBoundHalfExtent() const { return BoundHalfExtent; }
+	SIZE_T GetAllocatedSize() const;
+
+protected:
+	enum EVersion : int32
+	{
+		Initial = 1,
+		Latest = Initial,
+	};
+
+	UPROPERTY(VisibleAnywhere, Category = "FA|NavOctreeData")
+	FVector BoundPosition = FVector::ZeroVector;
+	UPROPERTY(VisibleAnywhere, Category = "FA|NavOctreeData")
+	FVector BoundHalfExtent = FVector::ZeroVector;
+
+	/** Point the views to the owned arrays. */
+	void BindOwnedArrays();
+
+	//Arrays are bulk serialized in Serialize rather than as properties. Empty if a blob is loaded.
+	TArray<FVector3f> Positions;
+	TArray<FVector3f> HalfExtents;
+	TArray<uint8> Flags;
+	TArray<uint8> Depths;
+	TArray<uint32> HPANodeIndices;
+	TArray<float> Clearances;
+	/** Neighbours of node i are Neighbours[NeighbourOffsets[i], NeighbourOffsets[i + 1]). */
+	TArray<uint32> NeighbourOffsets;
+	TArray<uint32> Neighbours;
+	FFANodeSpatialIndex SpatialIndex;
+	//The arrays searched, either the owned ones or the sections of Blob.
+	TConstArrayView<FVector3f> PositionsView;
+	TConstArrayView<FVector3f> HalfExtentsView;
+	TConstArrayView<uint8> FlagsView;
+	TConstArrayView<uint8> DepthsView;
+	TConstArrayView<uint32> HPANodeIndicesView;
+	TConstArrayView<float> ClearancesView;
+	TConstArrayView<uint32> NeighbourOffsetsView;
+	TConstArrayView<uint32> NeighboursView;
+	TSharedPtr<const FFANavBlob> Blob;
+};
@@ -3,7 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "GameFramework/SaveGame.h"
+#include "UObject/Object.h"
 #include "FANeighbourData.generated.h"
 
 class AFABound;
@@ -14,20 +14,26 @@ USTRUCT()
 struct FNeighbourBoundConnected
 {
 	GENERATED_BODY()
+	//Node indices in the other bound.
 	UPROPERTY(VisibleAnywhere, Category = "FA|NeighbourData")
-	TArray<FName> Connected;
+	TArray<uint32> Connected;
 };
 
+/**
+ * @brief Connections between the nodes of two overlapping bounds, kept in memory by both bounds.
+ */
 UCLASS()
-class FACORE_API UFANeighbourData : public USaveGame
+class FACORE_API UFANeighbourData : public UObject
 {
 	GENERATED_BODY()
 
 public:
 	UPROPERTY(VisibleAnywhere, Category = "FA|NeighbourData")
 	TObjectPtr<AFABound> Bound[2];
+	//Keyed by node index in Bound[0].
 	UPROPERTY(VisibleAnywhere, Category = "FA|NeighbourData")
-	TMap<FName, FNeighbourBoundConnected> Connection0;
+	TMap<uint32, FNeighbourBoundConnected> Connection0;
+	//Keyed by node index in Bound[1].
 	UPROPERTY(VisibleAnywhere, Category = "FA|NeighbourData")
-	TMap<FName, FNeighbourBoundConnected> Connection1;
+	TMap<uint32, FNeighbourBoundConnected> Connection1;
 };
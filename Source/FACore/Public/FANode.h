@@ -23,6 +23,9 @@ struct FFaNodeData : public FTableRowBase
 	uint32 HPANodeIndex = -1;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "FA|NodeData")
 	bool IsTraversable = false;
+	//Half extent of the largest axis-aligned cube centred on the node that is free of the environment. 0 if not computed.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "FA|NodeData")
+	float Clearance = 0;
 
 	bool operator==(const FFaNodeData& other) const
 	{
@@ -0,0 +1,73 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "FANodeHandle.generated.h"
+
+/**
+ * @brief Compact identity of a node: the index of its bound in the world subsystem and the index of the node in the bound.
+ * BoundIndex is \c InvalidIndex for bounds that are not registered in the world subsystem, e.g. during generation.
+ */
+USTRUCT(BlueprintType)
+struct FACORE_API FFANodeHandle
+{
+	GENERATED_BODY()
+	static constexpr uint32 InvalidIndex = MAX_uint32;
+
+	FFANodeHandle() = default;
+
+	FFANodeHandle(uint32 InBoundIndex, uint32 InNodeIndex)
+		: BoundIndex(InBoundIndex),
+		  NodeIndex(InNodeIndex)
+	{
+	}
+
+	UPROPERTY(VisibleAnywhere, Category = "FA|NodeHandle")
+	uint32 BoundIndex = InvalidIndex;
+	UPROPERTY(VisibleAnywhere, Category = "FA|NodeHandle")
+	uint32 NodeIndex = InvalidIndex;
+
+	bool IsValid() const { return NodeIndex != InvalidIndex; }
+	uint64 ToPacked() const { return static_cast<uint64>(BoundIndex) << 32 | NodeIndex; }
+
+	bool operator==(const FFANodeHandle& Other) const { return ToPacked() == Other.ToPacked(); }
+	bool operator!=(const FFANodeHandle& Other) const { return ToPacked() != Other.ToPacked(); }
+	bool operator<(const FFANodeHandle& Other) const { return ToPacked() < Other.ToPacked(); }
+
+	friend uint32 GetTypeHash(const FFANodeHandle& Handle) { return GetTypeHash(Handle.ToPacked()); }
+
+	FString ToString() const { return FString::Printf(TEXT("%u:%u"), BoundIndex, NodeIndex); }
+};
+
+/**
+ * Blueprint wrapper of FFANodeHandle, which cannot expose its uint32 members directly.
+ */
+UCLASS()
+class FACORE_API UFANodeHandleLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintPure, Category = "FA|NodeHandle")
+	static FFANodeHandle MakeNodeHandle(int32 BoundIndex, int32 NodeIndex);
+
+	UFUNCTION(BlueprintPure, Category = "FA|NodeHandle")
+	static void BreakNodeHandle(const FFANodeHandle& Handle, int32& BoundIndex, int32& NodeIndex);
+
+	UFUNCTION(BlueprintPure, Category = "FA|NodeHandle", meta = (DisplayName = "Is Valid"))
+	static bool IsValidNodeHandle(const FFANodeHandle& Handle) { return Handle.IsValid(); }
+
+	UFUNCTION(BlueprintPure, Category = "FA|NodeHandle",
+		meta = (DisplayName = "Equal (NodeHandle)", CompactNodeTitle = "=="))
+	static bool EqualEqual_NodeHandle(const FFANodeHandle& A, const FFANodeHandle& B) { return A == B; }
+
+	UFUNCTION(BlueprintPure, Category = "FA|NodeHandle",
+		meta = (DisplayName = "Less (NodeHandle)", CompactNodeTitle = "<"))
+	static bool Less_NodeHandle(const FFANodeHandle& A, const FFANodeHandle& B) { return A < B; }
+
+	UFUNCTION(BlueprintPure, Category = "FA|NodeHandle",
+		meta = (DisplayName = "To String (NodeHandle)", CompactNodeTitle = "->", BlueprintAutocast))
+	static FString Conv_NodeHandleToString(const FFANodeHandle& Handle) { return Handle.ToString(); }
+};
@@ -0,0 +1,107 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * @brief Point location over the leaves of a bound.
+ * Leaves are sorted by the Morton code of their first cell at the finest depth, so the leaf containing a point
+ * is found by a binary search of the code of the point instead of testing every leaf.
+ * Positions are in generation space, the same as the nodes data.
+ */
+class FACORE_API FFANodeSpatialIndex
+{
+public:
+	static constexpr uint32 InvalidIndex = MAX_uint32;
+	/** Morton codes hold 21 bits per axis. */
+	static constexpr int32 MaxLevels = 21;
+
+	/** The arrays of the index, to store or to search in place. */
+	struct FView
+	{
+		FVector Origin = FVector::ZeroVector;
+		FVector CellSize = FVector::OneVector;
+		int32 NumLevels = 0;
+		TConstArrayView<uint64> Codes;
+		TConstArrayView<uint8> Levels;
+		TConstArrayView<uint32> NodeIndices;
+	};
+
+	FFANodeSpatialIndex() = default;
+	//Views point into the owned arrays.
+	UE_NONCOPYABLE(FFANodeSpatialIndex)
+
+	/**
+	 * @brief Build the index of the leaves. The index of a node is its position in the arrays.
+	 * @param BoundPosition Centre of the bound when generated.
+	 */
+	void Build(TConstArrayView<FVector3f> Positions, TConstArrayView<FVector3f> HalfExtents,
+	           const FVector& BoundPosition, const FVector& BoundHalfExtent);
+	void Reset();
+	bool IsEmpty() const { return View.Codes.Num() == 0; }
+	const FView& GetView() const { return View; }
+	/** Search arrays owned elsewhere, e.g. a mapped nav blob. They must outlive the index or the next Build. */
+	void SetView(const FView& InView);
+
+	/** Index of the leaf containing \c Point , \c InvalidIndex if there is none. */
+	uint32 FindNode(const FVector& Point) const;
+
+	/**
+	 * @brief Find the leaves overlapping or touching a box, descending only into the cells of the octree the box
+	 * touches, so the cost follows the leaves found rather than every leaf of the bound.
+	 */
+	void FindNodesInBox(const FBox& Box, TArray<uint32>& OutNodes) const;
+
+	/** Interleave the lower 21 bits of each coordinate, x in the lowest bit. */
+	static uint64 EncodeMorton(uint32 X, uint32 Y, uint32 Z);
+	static FUintVector DecodeMorton(uint64 Code);
+
+	/**
+	 * @brief Find the leaves touching each leaf across a face, an edge or a corner, from the codes of the leaves.
+	 * The cost is linear in the number of leaves and neighbours, instead of testing every pair.
+	 * Neighbours of node i are \c OutNeighbours[OutOffsets[i], OutOffsets[i + 1]) , sorted by index.
+	 */
+	void BuildNeighbours(TArray<uint32>& OutOffsets, TArray<uint32>& OutNeighbours) const;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Codes.GetAllocatedSize() + Levels.GetAllocatedSize() + NodeIndices.GetAllocatedSize();
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FFANodeSpatialIndex& Index)
+	{
+		Ar << Index.View.Origin << Index.View.CellSize << Index.View.NumLevels;
+		Index.Codes.BulkSerialize(Ar);
+		Index.Levels.BulkSerialize(Ar);
+		Index.NodeIndices.BulkSerialize(Ar);
+		if (Ar.IsLoading()) Index.BindOwnedArrays();
+		return Ar;
+	}
+
+private:
+	/** Cell at the finest depth containing the point, clamped into the bound. */
+	FUintVector CellOf(const FVector& Point) const;
+
+	void BindOwnedArrays();
+	/**
+	 * The leaf covering a cell of a depth, \c InvalidIndex if there is none.
+	 * @param bOutSubdivided Whether smaller leaves are in the cell instead.
+	 */
+	uint32 FindCellLeaf(int32 Level, const FIntVector& Cell, bool& bOutSubdivided) const;
+	/**
+	 * Add the leaves in a cell touching the leaf it is next to in \c Direction , recursing into the children
+	 * facing the leaf when the cell holds smaller leaves.
+	 */
+	void AddTouchingLeaves(int32 Level, const FIntVector& Cell, const FIntVector& Direction,
+	                       TArray<uint32>& OutNodes) const;
+	void AddLeavesInBox(int32 Level, const FIntVector& Cell, const FBox& Box, TArray<uint32>& OutNodes) const;
+
+	/** The arrays searched, either the owned ones or ones set by SetView. NumLevels is the depth of the finest cells. */
+	FView View;
+	/** Code of the first cell of each leaf, sorted. */
+	TArray<uint64> Codes;
+	/** Depth of each leaf, the bound being depth 0. */
+	TArray<uint8> Levels;
+	TArray<uint32> NodeIndices;
+};
@@ -0,0 +1,87 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * @brief Collision geometry of the environment in world space, gathered once to voxelize a bound.
+ */
+struct FFAOccupancyShapes
+{
+	struct FConvex
+	{
+		TArray<FVector> Vertices;
+		/** Three vertex indices per face triangle. */
+		TArray<int32> Indices;
+	};
+
+	/** Surfaces without volume, e.g. complex collision meshes. Three vertices per triangle. */
+	TArray<FVector> Triangles;
+	/** Solid convex elements, including boxes. */
+	TArray<FConvex> Convexes;
+	TArray<FSphere> Spheres;
+	/** Bounds of geometry that can't be voxelized. Nodes overlapping them fall back to a physics query. */
+	TArray<FBox> FallbackBoxes;
+};
+
+/**
+ * @brief Bit-packed occupancy of a bound at every depth of its octree, built from its collision geometry.
+ * Level 0 is the bound itself and level L has 2^L cells per axis. Bits of a level are in Morton order, so the
+ * 8 children of a cell are the 8 bits of one byte of the next level and coarser levels are ORs of those bytes.
+ * A cell is occupied when its box overlaps a shape, as a box overlap query in the world would report.
+ */
+class FACORE_API FFAOccupancyGrid
+{
+public:
+	/** Finest level a grid can have, 2^30 bits. */
+	static constexpr int32 MaxLevels = 10;
+	/** Shapes only touching the face of a cell don't occupy it. */
+	static constexpr double TouchTolerance = 0.01;
+
+	/**
+	 * @brief Voxelize the shapes into every level up to \c NumLevels .
+	 * @param BoundPosition Centre of the bound.
+	 * @return False if \c NumLevels is over \c MaxLevels , leaving the grid empty.
+	 */
+	bool Build(const FFAOccupancyShapes& Shapes, const FVector& BoundPosition,
+	           const FVector& BoundHalfExtent, int32 NumLevels);
+	void Reset();
+	bool IsEmpty() const { return Levels.Num() == 0; }
+	int32 GetNumLevels() const { return Levels.Num() - 1; }
+
+	/** Whether the cell of a level containing the point is occupied. */
+	bool IsOccupied(int32 Level, const FVector& Point) const;
+	/** Whether geometry that couldn't be voxelized is in the box, so occupancy needs a physics query. */
+	bool NeedsQuery(const FBox& Box) const;
+	SIZE_T GetAllocatedSize() const;
+
+	/** Whether a triangle overlaps a box, by the separating axis test. */
+	static bool TriangleBoxOverlap(const FVector& Centre, const FVector& HalfExtent, const FVector& A,
+	                               const FVector& B, const FVector& C);
+
+private:
+	enum class EOverlap : uint8
+	{
+		Outside,
+		Inside,
+		Intersecting
+	};
+
+	/**
+	 * Classify the cells of the octree against a shape from the bound down, marking the finest cells of every cell
+	 * inside it. \c Classify must not return Intersecting for the finest cells.
+	 */
+	template <typename FClassify>
+	void Rasterize(int32 Level, uint64 Code, const FUintVector& Cell, const FClassify& Classify);
+	/** Mark every finest cell under a cell. */
+	void SetRange(int32 Level, uint64 Code);
+	void BuildCoarseLevels();
+
+	FVector Origin = FVector::ZeroVector;
+	/** Size of the bound. */
+	FVector Size = FVector::ZeroVector;
+	/** The bits of each level. */
+	TArray<TArray<uint64>> Levels;
+	TArray<FBox> FallbackBoxes;
+};
@@ -0,0 +1,147 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FAPathfindingAlgo.h"
+#include "FAPathQueryScheduler.h"
+#include "FAPathQueryToken.h"
+#include "FAPathSearchScratch.h"
+#include "FAWorldSubsystem.h"
+
+class AFABound;
+class UFANavOctreeData;
+class UFANeighbourData;
+class UFAPathfindingSettings;
+
+enum class EFAPathQueryStatus : uint8
+{
+	InProgress,
+	Succeeded,
+	Failed,
+	/** Stopped by its token, with \c bBoundLoaded of the path false as the path may be found once requested again. */
+	Cancelled
+};
+
+/**
+ * @brief A fine path search of one HPA segment that keeps its state between steps, so it can be spread over frames.
+ * No lock is held between steps. Each step checks the bounds of the segment are still loaded and fails otherwise,
+ * with \c bBoundLoaded of the path false. The bounds cancel the query when unloaded or destroyed.
+ * The search state comes from the scratch cache of the thread starting it and goes back to the one ending it.
+ */
+class FACORE_API FFAPathQuery
+{
+public:
+	/**
+	 * @param InFinePath The path to fill, with its HPA path, local start node and current HPA node set.
+	 * @param InEndNode The node the whole path ends at.
+	 */
+	FFAPathQuery(FFAFinePath InFinePath, const FFAPathNodeData& InEndNode, UWorld* InWorld,
+	             const UFAPathfindingSettings* InSettings, const FVector& InColliderSize,
+	             const FVector& InColliderOffset);
+	FFAPathQuery(const FFAPathQuery&) = delete;
+	FFAPathQuery& operator=(const FFAPathQuery&) = delete;
+	~FFAPathQuery();
+	/** A query that already ended with a path, for requests whose result is known without a search. */
+	static TSharedRef<FFAPathQuery> MakeFinished(FFAFinePath FinePath);
+
+	/**
+	 * @brief Expand nodes until the search ends, or either limit is reached.
+	 * @param MaxExpansions Nodes to expand at most.
+	 * @param MaxSeconds Time to expand for at most, 0 for no limit. At least one node is expanded.
+	 */
+	EFAPathQueryStatus Step(int32 MaxExpansions, double MaxSeconds = 0);
+	/** Step until the search ends. */
+	EFAPathQueryStatus Run() { return Step(MAX_int32); }
+	/** Stop the query from any thread, the step running ends after the node it expands. */
+	void Cancel() { Token->Cancel(); }
+	const TSharedRef<FFAPathQueryToken, ESPMode::ThreadSafe>& GetToken() const { return Token; }
+	/** Use a token, e.g. one with a parent to cancel several queries together. Set before the first step. */
+	void SetToken(const TSharedRef<FFAPathQueryToken, ESPMode::ThreadSafe>& InToken)
+	{
+		check(!bStarted);
+		Token = InToken;
+	}
+
+	EFAPathQueryStatus GetStatus() const { return Status; }
+	bool IsDone() const { return Status != EFAPathQueryStatus::InProgress; }
+	/** The path, complete once the query succeeded. */
+	const FFAFinePath& GetFinePath() const { return FinePath; }
+	FFAFinePath& GetFinePath() { return FinePath; }
+	/** Nodes expanded by every step so far. */
+	int32 GetNumExpanded() const { return NumExpanded; }
+	/**
+	 * @brief The key of the segment, for queries of other agents finding the same segment to share the search.
+	 * @return False if the query has started or has no segment to search.
+	 */
+	bool GetKey(uint32 InColliderSizeClass, FFAPathQueryKey& OutKey) const;
+	/**
+	 * @brief End the query with the result of an ended query with the same key, from the start location of this
+	 * query instead.
+	 */
+	void ShareResult(const FFAPathQuery& Other);
+
+private:
+	/**
+	 * The HPA nodes the current segment goes from and to.
+	 * @param bOutShouldFindEndNode Whether the segment ends at the end node of the whole path.
+	 * @return False if there is nothing to search.
+	 */
+	bool FindSegment(uint32& OutStartHPANode, uint32& OutEndHPANode, int32& OutEndHPANodeIndex,
+	                 bool& bOutShouldFindEndNode) const;
+	/** Check the segment and open the start node, failing if there is nothing to search. */
+	void Start();
+	/** Open the neighbours of a closed record, in its bound and across to the end bound. */
+	void Expand(int32 CurrentNode);
+	/**
+	 * Try to reach a neighbour from the current record.
+	 * @param bHeuristicFromControlPoint Whether hCost of a newly opened node is measured from the control point instead of the node.
+	 */
+	void Relax(int32 CurrentNode, AFABound* NeighbourBound, uint32 NeighbourIndex, bool bHeuristicFromControlPoint);
+	/** Retrace the path from the record reaching the goal. */
+	void Finish(int32 EndRecord);
+	/** The path node of a record, as the nodes of the bound are now. */
+	static FFAPathNodeData MakePathNodeData(const FFAPathSearchRecord& Record);
+	/** Set the control points of the path through \c PathLocations . */
+	void BuildControlPoints();
+	void Fail(bool bBoundLoaded = true);
+	void OnCancelled();
+	/** Give the search state of an ended query back to the cache. */
+	void ReleaseSearch();
+
+	FFAFinePath FinePath;
+	FFAPathNodeData EndNode;
+	TWeakObjectPtr<UWorld> World;
+	const UFAPathfindingSettings* Settings;
+	FVector ColliderSize;
+	FVector ColliderOffset;
+	EFAPathQueryStatus Status = EFAPathQueryStatus::InProgress;
+	TSharedRef<FFAPathQueryToken, ESPMode::ThreadSafe> Token = MakeShared<FFAPathQueryToken, ESPMode::ThreadSafe>();
+	bool bStarted = false;
+	int32 NumExpanded = 0;
+
+	uint32 StartHPANode = 0;
+	uint32 EndHPANode = 0;
+	//Whether reaching the end node ends the search, instead of any node of the end HPA node.
+	bool bShouldFindEndNode = false;
+	bool bIsDifferentBound = false;
+	//Every record is in one of these. Weak so a step can tell they are destroyed between steps.
+	TWeakObjectPtr<AFABound> StartBound;
+	TWeakObjectPtr<AFABound> EndBound;
+	//Nav data of the bounds when the search started, the node indices of the records are only valid in it.
+	const UFANavOctreeData* StartNavData = nullptr;
+	const UFANavOctreeData* EndNavData = nullptr;
+	//Where the nodes of the bounds were resolved when the search started, the costs of the records hold only there.
+	FVector StartBoundLocation = FVector::ZeroVector;
+	FVector EndBoundLocation = FVector::ZeroVector;
+	//Connections between the bounds, found again every step as a bound may be unregistered between them.
+	UFANeighbourData* NeighbourData = nullptr;
+	UFAWorldSubsystem* Subsystem = nullptr;
+	bool bUseEdgeClearanceCache = false;
+	uint32 ColliderSizeClass = 0;
+
+	//Search state while the search runs, null before and after.
+	TUniquePtr<FFAPathSearchScratch> Scratch;
+	//Where the path enters each of its nodes, kept for queries sharing the result.
+	TArray<FVector> PathLocations;
+};
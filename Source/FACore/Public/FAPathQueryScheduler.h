@@ -0,0 +1,172 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FANodeHandle.h"
+#include "UObject/ObjectKey.h"
+#include "FAPathQueryScheduler.generated.h"
+
+class FFAPathQuery;
+struct FFAFinePath;
+
+/** Called on the game thread with the path when a scheduled path query ends. */
+DECLARE_DELEGATE_OneParam(FFAOnPathQueryFinished, const FFAFinePath&)
+
+UENUM(BlueprintType)
+enum class EFAPathQueryPriority : uint8
+{
+	/** Stepped with the budget the other priorities leave, e.g. agents out of sight. */
+	Background,
+	Normal,
+	/** Stepped before every other priority, e.g. agents the player sees. */
+	PlayerVisible,
+	Num UMETA(Hidden)
+};
+
+USTRUCT(BlueprintType)
+struct FFAPathQuerySchedulerStats
+{
+	GENERATED_BODY()
+	/** Requests waiting for their path. */
+	UPROPERTY(BlueprintReadOnly, Category = "FA|PathQueryScheduler")
+	int32 QueueDepth = 0;
+	/** Searches run for the waiting requests, fewer than them when requests are coalesced. */
+	UPROPERTY(BlueprintReadOnly, Category = "FA|PathQueryScheduler")
+	int32 Searches = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "FA|PathQueryScheduler")
+	int64 Requests = 0;
+	/** Requests that shared the search of an identical request instead of running their own. */
+	UPROPERTY(BlueprintReadOnly, Category = "FA|PathQueryScheduler")
+	int64 Coalesced = 0;
+	/** Requests turned away because the queue of their priority was full. */
+	UPROPERTY(BlueprintReadOnly, Category = "FA|PathQueryScheduler")
+	int64 Rejected = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "FA|PathQueryScheduler")
+	int64 Cancelled = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "FA|PathQueryScheduler")
+	int64 Completed = 0;
+	/** Milliseconds from request to handing over the path, over the completed requests. */
+	UPROPERTY(BlueprintReadOnly, Category = "FA|PathQueryScheduler")
+	double AverageLatency = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "FA|PathQueryScheduler")
+	double MaxLatency = 0;
+};
+
+/** Requests with the same key find the same path segment, so they can share one search. */
+struct FFAPathQueryKey
+{
+	FFANodeHandle StartNode;
+	uint32 EndHPANode = 0;
+	/** The node the whole path ends at, whichever segment is searched. */
+	FFANodeHandle EndNode;
+	uint32 ColliderSizeClass = 0;
+
+	bool operator==(const FFAPathQueryKey& Other) const
+	{
+		return StartNode == Other.StartNode && EndHPANode == Other.EndHPANode && EndNode == Other.EndNode &&
+			ColliderSizeClass == Other.ColliderSizeClass;
+	}
+
+	friend uint32 GetTypeHash(const FFAPathQueryKey& Key)
+	{
+		return HashCombineFast(HashCombineFast(GetTypeHash(Key.StartNode), GetTypeHash(Key.EndHPANode)),
+		                       HashCombineFast(GetTypeHash(Key.EndNode), GetTypeHash(Key.ColliderSizeClass)));
+	}
+};
+
+/**
+ * @brief Queue of path queries stepped within a time budget, higher priorities first and in turns within a priority.
+ * Identical requests share one search, and each priority holds a bounded number of searches so a spike of
+ * requests can't delay the more important ones. Requests can be made and cancelled from any thread, the queries are
+ * stepped and their callbacks called on the thread ticking the scheduler.
+ */
+class FACORE_API FFAPathQueryScheduler
+{
+public:
+	/**
+	 * @brief Queue a query.
+	 * @param Key Queries with the same key share the search of the first one still queued, unset to never share.
+	 * @param Owner Requests of an owner can be cancelled together, e.g. the agent moving.
+	 * @param MaxSearches Searches the priority may hold, requests over it are rejected unless they share a search.
+	 * @param OnFinished Called with the path when the search ends, not if the request is cancelled.
+	 * @return Id of the request, INDEX_NONE if it is rejected.
+	 */
+	int32 Schedule(const TSharedRef<FFAPathQuery>& Query, const TOptional<FFAPathQueryKey>& Key,
+	               EFAPathQueryPriority Priority, FObjectKey Owner, int32 MaxSearches,
+	               FFAOnPathQueryFinished OnFinished);
+	/** Drop a request. The search goes on if other requests share it. */
+	void Cancel(int32 RequestId);
+	/** Drop every request of an owner. @return The number of requests dropped. */
+	int32 CancelOwner(FObjectKey Owner);
+	/** Whether a request is queued, neither handed over nor cancelled. */
+	bool IsPending(int32 RequestId) const;
+	/** Number of queued requests. */
+	int32 Num() const;
+	/** Drop every request without calling back. */
+	void Reset();
+
+	/**
+	 * @brief Step the searches in turns until all ended or the budget is used, then hand the ended ones over.
+	 * @param ExpansionsPerStep Nodes a search expands before the next search of its priority takes its turn.
+	 */
+	void Tick(double BudgetSeconds, int32 ExpansionsPerStep);
+
+	FFAPathQuerySchedulerStats GetStats(EFAPathQueryPriority Priority) const;
+	/** Reset the counters and latencies, queue depths are kept. */
+	void ResetStats();
+
+private:
+	/** One search, shared by the requests with its key. */
+	struct FSearch
+	{
+		TSharedRef<FFAPathQuery> Query;
+		TOptional<FFAPathQueryKey> Key;
+		/** The highest priority of its requests. */
+		EFAPathQueryPriority Priority;
+		TArray<int32> RequestIds;
+	};
+
+	struct FRequest
+	{
+		/** The query made for the request, given the result of the search it shares if it is not the search's. */
+		TSharedRef<FFAPathQuery> Query;
+		TSharedRef<FSearch> Search;
+		EFAPathQueryPriority Priority;
+		FObjectKey Owner;
+		FFAOnPathQueryFinished OnFinished;
+		double RequestTime;
+	};
+
+	struct FPriorityStats
+	{
+		int32 QueueDepth = 0;
+		int64 Requests = 0;
+		int64 Coalesced = 0;
+		int64 Rejected = 0;
+		int64 Cancelled = 0;
+		int64 Completed = 0;
+		double TotalLatency = 0;
+		double MaxLatency = 0;
+	};
+
+	static constexpr int32 NumPriorities = static_cast<int32>(EFAPathQueryPriority::Num);
+
+	/** Remove a request, and its search if no other request shares it. Call with the lock held. */
+	void RemoveRequest(int32 RequestId);
+	/** Remove a search from its priority and the shared searches. Call with the lock held. */
+	void RemoveSearch(const TSharedRef<FSearch>& Search);
+
+	mutable FCriticalSection Lock;
+	TMap<int32, FRequest> Requests;
+	/** Searches of each priority in the order they take turns. */
+	TArray<TSharedRef<FSearch>> Searches[NumPriorities];
+	/** The search of each priority that takes the first turn of the next tick. */
+	int32 NextTurns[NumPriorities] = {};
+	/** Queued searches by the key requests share them with. */
+	TMap<FFAPathQueryKey, TSharedRef<FSearch>> SharedSearches;
+	int32 NextRequestId = 0;
+	FPriorityStats Stats[NumPriorities];
+	/** Searches stepped by the current tick, so requests can be made while they are stepped. */
+	TArray<TSharedRef<FSearch>> SteppingSearches[NumPriorities];
+};
@@ -0,0 +1,31 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * @brief Cancels a path query from any thread. The query checks it between expansions and stops with
+ * \c EFAPathQueryStatus::Cancelled soon after, so nobody has to wait for a whole search.
+ * A token is also cancelled through its parent, e.g. the token of every query of a subsystem being destroyed.
+ */
+class FACORE_API FFAPathQueryToken
+{
+public:
+	explicit FFAPathQueryToken(TSharedPtr<const FFAPathQueryToken, ESPMode::ThreadSafe> InParent = nullptr)
+		: Parent(MoveTemp(InParent))
+	{
+	}
+
+	void Cancel() { bCancelled.store(true, std::memory_order_relaxed); }
+
+	bool IsCancelled() const
+	{
+		return bCancelled.load(std::memory_order_relaxed) || (Parent && Parent->IsCancelled());
+	}
+
+private:
+	std::atomic<bool> bCancelled{false};
+	TSharedPtr<const FFAPathQueryToken, ESPMode::ThreadSafe> Parent;
+};
@@ -0,0 +1,76 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FAIndexedHeap.h"
+#include "FANodeHandle.h"
+
+class AFABound;
+
+/**
+ * @brief A node reached by a path search. Only refers to the node, read from the resolved nodes of its bound, so
+ * expanding a node copies nothing of it. The path nodes are made of the records on the path only.
+ */
+struct FFAPathSearchRecord
+{
+	AFABound* Bound = nullptr;
+	FFANodeHandle Handle;
+	//Where the path enters the node.
+	FVector StartLocation = FVector::ZeroVector;
+	//gCost and hCost.
+	FVector2D Cost = FVector2D::ZeroVector;
+};
+
+/**
+ * @brief The search state of a path query: records, parent links, closed set and open set.
+ * Taken from a cache of the thread when a search starts and given back reset but not freed when it ends, so
+ * steady path queries allocate nothing once the cache holds as many as run at once on the thread.
+ * Not copyable, the open set refers to the records.
+ */
+struct FACORE_API FFAPathSearchScratch
+{
+	//Less fCost first, or the same but less hCost.
+	struct FCompareRecords
+	{
+		const TArray<FFAPathSearchRecord>* Records;
+
+		bool operator()(int32 A, int32 B) const
+		{
+			const FVector2D& CostA = (*Records)[A].Cost;
+			const FVector2D& CostB = (*Records)[B].Cost;
+			if (CostA.X + CostA.Y != CostB.X + CostB.Y) return CostA.X + CostA.Y < CostB.X + CostB.Y;
+			if (CostA.Y != CostB.Y) return CostA.Y < CostB.Y;
+			return A < B;
+		}
+	};
+
+	FFAPathSearchScratch()
+		: OpenSet(FCompareRecords{&Records})
+	{
+	}
+
+	FFAPathSearchScratch(const FFAPathSearchScratch&) = delete;
+	FFAPathSearchScratch& operator=(const FFAPathSearchScratch&) = delete;
+
+	/** A reset scratch from the cache of the calling thread, allocated if the cache is empty. */
+	static TUniquePtr<FFAPathSearchScratch> Acquire();
+	/** Reset a scratch and cache it for the calling thread, or free it if it is too large or the cache is full. */
+	static void Release(TUniquePtr<FFAPathSearchScratch> Scratch);
+	/** The largest scratch released so far, in bytes. */
+	static SIZE_T GetPeakAllocatedSize();
+	/** Scratches alive, in use or cached. Stops growing once the caches are warm. */
+	static int32 GetNumAllocated();
+
+	/** Empty every container but keep the memory. */
+	void Reset();
+	SIZE_T GetAllocatedSize() const;
+
+	//The index of a record is the compact handle of its node for the search.
+	TArray<FFAPathSearchRecord> Records;
+	//Parent record of each record, INDEX_NONE for the start node.
+	TArray<int32> PathLink;
+	TMap<FFANodeHandle, int32> Handles;
+	TBitArray<> ClosedSet;
+	TFAIndexedHeap<FCompareRecords> OpenSet;
+};
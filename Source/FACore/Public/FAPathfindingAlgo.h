@@ -8,6 +8,8 @@
 #include "UObject/Object.h"
 #include "FAPathfindingAlgo.generated.h"
 
+class FFAPathQuery;
+
 /**
  * 
  */
@@ -40,16 +42,12 @@ public:
 	                          UWorld* World, const UFAPathfindingSettings* Settings,
 	                          FVector ColliderSize = FVector::ZeroVector,
 	                          const FVector ColliderOffset = FVector::ZeroVector) const;
-
-	UFUNCTION(BlueprintCallable, Category = "FA|Pathfinding")
-	static bool IsGenerating()
-	{
-		UE::TScopeLock Lock(PathGenCalledNumLock);
-		return PathGenCalledNum > 0;
-	}
-
-private:
-	//Should be replaced by terminating thread. Task cannot be aborted and therefore this is here for preventing null bound pointer.
-	static uint32 PathGenCalledNum;
-	static UE::FSpinLock PathGenCalledNumLock;
+	/**
+	 * @brief Create a search of the current segment of a path, to be stepped over frames by the scheduler of the
+	 * world subsystem. \c GeneratePath runs one to the end.
+	 */
+	virtual TSharedRef<FFAPathQuery> CreatePathQuery(FFAFinePath FinePath, const FFAPathNodeData& EndNode,
+	                                                 UWorld* World, const UFAPathfindingSettings* Settings,
+	                                                 const FVector& ColliderSize,
+	                                                 const FVector& ColliderOffset) const;
 };
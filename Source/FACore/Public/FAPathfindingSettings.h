@@ -13,6 +13,15 @@
  * 
  */
 
+UENUM()
+enum class EFAThreadPriority : uint8
+{
+	Lowest,
+	BelowNormal,
+	Normal,
+	AboveNormal
+};
+
 USTRUCT(BlueprintType)
 struct FFAMapSettings
 {
@@ -36,4 +45,71 @@ public:
 	TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypes;
 	UPROPERTY(Config, EditAnywhere, Category = "Pathfinding")
 	TMap<TSoftObjectPtr<UWorld>, FFAMapSettings> MapsSettings;
+	/** Cache collider overlap results of edges so repeated queries through the same area skip the physics scene. */
+	UPROPERTY(Config, EditAnywhere, Category = "Pathfinding|Edge Clearance Cache")
+	bool bUseEdgeClearanceCache = true;
+	/** Entries a bound's cache can hold. The oldest are evicted past it. */
+	UPROPERTY(Config, EditAnywhere, Category = "Pathfinding|Edge Clearance Cache",
+		meta = (ClampMin = 1, EditCondition = "bUseEdgeClearanceCache"))
+	int32 MaxEdgeClearanceCacheEntries = 1 << 20;
+	/**
+	 * Distinct collider sizes and offsets whose edges are cached and searches shared. Agents of further sizes search
+	 * on their own, uncached.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Pathfinding|Edge Clearance Cache",
+		meta = (ClampMin = 1, EditCondition = "bUseEdgeClearanceCache"))
+	int32 MaxColliderSizeClasses = 256;
+	/**
+	 * Time the world subsystem steps scheduled path queries for every tick, shared by all of them.
+	 * A query that doesn't finish in it carries on the next tick.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Pathfinding|Scheduler", meta = (ClampMin = 1))
+	int32 PathQueryFrameBudgetMicroseconds = 2000;
+	/** Nodes a scheduled path query expands before the next query takes its turn. */
+	UPROPERTY(Config, EditAnywhere, Category = "Pathfinding|Scheduler", meta = (ClampMin = 1))
+	int32 PathQueryExpansionsPerStep = 64;
+	/** Searches each priority of scheduled path queries holds at most, requests over it are rejected until some end. */
+	UPROPERTY(Config, EditAnywhere, Category = "Pathfinding|Scheduler", meta = (ClampMin = 1))
+	int32 MaxQueuedPathSearches = 256;
+	/**
+	 * Threads of the pool running blocking path and location queries. 0 to use half the cores, at least one, so
+	 * the game thread and the engine's task workers keep the rest. Editor generation runs on the engine's tasks.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Pathfinding|Thread Pool", meta = (ClampMin = 0, ClampMax = 64))
+	int32 PathfindingWorkerCount = 0;
+	/** Above normal may starve the game thread when the queries outnumber the cores. */
+	UPROPERTY(Config, EditAnywhere, Category = "Pathfinding|Thread Pool")
+	EFAThreadPriority PathfindingWorkerPriority = EFAThreadPriority::BelowNormal;
+	/** Cores the workers may run on, one bit per core. 0 for any core. */
+	UPROPERTY(Config, EditAnywhere, Category = "Pathfinding|Thread Pool")
+	int64 PathfindingWorkerAffinityMask = 0;
+	UPROPERTY(Config, EditAnywhere, Category = "Pathfinding|Thread Pool", meta = (ClampMin = 32))
+	int32 PathfindingWorkerStackSizeKB = 128;
+
+	/** The worker count of the settings, resolved for this machine. */
+	int32 GetNumPathfindingWorkers() const;
+	EThreadPriority GetPathfindingWorkerThreadPriority() const;
+
+	/** Bisection steps used to refine the clearance of each node during generation. More steps give tighter clearance. */
+	UPROPERTY(Config, EditAnywhere, Category = "Generation", meta = (ClampMin = 0, ClampMax = 16))
+	int32 ClearanceRefinementSteps = 4;
+	/**
+	 * Nodes shallower than this depth generate their children in parallel tasks, deeper branches run serially.
+	 * Higher values balance dense areas across more cores at the cost of more tasks.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Generation", meta = (ClampMin = 0, ClampMax = 6))
+	int32 GenerationParallelDepth = 3;
+	/**
+	 * Voxelize the collision geometry of the environment before generating, instead of a physics query per node.
+	 * Geometry that can't be voxelized, e.g. capsules or landscapes, is still queried. Needs MaxDepth under 10.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Generation")
+	bool bVoxelizeGeneration = true;
+	/**
+	 * Depth of the subtrees regenerated when environment actors of a generated bound change in the editor.
+	 * Changed leaves deeper than this are regenerated from their ancestor at this depth, shallower ones by themselves.
+	 * Deeper subtrees regenerate less of the bound but may leave more nodes than a full generation would.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Generation", meta = (ClampMin = 0, ClampMax = 9))
+	int32 IncrementalRegenerationDepth = 2;
 };
@@ -0,0 +1,17 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("FlyingAI"), STATGROUP_FlyingAI, STATCAT_Advanced);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Edge Clearance Cache Hits"),
+                                      STAT_FA_EdgeClearanceCacheHits, STATGROUP_FlyingAI, FACORE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Edge Clearance Cache Misses"),
+                                      STAT_FA_EdgeClearanceCacheMisses, STATGROUP_FlyingAI,
+                                      FACORE_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Edge Clearance Cache Invalidations"),
+                                      STAT_FA_EdgeClearanceCacheInvalidations, STATGROUP_FlyingAI,
+                                      FACORE_API);
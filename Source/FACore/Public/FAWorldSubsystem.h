@@ -4,10 +4,18 @@
 
 #include "CoreMinimal.h"
 #include "FABoundData.h"
+#include "FABoundTree.h"
+#include "FAEdgeClearanceCache.h"
+#include "FAHPAGraph.h"
+#include "FAOccupancyGrid.h"
+#include "FAPathQueryScheduler.h"
+#include "FAPathQueryToken.h"
 #include "FANode.h"
+#include "FANodeHandle.h"
 #include "Misc/SpinLock.h"
 #include "Subsystems/WorldSubsystem.h"
 #include "Tasks/Task.h"
+#include "Async/Async.h"
 #include "Async/Future.h"
 #include "FAWorldSubsystem.generated.h"
 
@@ -17,6 +25,7 @@ class UFABoundData;
 class UFANewNode;
 class UDataTable;
 class UCompositeDataTable;
+class UFANavOctreeData;
 /**
  * 
  */
@@ -33,15 +42,15 @@ struct FFAPathNodeData
 	//The position should always be the real location instead of the generation location.
 	FFaNodeData NodeData;
 	UPROPERTY()
-	//The key to access the node in the data table.
-	FName NodeName;
-	UPROPERTY()
 	// The bound that the node is in.
 	AFABound* NodeBound;
+	UPROPERTY(BlueprintReadOnly, Category = "FA|PathNodeData")
+	//The identity of the node.
+	FFANodeHandle Handle;
 
 	bool operator==(const FFAPathNodeData& other) const
 	{
-		return NodeName == other.NodeName && NodeBound == other.NodeBound;
+		return Handle == other.Handle && NodeBound == other.NodeBound;
 	}
 };
 
@@ -99,7 +108,18 @@ struct FFANewNodeChildType
 	FName ChildrenName[8];
 };
 
+//Generated nodes to add to a data table, by row name.
+using FFANodeGenRows = TArray<TPair<FName, FFaNodeData>>;
+
+//A dynamic obstacle and the bounds it overlaps, loaded or not. Those not loaded are blocked once they load.
+struct FFADynamicObstacle
+{
+	FBox Box;
+	TArray<TWeakObjectPtr<AFABound>> Bounds;
+};
+
 DECLARE_MULTICAST_DELEGATE(FFAOnSystemReady)
+DECLARE_DYNAMIC_DELEGATE_OneParam(FFAOnPathQueryFinishedDynamic, const FFAFinePath&, FinePath);
 
 namespace FA
 {
@@ -112,16 +132,54 @@ namespace FA
 }
 
 UCLASS()
-class FACORE_API UFAWorldSubsystem : public UWorldSubsystem
+class FACORE_API UFAWorldSubsystem : public UTickableWorldSubsystem
 {
 	GENERATED_BODY()
 
 public:
+	/**
+	 * @brief Generate the nodes under a node, adding the leaves to \c OutRows .
+	 * Children of nodes shallower than \c ParallelDepth are generated in their own tasks with their own rows,
+	 * merged when they finish. Deeper branches are generated serially in the calling task.
+	 * @param TableName Name of the data table the rows are added to, prefix of the row names.
+	 * @param Grid Voxelized environment of the bound, nullptr to query the physics scene for every node.
+	 */
 	uint8 GenerateNodeBranch(const UFABoundData* BoundData, UWorld* World,
-	                         TSharedPtr<FFaNodeData> Node, FName NodeName, int nodeIndex,
-	                         UE::FSpinLock* DataLock, UDataTable* Data);
-	void SetHPAIndex(UDataTable* CombinedNodes, UDataTable* DataTable,
-	                 TArray<AFABound*>& InHPAIndex, UE::FSpinLock& _csHPAIndex);
+	                         TSharedPtr<FFaNodeData> Node, const FString& TableName, int64 nodeIndex,
+	                         int32 ParallelDepth, FFANodeGenRows& OutRows,
+	                         const FFAOccupancyGrid* Grid = nullptr);
+	/**
+	 * @brief Gather the collision geometry that generation overlaps nodes with, to voxelize it.
+	 * Reads components, so call on the game thread.
+	 * @param Bounds Only geometry overlapping the box is gathered.
+	 */
+	void GatherOccupancyShapes(UWorld* World, const FBox& Bounds, FFAOccupancyShapes& OutShapes) const;
+	/**
+	 * @brief Set the neighbours of every node generated in a bound to the nodes touching it.
+	 * Found from the octree cells of the nodes, so each node only looks at the cells around it.
+	 * @param DataTables Tables the rows of the bound are generated in.
+	 * @param BoundPosition Position of the bound when the nodes were generated.
+	 * @return Whether the neighbours of any row of each table changed. Rows whose neighbours are unchanged are left
+	 * as they are.
+	 */
+	static TArray<bool> SetNodeNeighbours(const TArray<UDataTable*>& DataTables, const FVector& BoundPosition,
+	                                      const FVector& BoundHalfExtent);
+	/**
+	 * @brief Set the HPA index of every traversable node to its cluster, the connected nodes of its table.
+	 * Clusters are labelled by union-find over the neighbours, the tables in parallel.
+	 * @param InHPAIndex An element is added for each cluster, the clusters of the tables in order.
+	 * @return The number of clusters added.
+	 */
+	static int32 SetHPAIndex(const TArray<UDataTable*>& DataTables, TArray<AFABound*>& InHPAIndex);
+	/**
+	 * @brief Relabel the clusters of one table after some of its nodes are regenerated.
+	 * @param ReusedIndices HPA indices the table had before, given to its clusters first so the other tables keep
+	 * theirs.
+	 * @param InOutHPAIndex An element is added for each cluster beyond the reused indices.
+	 * @return The number of clusters of the table.
+	 */
+	static int32 RelabelHPAIndex(const UDataTable* DataTable, TArray<uint32> ReusedIndices,
+	                             TArray<AFABound*>& InOutHPAIndex);
 
 	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
 	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
@@ -129,16 +187,51 @@ public:
 	//Subdividing node into 8 octants.
 	static void Subdivide(TSharedPtr<FFaNodeData> Node, FFANewNodeChildType& Children);
 
+	virtual void Deinitialize() override;
 	virtual void BeginDestroy() override;
+	/** Step the scheduled path queries. */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
 	/**
 	 * @brief Register Bound to the system to use it in the world.
 	 */
 	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
 	void RegisterBoundInWorld(AFABound* Bound);
+	/**
+	 * @brief Stop using a registered bound. Paths are no longer found through it.
+	 * Called automatically when a registered bound is destroyed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	void UnregisterBoundInWorld(AFABound* Bound);
+	/** Registered bounds containing the point. */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	TArray<AFABound*> FindBoundsAtPoint(const FVector& Point);
+	/** Registered bounds overlapping the box, touching included. */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	TArray<AFABound*> FindBoundsInBox(const FBox& Box);
+	/** Registered bounds hit by the segment. */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	TArray<AFABound*> FindBoundsAlongSegment(const FVector& Start, const FVector& End);
 
 protected:
+	/**
+	 * @brief Connect the nodes of two overlapping bounds, from the stitch cooked with their bound data if it is
+	 * still valid, otherwise found now. Kept in memory by both bounds.
+	 */
 	UFUNCTION()
 	void SetBoundNeighbour(AFABound* Bound0, AFABound* Bound1);
+	/**
+	 * @brief Node pairs of the stitch cooked between the bound data of two bounds.
+	 * @return False if there is none, or the bounds were regenerated or moved relative to each other since.
+	 */
+	static bool FindBoundStitch(const AFABound* Bound0, const AFABound* Bound1,
+	                            TArray<TPair<uint32, uint32>>& OutPairs);
+	/**
+	 * @brief Label the connected traversable nodes of a table by union-find over their neighbours.
+	 * @param OutLabels Each traversable node with its label, in order of the rows.
+	 * @return The number of labels.
+	 */
+	static int32 LabelTableClusters(const UDataTable* DataTable, TArray<TPair<FFaNodeData*, int32>>& OutLabels);
 	UFUNCTION()
 	void RegisterBoundInWorldStartUp();
 	UPROPERTY(BlueprintReadOnly, Category = "FA|WorldSubsystem")
@@ -149,6 +242,8 @@ protected:
 	UPROPERTY(BlueprintReadOnly, Category = "FA|WorldSubsystem")
 	UFAPathfindingAlgo* PathfindingAlgo;
 	TArray<UE::Tasks::FTask> SetHPATasks;
+	/** Wait for \c SetHPATasks , running the game thread tasks they wait for if called on the game thread. */
+	void WaitSetHPATasks();
 	UPROPERTY()
 	TArray<AActor*> ActorsToIgnore;
 
@@ -156,12 +251,12 @@ public:
 	//Both points have to be in LOD 0, 1 bounds which have nodesData loaded.
 	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
 	FFAHPAPath CreateHPAPath(const FVector& StartLocation, const FVector& EndLocation);
-	//Blocks thread and may cause short-freeze. Intended to not run on game thread.
+	//Blocks thread and may cause short-freeze. Intended to not run on game thread, use RequestNextFinePath there.
 	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
 	FFAFinePath CreateNextFinePath(const FFAFinePath& InFinePath,
 	                               const FVector& ColliderSize = FVector::ZeroVector,
 	                               const FVector& ColliderOffset = FVector::ZeroVector);
-	//Blocks thread and may cause short-freeze. Intended to not run on game thread.
+	//Blocks thread and may cause short-freeze. Intended to not run on game thread, use RequestFinePathByHPA there.
 	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
 	FFAFinePath CreateFinePathByHPA(FFAHPAPath HPAPath, FVector ColliderSize = FVector::ZeroVector,
 	                                const FVector& ColliderOffset = FVector::ZeroVector);
@@ -184,17 +279,86 @@ public:
 	                                             const FVector& ColliderSize,
 	                                             const FVector& ColliderOffset =
 		                                             FVector::ZeroVector);
+
+	/**
+	 * @brief Schedule the creation of a path from an HPA*-searched path, which should be the beginning of the path.
+	 * The search is stepped on the game thread every tick, sharing the path query budget of the settings with the
+	 * other scheduled queries, so it never blocks a thread. Agents of the same collider size class starting from
+	 * the same node to the same segment end share one search.
+	 * @param OnFinished Called with the path when the search ends, not if it is cancelled.
+	 * @param Owner The agent of the query, to cancel every query of it together.
+	 * @return Id of the query to cancel it, INDEX_NONE if the queue of the priority is full. Request again later.
+	 */
+	int32 RequestFinePathByHPA(const FFAHPAPath& HPAPath, FFAOnPathQueryFinished OnFinished,
+	                           const FVector& ColliderSize = FVector::ZeroVector,
+	                           const FVector& ColliderOffset = FVector::ZeroVector,
+	                           EFAPathQueryPriority Priority = EFAPathQueryPriority::Normal,
+	                           const UObject* Owner = nullptr);
+	/**
+	 * @brief Schedule the creation of a path from an existing path, stepped like \c RequestFinePathByHPA .
+	 * @param OnFinished Called with the path when the search ends, not if it is cancelled.
+	 * @param Owner The agent of the query, to cancel every query of it together.
+	 * @return Id of the query to cancel it, INDEX_NONE if the queue of the priority is full. Request again later.
+	 */
+	int32 RequestNextFinePath(const FFAFinePath& InFinePath, FFAOnPathQueryFinished OnFinished,
+	                          const FVector& ColliderSize = FVector::ZeroVector,
+	                          const FVector& ColliderOffset = FVector::ZeroVector,
+	                          EFAPathQueryPriority Priority = EFAPathQueryPriority::Normal,
+	                          const UObject* Owner = nullptr);
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem",
+		meta = (DisplayName = "Request Fine Path By HPA", DefaultToSelf = "Owner"))
+	int32 K2_RequestFinePathByHPA(const FFAHPAPath& HPAPath, const FFAOnPathQueryFinishedDynamic& OnFinished,
+	                              FVector ColliderSize, FVector ColliderOffset,
+	                              EFAPathQueryPriority Priority, UObject* Owner);
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem",
+		meta = (DisplayName = "Request Next Fine Path", DefaultToSelf = "Owner"))
+	int32 K2_RequestNextFinePath(const FFAFinePath& InFinePath, const FFAOnPathQueryFinishedDynamic& OnFinished,
+	                             FVector ColliderSize, FVector ColliderOffset, EFAPathQueryPriority Priority,
+	                             UObject* Owner);
+	/** Stop a scheduled path query. Its callback is not called. */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	void CancelPathQuery(int32 QueryId);
+	/** Stop every scheduled path query of an agent. */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	void CancelPathQueriesOf(const UObject* Owner);
+	/** Whether a scheduled path query has not ended and is not cancelled. */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	bool IsPathQueryPending(int32 QueryId);
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	int32 GetNumPendingPathQueries();
+	/** Queue depth, coalescing and latency of the scheduled path queries of a priority. */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	FFAPathQuerySchedulerStats GetPathQueryStats(EFAPathQueryPriority Priority);
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	void ResetPathQueryStats();
+
 	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
 	void InterpolateFinePath(FFAFinePath& InFinePath);
 
 	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
 	FFAPathNodeData PointToNodeInBound(FVector Point, AFABound* Bound);
+	/** Get the registered bound a handle refers to, nullptr if the bound is not registered. */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	AFABound* GetBoundByHandle(const FFANodeHandle& Handle);
 
+	//Used for generation only.
+	bool IsNodeOccupied(FFaNodeData* NodeData, const FFAOccupancyGrid* Grid, UWorld* World) const;
 	//Used for generation only.
 	static bool IsNodeOverlapping(FFaNodeData* NodeData,
 	                              const TArray<TEnumAsByte<EObjectTypeQuery>>& ObjectTypes,
 	                              TSubclassOf<AActor> ActorClassToConsider,
 	                              const TArray<AActor*>& ActorsToIgnore, UWorld* World);
+	/**
+	 * @brief Find the half extent of the largest axis-aligned cube centred on a traversable node that is free of the environment.
+	 * Used for generation only.
+	 * @param MaxClearance The clearance to stop growing at.
+	 * @param RefinementSteps Bisection steps after the cube first overlaps the environment.
+	 */
+	static float ComputeNodeClearance(const FFaNodeData* NodeData, float MaxClearance,
+	                                  int32 RefinementSteps,
+	                                  const TArray<TEnumAsByte<EObjectTypeQuery>>& ObjectTypes,
+	                                  TSubclassOf<AActor> ActorClassToConsider,
+	                                  const TArray<AActor*>& ActorsToIgnore, UWorld* World);
 	FFAOnSystemReady& GetOnSystemReady() { return OnSystemReady; }
 	UFUNCTION()
 	TArray<AFABound*>& GetRegisteredBound()
@@ -203,8 +367,6 @@ public:
 		return RegisteredBound;
 	}
 
-	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
-	class UFANeighbourData* GetNeighbourData(FString Key);
 	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
 	bool GetGameSystemReady()
 	{
@@ -212,33 +374,148 @@ public:
 		return GameSystemReady;
 	}
 
+	/** The pool of the blocking path and location queries, sized by the settings. Not for editor generation. */
 	class FQueuedThreadPool* GetThreadPool()
 	{
 		UE::TScopeLock Lock(ThreadPoolLock);
 		return ThreadPool;
 	}
 
+	/** Run a function on the thread pool, on the cores the settings allow. */
+	template <typename FunctionType>
+	auto LaunchOnThreadPool(FunctionType&& Function, TUniqueFunction<void()> OnCompletion = nullptr)
+	{
+		return AsyncPool(*GetThreadPool(), [this, Function = Forward<FunctionType>(Function)]() mutable
+		{
+			PinWorkerThread();
+			return Function();
+		}, MoveTemp(OnCompletion));
+	}
+
 	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
 	/**
 	 * @brief Include touch.
 	 */
 	static bool AABBOverlap(FVector P1, FVector P2, FVector H1, FVector H2);
+	/**
+	 * @brief Centre of the overlap of two boxes. Only meaningful if \c AABBOverlap .
+	 */
+	static FVector AABBOverlapCentre(FVector P1, FVector P2, FVector H1, FVector H2);
+	/**
+	 * @brief Find the pairs of a box of each set overlapping, touch included, by sweep and prune along an axis.
+	 * Boxes are swept by their minimum on the axis and only tested against boxes of the other set still open.
+	 * @param OutPairs Index in \c BoxesA and index in \c BoxesB of each pair.
+	 */
+	static void SweepAndPrune(TConstArrayView<FBox> BoxesA, TConstArrayView<FBox> BoxesB, int32 Axis,
+	                          TArray<TPair<int32, int32>>& OutPairs);
+	/**
+	 * @brief Find the traversable nodes of two bounds touching across the overlap of the bounds, in their current
+	 * locations. Only the leaves on the overlap are swept, so the cost follows the area of the overlap.
+	 * @param OutPairs Node index in \c Bound0 and node index in \c Bound1 of each pair.
+	 */
+	static void FindBoundaryNodePairs(const AFABound* Bound0, const UFANavOctreeData* NavData0,
+	                                  const AFABound* Bound1, const UFANavOctreeData* NavData1,
+	                                  TArray<TPair<uint32, uint32>>& OutPairs);
+
+	/**
+	 * @brief Get the class of a collider used to share cached edge clearance between agents of the same size.
+	 * Every distinct size and offset gets its own class, up to \c MaxColliderSizeClasses of the settings.
+	 * @return INDEX_NONE past them, the collider's edges are not to be cached nor its searches shared.
+	 */
+	uint32 GetColliderSizeClass(const FVector& ColliderSize, const FVector& ColliderOffset);
+	/**
+	 * @brief Invalidate cached edge clearance of bounds that may be affected by a change of the environment in Box.
+	 * Spawned and destroyed environment actors are handled automatically. Call this when environment actors move.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	void NotifyEnvironmentChanged(const FBox& Box);
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	void InvalidateEdgeClearanceCaches();
+	/** Sum of the edge clearance cache stats of every registered bound. */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	FFAEdgeClearanceCacheStats GetEdgeClearanceCacheStats();
+
+	/**
+	 * @brief Block the nodes of the bounds overlapping a box until the obstacle is removed, e.g. a closed door
+	 * or a spawned barrier. Bounds not loaded are blocked when they load. Paths are searched around it without physics queries, and the HPA portals of the
+	 * clusters it overlaps are recomputed. Call on the game thread.
+	 * @return Id of the obstacle to update or remove it.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	int32 AddDynamicObstacle(const FBox& Box);
+	/** Move an obstacle, unblocking the nodes it left. */
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	void UpdateDynamicObstacle(int32 ObstacleId, const FBox& Box);
+	UFUNCTION(BlueprintCallable, Category = "FA|WorldSubsystem")
+	void RemoveDynamicObstacle(int32 ObstacleId);
+	/**
+	 * Whether a box overlaps a dynamic obstacle, touch excluded. Path queries test only the obstacles of their
+	 * bounds instead, through the obstacle overlays.
+	 */
+	bool OverlapsDynamicObstacle(const FBox& Box);
+	/**
+	 * @brief Block the nodes of a bound that just loaded its nodes data by the obstacles overlapping it, dropping
+	 * the nodes blocked in other nodes data first. Call on the game thread.
+	 */
+	void ApplyDynamicObstacles(AFABound* Bound);
 
 protected:
 	UFUNCTION()
-	FFAHPAPath InternalCreateHPAPath(FVector StartLocation, FVector EndLocation,
-	                                 TArray<AFABound*> Bounds);
+	FFAHPAPath InternalCreateHPAPath(FVector StartLocation, FVector EndLocation);
 	UPROPERTY()
 	TArray<AFABound*> RegisteredBound;
-	/*!< Bounds that are registered for using pathfinding. Call \c RegisterBoundInWorld to register bound that is spawned dynamically.*/
+	/*!< Bounds that are registered for using pathfinding. Call \c RegisterBoundInWorld to register bound that is spawned dynamically.
+	 * Unregistered bounds leave nullptr so the indices of other bounds do not change.*/
 
 	/** Critical section for accessing Registered Bound */
 	FCriticalSection RegisteredBoundLock;
+	/** Boxes of the registered bounds, the user data is the bound index. */
+	FFABoundTree BoundTree;
+	TMap<AFABound*, int32> BoundProxies;
+	FRWLock BoundTreeLock;
+	/** Add the bound to \c RegisteredBound and \c BoundTree , which follows it when it moves. */
+	void AddRegisteredBound(AFABound* Bound);
+	TArray<AFABound*> GetBoundsByIndices(const TArray<uint32>& Indices);
 	UPROPERTY()
 	TMap<uint32, FFAConnectedHPANode> HPAConnection;
 	FCriticalSection HPAConnectionLock;
-	UPROPERTY()
-	TMap<FString, TWeakObjectPtr<UFANeighbourData>> NeighboursData;
+	/** Weighted graph of portals between HPA nodes, searched by \c InternalCreateHPAPath . */
+	FFAHPAGraph HPAGraph;
+	FRWLock HPAGraphLock;
+	/** Add the portals of the bound to the HPA graph. Call after the global HPA nodes of the bound are set. */
+	void AddBoundToHPAGraph(AFABound* Bound);
+	/**
+	 * Block the nodes of an obstacle in the bounds it overlaps now, after unblocking the nodes it blocked before.
+	 * @param Box The box of the obstacle, nullptr to remove it.
+	 */
+	void SetDynamicObstacle(int32 ObstacleId, const FBox* Box);
+	/**
+	 * Recompute the portals of the clusters of nodes blocked or unblocked in a bound, to the clusters next to them
+	 * in the bound and in overlapping bounds, from the nodes not blocked.
+	 */
+	void UpdateObstacleClusters(AFABound* Bound, const TArray<uint32>& ChangedNodes);
+	TMap<int32, FFADynamicObstacle> DynamicObstacles;
+	int32 NextDynamicObstacleId = 0;
+	FRWLock DynamicObstaclesLock;
+
+	/** Run a query on the thread pool to the end, or until the subsystem is destroyed. */
+	FFAFinePath RunPathQuery(const TSharedRef<FFAPathQuery>& Query) const;
+	/** The beginning of a path from an HPA path, to search from. */
+	static FFAFinePath MakeFinePathByHPA(const FFAHPAPath& HPAPath);
+	/**
+	 * The next segment of a path, to search from.
+	 * @return False if there is nothing to search, \c OutFinePath is the result then.
+	 */
+	static bool MakeNextFinePath(const FFAFinePath& InFinePath, FFAFinePath& OutFinePath);
+	/** Add a query to the scheduler, shared with queued queries of the same segment and collider. */
+	int32 SchedulePathQuery(const TSharedRef<FFAPathQuery>& Query, const FVector& ColliderSize,
+	                        const FVector& ColliderOffset, EFAPathQueryPriority Priority, const UObject* Owner,
+	                        FFAOnPathQueryFinished OnFinished);
+	/** Path queries stepped every tick. */
+	FFAPathQueryScheduler PathQueryScheduler;
+	/** Parent of the tokens of the queries run on the thread pool, cancelled when the subsystem is destroyed. */
+	TSharedRef<FFAPathQueryToken, ESPMode::ThreadSafe> PathQueryToken =
+		MakeShared<FFAPathQueryToken, ESPMode::ThreadSafe>();
 
 	/** Call when the system is fully initialized and ready for use in game. */
 	FFAOnSystemReady OnSystemReady;
@@ -246,13 +523,27 @@ protected:
 	UPROPERTY()
 	UFAPathfindingSettings* Settings;
 	FQueuedThreadPool* ThreadPool = nullptr;
+	/** Cores the threads of the pool run on, 0 for any. */
+	uint64 WorkerAffinityMask = 0;
+	/** Pin the calling thread of the pool to \c WorkerAffinityMask , once per thread. */
+	void PinWorkerThread() const;
 	UPROPERTY()
 	//Is the Subsystem ready for use in game.
 	bool GameSystemReady = false;
 	/** Lock for accessing \c OnSystemReady and \c GameSystemReady */
 	UE::FSpinLock OnSystemReadyLock;
 	UE::FSpinLock ThreadPoolLock;
-	/** Lock for accessing \c NeighboursData . */
-	UE::FSpinLock NeighboursDataLock;
 	UE::FSpinLock csHPAIndex;
+
+	void OnEnvironmentActorChanged(AActor* Actor);
+	/** Refit the box of a registered bound in \c BoundTree after it moved or was scaled. */
+	void OnBoundTransformUpdated(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags,
+	                             ETeleportType Teleport);
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle ActorDestroyedHandle;
+	/** Collider size classes, keyed by size and offset. */
+	TMap<TPair<FVector, FVector>, uint32> ColliderSizeClasses;
+	UE::FSpinLock ColliderSizeClassesLock;
+	/** Largest extent of every registered collider, used to find bounds affected by a change. */
+	double MaxColliderReach = 0;
 };
@@ -12,6 +12,10 @@ void UFAGenUtilityWidget::NativeConstruct()
 {
 	Super::NativeConstruct();
 	GenerateButton->OnClicked.AddDynamic(this, &UFAGenUtilityWidget::GenerateButtonClicked);
+	if (RegenerateDirtyButton)
+	{
+		RegenerateDirtyButton->OnClicked.AddDynamic(this, &UFAGenUtilityWidget::RegenerateDirtyButtonClicked);
+	}
 
 	Path->SetObject(this);
 	Path->SetPropertyName(TEXT("DirectoryPath"));
@@ -51,3 +55,25 @@ void UFAGenUtilityWidget::GenerateButtonClicked()
 	}
 	system->GenerateBoundNodes(PathString, World, MaxDepth, SelectedBound.LoadSynchronous());
 }
+
+void UFAGenUtilityWidget::RegenerateDirtyButtonClicked()
+{
+	auto World = GEditor->GetEditorWorldContext().World();
+	if (!World)
+	{
+		UE_LOG(LogTemp, Error, TEXT("World is null"));
+		return;
+	}
+	auto system = World->GetSubsystem<UFANodeGenSubsystem>();
+	if (!system)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FA World Subsystem is null"));
+		return;
+	}
+	if (!system->HasDirtyBounds())
+	{
+		UE_LOG(LogTemp, Display, TEXT("No bound has changed since it was generated."));
+		return;
+	}
+	system->RegenerateDirtyBounds();
+}
@@ -3,7 +3,12 @@
 #include "FANodeGenSubsystem.h"
 
 #include "AssetToolsModule.h"
+#include "Algo/AnyOf.h"
+#include "Async/ParallelFor.h"
 #include "Engine/World.h"
+#include "Editor.h"
+#include "EngineUtils.h"
+#include "FABoundData.h"
 #include "FABound.h"
 #include "FAPathfindingSettings.h"
 #include "FAWorldSubsystem.h"
@@ -12,19 +17,32 @@
 #include "Factories/CompositeDataTableFactory.h"
 #include "Factories/DataAssetFactory.h"
 #include "Factories/DataTableFactory.h"
+#include "Misc/PackageName.h"
 
 FFANodeGenRunnable::FFANodeGenRunnable(FString Path, UWorld* World, AFABound* Bound,
                                        UFABoundData* BoundData,
-                                       const FFAOnNodeGenFinished::FDelegate& InOnNodeGenFinished)
+                                       const FFAOnNodeGenFinished::FDelegate& InOnNodeGenFinished,
+                                       TArray<FBox> InDirtyBoxes)
 	: World(World),
 	  Bound(Bound),
 	  BoundData(BoundData),
-	  Path(Path)
+	  Path(Path),
+	  DirtyBoxes(MoveTemp(InDirtyBoxes))
 {
 	Thread = FRunnableThread::Create(this, TEXT("FANodeGenThread"));
 	OnNodeGenFinished.Add(InOnNodeGenFinished);
 }
 
+FFANodeGenRunnable::FFANodeGenRunnable(UWorld* World, AFABound* Bound, UFABoundData* BoundData,
+                                       TArray<UDataTable*> InDataTables, TArray<FBox> InDirtyBoxes)
+	: World(World),
+	  Bound(Bound),
+	  BoundData(BoundData),
+	  DataTables(MoveTemp(InDataTables)),
+	  DirtyBoxes(MoveTemp(InDirtyBoxes))
+{
+}
+
 FFANodeGenRunnable::~FFANodeGenRunnable()
 {
 	if (Thread)
@@ -33,10 +51,6 @@ FFANodeGenRunnable::~FFANodeGenRunnable()
 		delete Thread;
 		Thread = nullptr;
 	}
-	for (auto Lock : DataTableLocks)
-	{
-		delete Lock;
-	}
 }
 
 bool FFANodeGenRunnable::Init()
@@ -47,68 +61,52 @@ bool FFANodeGenRunnable::Init()
 uint32 FFANodeGenRunnable::Run()
 {
 	startGenTime = FDateTime::UtcNow();
-	FFANewNodeChildType Children;
-	for (int i = 0; i < 8; i++)
-	{
-		Children.ChildrenName[i] = *FString::Printf(TEXT("%d_TN"), i);
-	}
-	BoundData->GeneratePosition = Bound->GetActorLocation();
-	Bound->Subdivide(Children);
 	auto Subsystem = World->GetSubsystem<UFAWorldSubsystem>();
-	DataTables.Reserve(8);
+	bool bIncremental = false;
+	if (DirtyBoxes.Num() > 0)
 	{
-		//Event to wait for all data tables created and move to next step.
 		FScopedEvent Event;
-		AsyncTask(ENamedThreads::GameThread, [this, &Event]()
+		AsyncTask(ENamedThreads::GameThread, [this, &bIncremental, &Event]
 		{
-			for (int i = 0; i < 8; i++)
-			{
-				DataTableLocks.Add(new UE::FSpinLock());
-				DataTables.Add(
-					CreateNodeDataTable(
-						Path, FString::Printf(TEXT("DT_%s_%d"), *Bound->GetName(), i)));
-			}
+			bIncremental = LoadNodeDataTables();
 			Event.Trigger();
 		});
 	}
+	if (bIncremental)
 	{
-		TArray<TFuture<uint8>> Results;
-		Results.Reserve(8);
-		TArray<UE::FSpinLock*> Locks;
-		Locks.Reserve(8);
-		for (int i = 0; i < 8; i++)
-		{
-			Locks.Add(new UE::FSpinLock());
-			Results.Add(AsyncPool(*Subsystem->GetThreadPool(),
-			                      [Subsystem, this, &Children, i, &Locks]
-			                      {
-				                      return Subsystem->GenerateNodeBranch(
-					                      BoundData, World, Children.Children[i],
-					                      Children.ChildrenName[i], 0, Locks[i], DataTables[i]);
-			                      }));
-		}
-		for (auto& Task : Results)
+		RegenerateDirtyNodes(Subsystem);
+	}
+	else
+	{
+		if (DirtyBoxes.Num() > 0)
 		{
-			FPlatformProcess::ConditionalSleep([&Task] { return Task.IsReady(); });
+			UE_LOG(LogFAWorldSubsystem, Warning,
+			       TEXT("%s was moved or its data tables are missing, regenerating the whole bound."),
+			       *Bound->GetName());
 		}
-		// Adding the top level nodes to data tables.
-		for (int i = 0; i < 8; i++)
+		DataTables.Reserve(8);
 		{
-			if (Results[i].Get() == 0 || Results[i].Get() == 2)
+			//Event to wait for all data tables created and move to next step.
+			FScopedEvent Event;
+			AsyncTask(ENamedThreads::GameThread, [this, &Event]()
 			{
-				Children.Children[i]->IsTraversable = Results[i].Get() == 0;
-				DataTables[i]->AddRow(Children.ChildrenName[i], *Children.Children[i]);
-			}
-			delete Locks[i];
+				for (int i = 0; i < 8; i++)
+				{
+					DataTables.Add(
+						CreateNodeDataTable(
+							Path, FString::Printf(TEXT("DT_%s_%d"), *Bound->GetName(), i)));
+				}
+				Event.Trigger();
+			});
 		}
-		UE_LOG(LogFAWorldSubsystem, Display, TEXT("Finish Generate Nodes"));
+		GenerateAllNodes(Subsystem);
 	}
 	{
 		FScopedEvent Event;
 		TArray<UPackage*> Packages;
-		for (auto dt : DataTables)
+		for (int i = 0; i < DataTables.Num(); i++)
 		{
-			Packages.Add(dt->GetPackage());
+			if (ChangedTables[i]) Packages.Add(DataTables[i]->GetPackage());
 		}
 		Packages.Add(BoundData->GetPackage());
 		AsyncTask(ENamedThreads::GameThread, [this, Packages, &Event]
@@ -131,42 +129,66 @@ uint32 FFANodeGenRunnable::Run()
 			Event.Trigger();
 		});
 	}
+	{
+		//Only rows whose neighbours changed are written, so regenerating a subtree leaves the other tables clean.
+		const TArray<bool> NeighboursChanged = UFAWorldSubsystem::SetNodeNeighbours(
+			DataTables, Bound->GetActorLocation(), Bound->GetHalfExtent());
+		for (int i = 0; i < DataTables.Num(); i++)
+		{
+			ChangedTables[i] |= NeighboursChanged[i];
+		}
+		UE_LOG(LogFAWorldSubsystem, Display, TEXT("Finish Setting Node Neighbours"));
+	}
 	//Set index to nodes for HPA* search.
 	{
-		TArray<TFuture<void>> Results;
-		Results.Reserve(8);
-		UE::FSpinLock Lock;
-		for (int i = 0; i < 8; i++)
+		const double StartTime = FPlatformTime::Seconds();
+		int32 NumClusters = 0;
+		if (bIncremental)
 		{
-			Results.Add(AsyncThread([i, this, Subsystem, &Lock]
+			//Clusters of unchanged tables keep their indices.
+			for (int i = 0; i < DataTables.Num(); i++)
 			{
-				Subsystem->SetHPAIndex(BoundData->CombinedNodes.Get(), DataTables[i], HPAIndex,
-				                       Lock);
-			}));
+				if (!ChangedTables[i]) continue;
+				NumClusters += UFAWorldSubsystem::RelabelHPAIndex(DataTables[i], TableHPAIndices[i], HPAIndex);
+			}
 		}
-		for (int i = 0; i < 8; i++)
+		else
 		{
-			FPlatformProcess::ConditionalSleep([&Results, i] { return Results[i].IsReady(); });
+			NumClusters = UFAWorldSubsystem::SetHPAIndex(DataTables, HPAIndex);
 		}
-		UE_LOG(LogFAWorldSubsystem, Display, TEXT("Finish Setting HPA Index"));
+		UE_LOG(LogFAWorldSubsystem, Display, TEXT("Finish Setting HPA Index, %d Clusters in %.2f ms"), NumClusters,
+		       (FPlatformTime::Seconds() - StartTime) * 1000);
 	}
 	{
 		FScopedEvent Event;
 		TArray<UPackage*> Packages;
-		for (auto dt : DataTables)
+		for (int i = 0; i < DataTables.Num(); i++)
 		{
-			Packages.Add(dt->GetPackage());
+			if (ChangedTables[i]) Packages.Add(DataTables[i]->GetPackage());
 		}
 		Packages.Add(BoundData->GetPackage());
 		Packages.Add(BoundData->CombinedNodes.Get()->GetPackage());
 
 		Bound->SetBoundData(BoundData);
 		BoundData->GeneratePosition = Bound->GetActorLocation();
-		for (int i = 0; i < HPAIndex.Num(); i++)
+		//Indices left unused by relabelled tables are not contained.
+		TSet<uint32> UsedHPAIndices;
+		for (auto dt : DataTables)
+		{
+			for (auto& Row : dt->GetRowMap())
+			{
+				const FFaNodeData* NodeData = reinterpret_cast<FFaNodeData*>(Row.Value);
+				if (NodeData->IsTraversable && NodeData->HPANodeIndex != INDEX_NONE)
+					UsedHPAIndices.Add(NodeData->HPANodeIndex);
+			}
+		}
+		BoundData->ContainingHPANodes = UsedHPAIndices.Array();
+		BoundData->ContainingHPANodes.Sort();
+		for (const uint32 i : BoundData->ContainingHPANodes)
 		{
 			Bound->GetLocalToGlobalHPANodes().Add(i, i);
-			BoundData->ContainingHPANodes.AddUnique(i);
 		}
+		Bound->UpdateGlobalHPANodes();
 		//Saving assets has to be done in Game Thread.
 		AsyncTask(ENamedThreads::GameThread, [this, &Event, Packages]
 		{
@@ -175,82 +197,90 @@ uint32 FFANodeGenRunnable::Run()
 			FText Error;
 			UEditorLoadingAndSavingUtils::ReloadPackages({BoundData->CombinedNodes->GetPackage()},
 			                                             out, Error);
+			//The nav data of the last generation is stale, search the converted data table until cooked.
+			BoundData->NavData.Reset();
+			BoundData->NavBlobPath.Reset();
+			//Stitches to and from the last generation are stale too.
+			BoundData->Stitches.Reset();
+			BoundData->NavDataGuid = FGuid::NewGuid();
+			Bound->UnloadNodes();
 			Bound->LoadNodes();
 			Event.Trigger();
 		});
 	}
+	//HPA nodes connected where their nodes are neighbours, with a portal at the centre of the faces they share.
 	{
-		TArray<FFaNodeData*> RowNames;
-		BoundData->CombinedNodes.LoadSynchronous()->GetAllRows<FFaNodeData>("", RowNames);
-		RowNames.Sort([](FFaNodeData& a, FFaNodeData& b)
-		{
-			return a.HPANodeIndex < b.HPANodeIndex;
-		});
-		UE::FSpinLock Lock;
-		/**
-		 * Don't use Async Pool due to it uses the thread for pathfinding and the function uses the pathfinding function and the thread will be stuck.
-		 * A solution is to use a separate thread pool for pathfinding, but there is no time to implement and test it.
-		 * However, this will sometime freeze the editor while
-		 * it is short enough for developers not to notice when the depth is under 7.
-		 */
-		TArray<UE::Tasks::FTask> Tasks;
-		Tasks.Reserve(HPAIndex.Num() * HPAIndex.Num());
-		for (uint32 i1 = 0; i1 < (uint32)HPAIndex.Num() - 1; i1++)
+		const double StartTime = FPlatformTime::Seconds();
+		const auto& RowMap = BoundData->CombinedNodes.LoadSynchronous()->GetRowMap();
+		TMap<TPair<uint32, uint32>, TPair<FVector, int32>> Faces;
+		for (auto& Row : RowMap)
 		{
-			for (uint32 i2 = i1 + 1; i2 < (uint32)HPAIndex.Num(); i2++)
+			const FFaNodeData* d1 = reinterpret_cast<FFaNodeData*>(Row.Value);
+			if (!d1->IsTraversable || d1->HPANodeIndex == INDEX_NONE) continue;
+			for (auto& Neighbour : d1->Neighbour)
 			{
-				if (i1 == i2) continue;
-				Tasks.Add(UE::Tasks::Launch(
-					UE_SOURCE_LOCATION, [this, Subsystem, &RowNames, i2, i1, &Lock]
-					{
-						FPlatformProcess::ConditionalSleep([] { return !IsInGameThread(); });
-						FFaNodeData* d1 = *RowNames.FindByPredicate([i1](FFaNodeData* a)
-						{
-							return a->HPANodeIndex == i1;
-						});
-						FFaNodeData* d2 = *RowNames.FindByPredicate([i2](FFaNodeData* a)
-						{
-							return a->HPANodeIndex == i2;
-						});
-						{
-							FFAHPAPath HPAPath;
-							HPAPath.StartLocation = d1->Position;
-							HPAPath.EndLocation = d2->Position;
-							HPAPath.HPANodes.Add(i1);
-							HPAPath.HPANodes.Add(i2);
-							HPAPath.HPAAssociateBounds.Add(Bound);
-							HPAPath.HPAAssociateBounds.Add(Bound);
-							HPAPath.StartNode = Subsystem->PointToNodeInBound(d1->Position, Bound);
-							HPAPath.EndNode = Subsystem->PointToNodeInBound(d2->Position, Bound);
-							// Try to find a path between the two Big nodes to see if they are connected.
-							auto r = Subsystem->CreateFinePathByHPA(HPAPath);
-							if (r.Nodes.Num() > 0)
-							{
-								UE::TScopeLock SLock(Lock);
-								BoundData->InternalHPAConnection.FindOrAdd(i1).Values.AddUnique(i2);
-								BoundData->InternalHPAConnection.FindOrAdd(i2).Values.AddUnique(i1);
-							}
-						}
-					}));
+				uint8* const* Found = RowMap.Find(Neighbour);
+				if (!Found) continue;
+				const FFaNodeData* d2 = reinterpret_cast<FFaNodeData*>(*Found);
+				//Each pair of nodes once, only between different HPA nodes.
+				if (!d2->IsTraversable || d2->HPANodeIndex == INDEX_NONE || d2->HPANodeIndex <= d1->
+					HPANodeIndex) continue;
+				auto& Face = Faces.FindOrAdd(TPair<uint32, uint32>(d1->HPANodeIndex, d2->HPANodeIndex),
+				                             TPair<FVector, int32>(FVector::ZeroVector, 0));
+				Face.Key += UFAWorldSubsystem::AABBOverlapCentre(d1->Position, d2->Position,
+				                                                 d1->HalfExtent, d2->HalfExtent);
+				Face.Value++;
 			}
 		}
-		UE::Tasks::BusyWait(Tasks);
-		UE_LOG(LogFAWorldSubsystem, Display, TEXT("Finish Generating HPA Connection Graph"));
+		BoundData->InternalHPAConnection.Reset();
+		for (const uint32 i : BoundData->ContainingHPANodes)
+		{
+			BoundData->InternalHPAConnection.Add(i);
+		}
+		BoundData->InternalHPAPortals.Reset(Faces.Num());
+		for (auto& Face : Faces)
+		{
+			BoundData->InternalHPAConnection[Face.Key.Key].Values.Add(Face.Key.Value);
+			BoundData->InternalHPAConnection[Face.Key.Value].Values.Add(Face.Key.Key);
+			BoundData->InternalHPAPortals.Add(
+				{Face.Key.Key, Face.Key.Value, Face.Value.Key / Face.Value.Value});
+		}
+		UE_LOG(LogFAWorldSubsystem, Display, TEXT("Finish Generating HPA Connection Graph, %d Portals in %.2f ms"),
+		       BoundData->InternalHPAPortals.Num(), (FPlatformTime::Seconds() - StartTime) * 1000);
 	}
 	{
 		FScopedEvent Event;
 
 		TArray<UPackage*> Packages;
-		for (auto dt : DataTables)
+		for (int i = 0; i < DataTables.Num(); i++)
 		{
-			Packages.Add(dt->GetPackage());
+			if (ChangedTables[i]) Packages.Add(DataTables[i]->GetPackage());
 		}
 		Packages.Add(BoundData->GetPackage());
 		Packages.Add(BoundData->CombinedNodes->GetPackage());
-		AsyncTask(ENamedThreads::GameThread, [this, &Event, Packages]
+		AsyncTask(ENamedThreads::GameThread, [this, &Event, Packages]() mutable
 		{
+			UFANavOctreeData* NavData = CreateNavOctreeData(Path, "NAV_" + Bound->GetName());
+			NavData->BuildFromDataTable(BoundData->CombinedNodes.Get(), BoundData->GeneratePosition,
+			                            Bound->GetHalfExtent());
+			NavData->MarkPackageDirty();
+			BoundData->NavData = NavData;
+			Packages.Add(NavData->GetPackage());
+			const FString NavBlobPath = Path + "NAV_" + Bound->GetName();
+			if (NavData->WriteBlob(FPackageName::LongPackageNameToFilename(NavBlobPath, FFANavBlob::Extension)))
+			{
+				BoundData->NavBlobPath = NavBlobPath;
+			}
+			else
+			{
+				UE_LOG(LogFAWorldSubsystem, Error, TEXT("Failed to write the nav blob %s."), *NavBlobPath);
+			}
+			Bound->UnloadNodes();
+			Bound->LoadNodes();
+			StitchNeighbourBounds(Packages);
 			UEditorLoadingAndSavingUtils::SavePackages(Packages, false);
 			Bound->GetLocalToGlobalHPANodes().Empty();
+			Bound->UpdateGlobalHPANodes();
 			auto time = FDateTime::UtcNow() - startGenTime;
 			UE_LOG(LogFAWorldSubsystem, Display, TEXT("Generation Finished:%dh %dMins %d"),
 			       time.GetHours(), time.GetMinutes(), time.GetSeconds());
@@ -261,6 +291,343 @@ uint32 FFANodeGenRunnable::Run()
 	return 0;
 }
 
+void FFANodeGenRunnable::GenerateAllNodes(UFAWorldSubsystem* Subsystem)
+{
+	FFANewNodeChildType Children;
+	for (int i = 0; i < 8; i++)
+	{
+		Children.ChildrenName[i] = *FString::Printf(TEXT("%d_TN"), i);
+	}
+	BoundData->GeneratePosition = Bound->GetActorLocation();
+	Bound->Subdivide(Children);
+	ChangedTables.Init(true, DataTables.Num());
+	{
+		const int32 ParallelDepth = GetDefault<UFAPathfindingSettings>()->GenerationParallelDepth;
+		//Voxelize the environment once instead of querying the physics scene for every node.
+		FFAOccupancyGrid Grid;
+		BuildOccupancyGrid(Subsystem, FBox::BuildAABB(Bound->GetActorLocation(), Bound->GetHalfExtent()), Grid);
+		uint8 Results[8];
+		FFANodeGenRows Rows[8];
+		TArray<FString> TableNames;
+		TArray<UE::Tasks::FTask> Tasks;
+		Tasks.Reserve(8);
+		for (int i = 0; i < 8; i++)
+		{
+			TableNames.Add(DataTables[i]->GetName());
+		}
+		for (int i = 0; i < 8; i++)
+		{
+			Tasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION,
+			                            [Subsystem, this, &Children, &TableNames, ParallelDepth, &Results, &Rows,
+				                            i, &Grid]
+			                            {
+				                            Results[i] = Subsystem->GenerateNodeBranch(
+					                            BoundData, World, Children.Children[i], TableNames[i], 0,
+					                            ParallelDepth, Rows[i], &Grid);
+			                            }));
+		}
+		UE::Tasks::Wait(Tasks);
+		// Adding the nodes to data tables, including the top level nodes.
+		ParallelFor(8, [this, &Children, &Results, &Rows](int32 i)
+		{
+			for (auto& Row : Rows[i])
+			{
+				DataTables[i]->AddRow(Row.Key, Row.Value);
+			}
+			if (Results[i] == 0 || Results[i] == 2)
+			{
+				Children.Children[i]->IsTraversable = Results[i] == 0;
+				DataTables[i]->AddRow(Children.ChildrenName[i], *Children.Children[i]);
+			}
+		});
+		UE_LOG(LogFAWorldSubsystem, Display, TEXT("Finish Generate Nodes"));
+	}
+	//Compute the clearance of traversable nodes, so pathfinding can skip the overlap test of agents that fit.
+	{
+		TArray<FFaNodeData*> Nodes;
+		for (auto dt : DataTables)
+		{
+			for (auto& Row : dt->GetRowMap())
+			{
+				FFaNodeData* NodeData = reinterpret_cast<FFaNodeData*>(Row.Value);
+				if (NodeData->IsTraversable) Nodes.Add(NodeData);
+			}
+		}
+		ComputeNodesClearance(Nodes);
+	}
+}
+
+bool FFANodeGenRunnable::LoadNodeDataTables()
+{
+	if (!Bound->GetActorLocation().Equals(BoundData->GeneratePosition) || !BoundData->CombinedNodes.
+		LoadSynchronous()) return false;
+	for (int i = 0; i < 8; i++)
+	{
+		FSoftObjectPath TablePath(Path + FString::Printf(TEXT("DT_%s_%d"), *Bound->GetName(), i));
+		UDataTable* DataTable = Cast<UDataTable>(TablePath.TryLoad());
+		if (!DataTable)
+		{
+			DataTables.Reset();
+			return false;
+		}
+		DataTables.Add(DataTable);
+	}
+	return true;
+}
+
+bool FFANodeGenRunnable::BuildOccupancyGrid(UFAWorldSubsystem* Subsystem, const FBox& Bounds,
+                                            FFAOccupancyGrid& OutGrid)
+{
+	if (!GetDefault<UFAPathfindingSettings>()->bVoxelizeGeneration) return false;
+	FFAOccupancyShapes Shapes;
+	{
+		FScopedEvent Event;
+		AsyncTask(ENamedThreads::GameThread, [this, Subsystem, &Bounds, &Shapes, &Event]
+		{
+			Subsystem->GatherOccupancyShapes(World, Bounds, Shapes);
+			Event.Trigger();
+		});
+	}
+	//Top level nodes are level 1 of the grid.
+	if (!OutGrid.Build(Shapes, Bound->GetActorLocation(), Bound->GetHalfExtent(), BoundData->MaxDepth + 1))
+	{
+		UE_LOG(LogFAWorldSubsystem, Warning,
+		       TEXT("Max depth %d is too deep to voxelize, querying the physics scene instead."),
+		       BoundData->MaxDepth);
+		return false;
+	}
+	UE_LOG(LogFAWorldSubsystem, Display,
+	       TEXT("Finish Voxelizing %d Triangles, %d Convexes, %d Spheres, %d Queried Components"),
+	       Shapes.Triangles.Num() / 3, Shapes.Convexes.Num(), Shapes.Spheres.Num(), Shapes.FallbackBoxes.Num());
+	return true;
+}
+
+namespace
+{
+	//Index of the node of a row in its table's octree, 0 for the top level node.
+	int64 GetRowNodeIndex(const FName& RowName)
+	{
+		FString Name = RowName.ToString();
+		if (Name.EndsWith(TEXT("_TN"))) return 0;
+		Name.RemoveFromEnd(TEXT("_FAN"));
+		int32 Separator;
+		Name.FindLastChar(TEXT('_'), Separator);
+		return FCString::Atoi64(*Name + Separator + 1);
+	}
+}
+
+void FFANodeGenRunnable::RegenerateDirtyNodes(UFAWorldSubsystem* Subsystem)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const UFAPathfindingSettings* Settings = GetDefault<UFAPathfindingSettings>();
+	const uint32 RootDepth = FMath::Min<uint32>(Settings->IncrementalRegenerationDepth, BoundData->MaxDepth);
+	const FVector BoundPosition = Bound->GetActorLocation();
+	const FVector BoundHalfExtent = Bound->GetHalfExtent();
+	auto IsDirty = [this](const FBox& Box)
+	{
+		return Algo::AnyOf(DirtyBoxes, [&Box](const FBox& Dirty) { return Dirty.Intersect(Box); });
+	};
+	ChangedTables.Init(false, DataTables.Num());
+	TableHPAIndices.SetNum(DataTables.Num());
+	//The subtrees to regenerate of each table by the index of their root, the ancestors of the dirty leaves at
+	//RootDepth. Leaves tile the bound, so the subtrees don't overlap.
+	TArray<TMap<int64, TSharedPtr<FFaNodeData>>> Roots;
+	Roots.SetNum(DataTables.Num());
+	TArray<TSet<uint32>> TableHPAIndexSets;
+	TableHPAIndexSets.SetNum(DataTables.Num());
+	FBox RootsBox(ForceInit);
+	uint32 MaxHPAIndex = 0;
+	for (int t = 0; t < DataTables.Num(); t++)
+	{
+		for (auto& Row : DataTables[t]->GetRowMap())
+		{
+			const FFaNodeData* NodeData = reinterpret_cast<FFaNodeData*>(Row.Value);
+			if (NodeData->IsTraversable && NodeData->HPANodeIndex != INDEX_NONE)
+			{
+				TableHPAIndexSets[t].Add(NodeData->HPANodeIndex);
+				MaxHPAIndex = FMath::Max(MaxHPAIndex, NodeData->HPANodeIndex + 1);
+			}
+			if (!IsDirty(FBox::BuildAABB(NodeData->Position, NodeData->HalfExtent))) continue;
+			int64 Index = GetRowNodeIndex(Row.Key);
+			uint32 Depth = NodeData->Depth;
+			for (; Depth > RootDepth; Depth--)
+			{
+				Index = Index / 8 - 1;
+			}
+			if (Roots[t].Contains(Index)) continue;
+			//Top level nodes are at depth 0, a quarter of the bound.
+			const FVector HalfExtent = BoundHalfExtent / static_cast<double>(2ll << Depth);
+			const FVector Cell = (NodeData->Position - (BoundPosition - BoundHalfExtent)) / (HalfExtent * 2);
+			TSharedPtr<FFaNodeData> Root = MakeShared<FFaNodeData>();
+			Root->Position = BoundPosition - BoundHalfExtent + (FVector(FMath::FloorToDouble(Cell.X),
+				FMath::FloorToDouble(Cell.Y), FMath::FloorToDouble(Cell.Z)) * 2 + 1) * HalfExtent;
+			Root->HalfExtent = HalfExtent;
+			Root->Depth = Depth;
+			RootsBox += FBox::BuildAABB(Root->Position, HalfExtent);
+			Roots[t].Add(Index, Root);
+		}
+	}
+	for (int t = 0; t < DataTables.Num(); t++)
+	{
+		TableHPAIndices[t] = TableHPAIndexSets[t].Array();
+	}
+	HPAIndex.SetNumZeroed(MaxHPAIndex);
+
+	//Remove the rows of the subtrees, any row with a root as its ancestor.
+	int32 NumRemoved = 0;
+	for (int t = 0; t < DataTables.Num(); t++)
+	{
+		if (Roots[t].Num() == 0) continue;
+		ChangedTables[t] = true;
+		TArray<FName> RowsToRemove;
+		for (auto& Row : DataTables[t]->GetRowMap())
+		{
+			int64 Index = GetRowNodeIndex(Row.Key);
+			for (uint32 Depth = reinterpret_cast<FFaNodeData*>(Row.Value)->Depth; ; Depth--)
+			{
+				if (Roots[t].Contains(Index))
+				{
+					RowsToRemove.Add(Row.Key);
+					break;
+				}
+				if (Depth == 0) break;
+				Index = Index / 8 - 1;
+			}
+		}
+		for (const FName& RowName : RowsToRemove)
+		{
+			DataTables[t]->RemoveRow(RowName);
+		}
+		NumRemoved += RowsToRemove.Num();
+	}
+
+	//Generate the subtrees again, the dirty part of the environment voxelized once.
+	FFAOccupancyGrid Grid;
+	BuildOccupancyGrid(Subsystem, RootsBox, Grid);
+	const int32 ParallelDepth = Settings->GenerationParallelDepth;
+	struct FSubtree
+	{
+		int32 Table;
+		int64 Index;
+		TSharedPtr<FFaNodeData> Root;
+		uint8 Result = 0;
+		FFANodeGenRows Rows;
+	};
+	TArray<FSubtree> Subtrees;
+	for (int t = 0; t < DataTables.Num(); t++)
+	{
+		for (auto& Root : Roots[t])
+		{
+			Subtrees.Add({t, Root.Key, Root.Value});
+		}
+	}
+	TArray<UE::Tasks::FTask> Tasks;
+	Tasks.Reserve(Subtrees.Num());
+	for (FSubtree& Subtree : Subtrees)
+	{
+		Tasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, Subsystem, &Subtree, ParallelDepth, &Grid]
+		{
+			Subtree.Result = Subsystem->GenerateNodeBranch(BoundData, World, Subtree.Root,
+			                                               DataTables[Subtree.Table]->GetName(), Subtree.Index,
+			                                               ParallelDepth, Subtree.Rows, &Grid);
+		}));
+	}
+	UE::Tasks::Wait(Tasks);
+	//New traversable nodes need their clearance, so do the old ones the changed environment may be in reach of.
+	TArray<FName> NewRows;
+	int32 NumAdded = 0;
+	for (FSubtree& Subtree : Subtrees)
+	{
+		UDataTable* DataTable = DataTables[Subtree.Table];
+		if (Subtree.Result != 1)
+		{
+			//A root at the max depth is filled.
+			Subtree.Root->IsTraversable = Subtree.Result == 0;
+			Subtree.Rows.Emplace(Subtree.Index == 0
+				                     ? FName(*FString::Printf(TEXT("%d_TN"), Subtree.Table))
+				                     : FName(*FString::Printf(TEXT("%s_%lld_FAN"), *DataTable->GetName(),
+				                                              Subtree.Index)), *Subtree.Root);
+		}
+		for (auto& Row : Subtree.Rows)
+		{
+			DataTable->AddRow(Row.Key, Row.Value);
+			NewRows.Add(Row.Key);
+		}
+		NumAdded += Subtree.Rows.Num();
+	}
+	UE_LOG(LogFAWorldSubsystem, Display,
+	       TEXT("Finish Regenerating %d Dirty Subtrees, %d Nodes Removed, %d Added in %.2f ms"), Subtrees.Num(),
+	       NumRemoved, NumAdded, (FPlatformTime::Seconds() - StartTime) * 1000);
+
+	const TSet<FName> NewRowSet(NewRows);
+	const float MaxClearance = BoundHalfExtent.GetMax();
+	TArray<FFaNodeData*> Nodes;
+	for (int t = 0; t < DataTables.Num(); t++)
+	{
+		for (auto& Row : DataTables[t]->GetRowMap())
+		{
+			FFaNodeData* NodeData = reinterpret_cast<FFaNodeData*>(Row.Value);
+			if (!NodeData->IsTraversable) continue;
+			//The clearance cube grew up to twice its size before being refined.
+			if (!NewRowSet.Contains(Row.Key) && !IsDirty(FBox::BuildAABB(
+				NodeData->Position, FVector(FMath::Min(NodeData->Clearance * 2, MaxClearance))))) continue;
+			Nodes.Add(NodeData);
+			ChangedTables[t] = true;
+		}
+	}
+	ComputeNodesClearance(Nodes);
+}
+
+void FFANodeGenRunnable::ComputeNodesClearance(const TArray<FFaNodeData*>& Nodes)
+{
+	const UFAPathfindingSettings* Settings = GetDefault<UFAPathfindingSettings>();
+	const float MaxClearance = Bound->GetHalfExtent().GetMax();
+	ParallelFor(Nodes.Num(), [this, &Nodes, Settings, MaxClearance](int32 i)
+	{
+		Nodes[i]->Clearance = UFAWorldSubsystem::ComputeNodeClearance(
+			Nodes[i], MaxClearance, Settings->ClearanceRefinementSteps, Settings->ObjectTypes,
+			Settings->EnvironmentActorClass, {}, World);
+	});
+	UE_LOG(LogFAWorldSubsystem, Display, TEXT("Finish Computing Clearance of %d Nodes"), Nodes.Num());
+}
+
+void FFANodeGenRunnable::StitchNeighbourBounds(TArray<UPackage*>& OutPackages)
+{
+	const UFANavOctreeData* NavData = Bound->GetNavData();
+	if (!NavData) return;
+	for (TActorIterator<AFABound> It(World); It; ++It)
+	{
+		AFABound* Other = *It;
+		if (Other == Bound || !UFAWorldSubsystem::AABBOverlap(Bound->GetActorLocation(), Other->GetActorLocation(),
+		                                                      Bound->GetHalfExtent(), Other->GetHalfExtent()))
+			continue;
+		Other->LoadBoundData();
+		UFABoundData* OtherData = Other->GetBoundData();
+		if (!OtherData || OtherData == BoundData) continue;
+		Other->LoadNodes();
+		const UFANavOctreeData* OtherNavData = Other->GetNavData();
+		if (!OtherNavData) continue;
+		TArray<TPair<uint32, uint32>> Pairs;
+		UFAWorldSubsystem::FindBoundaryNodePairs(Bound, NavData, Other, OtherNavData, Pairs);
+		FFABoundStitch& Stitch = BoundData->Stitches.AddDefaulted_GetRef();
+		Stitch.Other = OtherData;
+		Stitch.OtherNavDataGuid = OtherData->NavDataGuid;
+		Stitch.OtherOffset = Other->GetActorLocation() - Bound->GetActorLocation();
+		Stitch.Nodes.Reserve(Pairs.Num());
+		Stitch.OtherNodes.Reserve(Pairs.Num());
+		for (auto& Pair : Pairs)
+		{
+			Stitch.Nodes.Add(Pair.Key);
+			Stitch.OtherNodes.Add(Pair.Value);
+		}
+		//The other bound may keep a stitch to the last generation of this one.
+		OtherData->Stitches.RemoveAll([this](const FFABoundStitch& Old) { return Old.Other.Get() == BoundData; });
+		OtherData->MarkPackageDirty();
+		OutPackages.AddUnique(OtherData->GetPackage());
+	}
+	UE_LOG(LogFAWorldSubsystem, Display, TEXT("Finish Stitching %d Neighbour Bounds"), BoundData->Stitches.Num());
+}
+
 void FFANodeGenRunnable::Exit()
 {
 	OnNodeGenFinished.Broadcast();
@@ -286,6 +653,19 @@ UDataTable* FFANodeGenRunnable::CreateNodeDataTable(FString InPath, FString Name
 	return result;
 }
 
+UFANavOctreeData* FFANodeGenRunnable::CreateNavOctreeData(FString InPath, FString Name)
+{
+	UDataAssetFactory* Factory = NewObject<UDataAssetFactory>();
+	Factory->DataAssetClass = UFANavOctreeData::StaticClass();
+	FSoftObjectPath MyAssetPath(InPath + Name);
+	UObject* MyAsset = MyAssetPath.TryLoad();
+	UObject* Object = MyAsset
+		                  ? MyAsset
+		                  : FModuleManager::GetModuleChecked<FAssetToolsModule>("AssetTools").Get().
+		                  CreateAsset(Name, InPath, UFANavOctreeData::StaticClass(), Factory);
+	return Cast<UFANavOctreeData>(Object);
+}
+
 void UFANodeGenSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
@@ -293,6 +673,106 @@ void UFANodeGenSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 	UFAPathfindingSettings* Settings = GetMutableDefault<UFAPathfindingSettings>();
 	ObjectTypes = Settings->ObjectTypes;
 	EnvironmentActorClass = Settings->EnvironmentActorClass;
+	//Track the environment changed in the editor, so only the subtrees around it are regenerated.
+	if (GEngine)
+	{
+		OnActorAddedHandle = GEngine->OnLevelActorAdded().AddUObject(
+			this, &UFANodeGenSubsystem::MarkEnvironmentDirty);
+		OnActorDeletedHandle = GEngine->OnLevelActorDeleted().AddUObject(
+			this, &UFANodeGenSubsystem::MarkEnvironmentDirty);
+		OnActorMovedHandle = GEngine->OnActorMoved().AddUObject(this, &UFANodeGenSubsystem::MarkEnvironmentDirty);
+	}
+	//The box an actor is moved from is dirty too.
+	if (GEditor)
+	{
+		OnBeginObjectMovementHandle = GEditor->OnBeginObjectMovement().AddUObject(
+			this, &UFANodeGenSubsystem::OnActorMoving);
+	}
+}
+
+void UFANodeGenSubsystem::Deinitialize()
+{
+	if (GEngine)
+	{
+		GEngine->OnLevelActorAdded().Remove(OnActorAddedHandle);
+		GEngine->OnLevelActorDeleted().Remove(OnActorDeletedHandle);
+		GEngine->OnActorMoved().Remove(OnActorMovedHandle);
+	}
+	if (GEditor)
+	{
+		GEditor->OnBeginObjectMovement().Remove(OnBeginObjectMovementHandle);
+	}
+	Super::Deinitialize();
+}
+
+void UFANodeGenSubsystem::MarkEnvironmentDirty(AActor* Actor)
+{
+	if (!Actor || Actor->GetWorld() != GetWorld() || !EnvironmentActorClass || !Actor->IsA(EnvironmentActorClass))
+		return;
+	const FBox Box = Actor->GetComponentsBoundingBox(true);
+	if (!Box.IsValid) return;
+	for (TActorIterator<AFABound> It(GetWorld()); It; ++It)
+	{
+		AFABound* Bound = *It;
+		if (!FBox::BuildAABB(Bound->GetActorLocation(), Bound->GetHalfExtent()).Intersect(Box)) continue;
+		TArray<FBox>& Boxes = DirtyBounds.FindOrAdd(Bound);
+		//The boxes of an actor being dragged overlap one another, merged into the box it swept.
+		FBox* Overlapping = Boxes.FindByPredicate([&Box](const FBox& Dirty) { return Dirty.Intersect(Box); });
+		if (Overlapping) *Overlapping += Box;
+		else Boxes.Add(Box);
+	}
+}
+
+void UFANodeGenSubsystem::OnActorMoving(UObject& Object)
+{
+	MarkEnvironmentDirty(Cast<AActor>(&Object));
+}
+
+void UFANodeGenSubsystem::RegenerateDirtyBounds()
+{
+	if (bIsGeneratingNode || NodeGenRunnable)
+	{
+		UE_LOG(LogFAWorldSubsystem, Error, TEXT("Already Generating nodes"));
+		return;
+	}
+	for (auto It = DirtyBounds.CreateIterator(); It; ++It)
+	{
+		AFABound* Bound = It->Key.Get();
+		TArray<FBox> Boxes = MoveTemp(It->Value);
+		It.RemoveCurrent();
+		if (!IsValid(Bound)) continue;
+		Bound->LoadBoundData();
+		UFABoundData* BoundData = Bound->GetBoundData();
+		if (!BoundData || BoundData->CombinedNodes.IsNull())
+		{
+			UE_LOG(LogFAWorldSubsystem, Warning, TEXT("%s has no nodes to regenerate, generate the whole bound."),
+			       *Bound->GetName());
+			continue;
+		}
+		bIsGeneratingNode = true;
+		UE_LOG(LogFAWorldSubsystem, Display, TEXT("Regenerating %d dirty boxes of %s"), Boxes.Num(),
+		       *Bound->GetName());
+		//The data tables are next to the combined table.
+		const FString Path = FPackageName::GetLongPackagePath(
+			BoundData->CombinedNodes.ToSoftObjectPath().GetLongPackageName()) + "/";
+		NodeGenRunnable = new FFANodeGenRunnable(Path, GetWorld(), Bound, BoundData,
+		                                         FFAOnNodeGenFinished::FDelegate::CreateWeakLambda(
+			                                         this, [this]
+			                                         {
+				                                         bIsGeneratingNode = false;
+				                                         NodeGenRunnable = nullptr;
+				                                         //Continue with the next dirty bound.
+				                                         AsyncTask(ENamedThreads::GameThread,
+				                                                   [WeakThis = TWeakObjectPtr<
+					                                                   UFANodeGenSubsystem>(this)]
+				                                                   {
+					                                                   if (WeakThis.IsValid() && WeakThis->
+						                                                   HasDirtyBounds())
+						                                                   WeakThis->RegenerateDirtyBounds();
+				                                                   });
+			                                         }), MoveTemp(Boxes));
+		return;
+	}
 }
 
 void UFANodeGenSubsystem::GenerateBoundNodes(FString Path, UWorld* World, uint32 MaxDepth,
@@ -335,6 +815,8 @@ void UFANodeGenSubsystem::GenerateBoundNodes(FString Path, UWorld* World, uint32
 		}
 		BoundData->MaxDepth = MaxDepth;
 	}
+	//Regenerated as a whole, changes to its environment so far are included.
+	DirtyBounds.Remove(Bound);
 
 	NodeGenRunnable = new FFANodeGenRunnable(Path, World, Bound, BoundData,
 	                                         FFAOnNodeGenFinished::FDelegate::CreateWeakLambda(
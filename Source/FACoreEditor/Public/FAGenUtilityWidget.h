@@ -21,6 +21,9 @@ public:
 	virtual void NativeConstruct() override;
 	UPROPERTY(EditAnywhere, Category = "FA|GenUtilityWidget", meta = (BindWidget))
 	class UButton* GenerateButton;
+	/** Regenerate the subtrees around the environment actors changed since the bounds were generated. */
+	UPROPERTY(EditAnywhere, Category = "FA|GenUtilityWidget", meta = (BindWidgetOptional))
+	UButton* RegenerateDirtyButton;
 	UPROPERTY(EditAnywhere, Category = "FA|GenUtilityWidget", meta = (BindWidget))
 	/** Input the directory of where the generated data are stored*/
 	class USinglePropertyView* Path;
@@ -39,4 +42,6 @@ protected:
 	uint32 MaxDepth = 4;
 	UFUNCTION()
 	void GenerateButtonClicked();
+	UFUNCTION()
+	void RegenerateDirtyButtonClicked();
 };
@@ -9,11 +9,15 @@
 
 class UFABoundData;
 class AFABound;
+class UFANavOctreeData;
+class UFAWorldSubsystem;
+class FFAOccupancyGrid;
+struct FFaNodeData;
 
 DECLARE_MULTICAST_DELEGATE(FFAOnNodeGenFinished)
 
 //A dedicated thread for Node generation.
-class FFANodeGenRunnable : public FRunnable
+class FACOREEDITOR_API FFANodeGenRunnable : public FRunnable
 {
 public:
 	/**
@@ -23,9 +27,12 @@ public:
 	 * @param Bound The bound selected to generate nodes for.
 	 * @param BoundData The bound data selected to store nodes connection data.
 	 * @param InOnNodeGenFinished Callback delegate When Generation finished, used by system to clean up.
+	 * @param InDirtyBoxes Boxes the environment changed in since the last generation. If any, only the subtrees
+	 * overlapping them are regenerated, unless the bound was moved or its data tables are missing.
 	 */
 	FFANodeGenRunnable(FString Path, class UWorld* World, AFABound* Bound, UFABoundData* BoundData,
-	                   const FFAOnNodeGenFinished::FDelegate& InOnNodeGenFinished);
+	                   const FFAOnNodeGenFinished::FDelegate& InOnNodeGenFinished,
+	                   TArray<FBox> InDirtyBoxes = TArray<FBox>());
 	~FFANodeGenRunnable();
 	virtual bool Init() override;
 	virtual uint32 Run() override;
@@ -33,8 +40,37 @@ public:
 	virtual void Stop() override;
 
 protected:
+	/**
+	 * @brief Run the generation steps on the calling thread instead of starting one, into data tables already
+	 * created. Used by tests.
+	 */
+	FFANodeGenRunnable(UWorld* World, AFABound* Bound, UFABoundData* BoundData, TArray<UDataTable*> InDataTables,
+	                   TArray<FBox> InDirtyBoxes);
 	//Create a data table for storing nodes data.
 	UDataTable* CreateNodeDataTable(FString InPath, FString Name);
+	//Create the cooked nodes data loaded at runtime.
+	UFANavOctreeData* CreateNavOctreeData(FString InPath, FString Name);
+	/** Load the data tables of the last generation, on the game thread. False if it can't be regenerated from. */
+	bool LoadNodeDataTables();
+	/**
+	 * Voxelize the environment overlapping a box of the bound, if enabled in the settings.
+	 * @return False if the grid is left empty, so nodes query the physics scene instead.
+	 */
+	bool BuildOccupancyGrid(UFAWorldSubsystem* Subsystem, const FBox& Bounds, FFAOccupancyGrid& OutGrid);
+	/** Generate the nodes of the whole bound into the created data tables, all of them marked changed. */
+	void GenerateAllNodes(UFAWorldSubsystem* Subsystem);
+	/**
+	 * Replace the subtrees of the loaded data tables overlapping the dirty boxes with newly generated ones and
+	 * recompute the clearance of the nodes around them. The tables changed are marked in \c ChangedTables .
+	 */
+	void RegenerateDirtyNodes(UFAWorldSubsystem* Subsystem);
+	void ComputeNodesClearance(const TArray<FFaNodeData*>& Nodes);
+	/**
+	 * Cook the node pairs between the bound and every bound overlapping it in the world, so placed bounds are
+	 * connected without searching at runtime. Call on the game thread once the nav data of the bound is loaded.
+	 * @param OutPackages The bound data packages changed are added.
+	 */
+	void StitchNeighbourBounds(TArray<UPackage*>& OutPackages);
 	/**The world to generate nodes in.*/
 	UWorld* World;
 	/** The bound selected to generate nodes for. */
@@ -42,15 +78,19 @@ protected:
 	/** The bound data selected to store nodes connection data. */
 	UFABoundData* BoundData;
 	/** The thread to run on. */
-	FRunnableThread* Thread;
+	FRunnableThread* Thread = nullptr;
 	/** The path to store all generated data. */
 	FString Path;
 	//Data tables storing generating nodes data.
 	TArray<UDataTable*> DataTables;
-	/** Locks for data table access. */
-	TArray<UE::FSpinLock*> DataTableLocks;
 	/** All HPA Index that nodes have. Store in Bound Data. */
 	TArray<AFABound*> HPAIndex;
+	/** Boxes the environment changed in, empty to generate the whole bound. */
+	TArray<FBox> DirtyBoxes;
+	/** Whether each data table changed, only those are saved. */
+	TArray<bool> ChangedTables;
+	/** The HPA indices each data table had before regenerating its dirty subtrees. */
+	TArray<TArray<uint32>> TableHPAIndices;
 	//Storing the start time of a node generation, used for calculating the generation time.
 	FDateTime startGenTime;
 	//Callback delegate When Generation finished, used by system to clean up.
@@ -60,6 +100,8 @@ protected:
 /**
  * The World Subsystem to generate nodes for the bound. It will start a thread dedicated for node generation.
  * It will only generate for 1 bound at a time.
+ * Environment actors added, moved or deleted in the editor mark the generated bounds they overlap dirty, so only
+ * the subtrees around them are regenerated.
  */
 UCLASS()
 class FACOREEDITOR_API UFANodeGenSubsystem : public UWorldSubsystem
@@ -71,11 +113,29 @@ public:
 	UFUNCTION()
 	void GenerateBoundNodes(FString Path, UWorld* World, uint32 MaxDepth, AFABound* Bound,
 	                        UFABoundData* BoundData = nullptr);
+	/**
+	 * Regenerate the subtrees of the dirty bounds around the environment actors changed since their last
+	 * generation, one bound after another. Bounds without generated data are left to a full generation.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "FA|NodeGen")
+	void RegenerateDirtyBounds();
+	UFUNCTION(BlueprintPure, Category = "FA|NodeGen")
+	bool HasDirtyBounds() const { return DirtyBounds.Num() > 0; }
+	virtual void Deinitialize() override;
 	virtual void BeginDestroy() override;
 
 protected:
 	//Only support Editor.
 	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	/** Mark the bounds the box of an environment actor overlaps dirty. */
+	void MarkEnvironmentDirty(AActor* Actor);
+	void OnActorMoving(UObject& Object);
+	/** Boxes the environment changed in, for each generated bound. */
+	TMap<TWeakObjectPtr<AFABound>, TArray<FBox>> DirtyBounds;
+	FDelegateHandle OnActorAddedHandle;
+	FDelegateHandle OnActorDeletedHandle;
+	FDelegateHandle OnActorMovedHandle;
+	FDelegateHandle OnBeginObjectMovementHandle;
 
 	UPROPERTY(EditAnywhere, Category = "Pathfinding")
 	TSubclassOf<AActor> EnvironmentActorClass;
@@ -9,7 +9,7 @@ public class FATestSuite : ModuleRules
         PublicDependencyModuleNames.AddRange(
             new string[]
             {
-                "Core", "FACore", "FunctionalTesting","TestFramework", "UnrealEd"
+                "Core", "FACore", "FACoreEditor", "FunctionalTesting","TestFramework", "UnrealEd"
             }
         );
 
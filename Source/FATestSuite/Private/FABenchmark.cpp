@@ -0,0 +1,481 @@
+﻿#include "Algo/Reverse.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "FAHPAGraph.h"
+#include "FAIndexedHeap.h"
+#include "FALevelData.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/ScopeRWLock.h"
+#include "Tasks/Task.h"
+
+namespace FABenchmark
+{
+	//A dense 3D grid with random blocked cells, 26-connected like touching octree leaves.
+	struct FGrid
+	{
+		int32 Size = 0;
+		TBitArray<> Blocked;
+
+		FGrid(int32 InSize, float BlockedRatio, int32 Seed)
+			: Size(InSize)
+		{
+			FRandomStream Stream(Seed);
+			Blocked.Init(false, Size * Size * Size);
+			for (int32 i = 0; i < Blocked.Num(); i++)
+			{
+				Blocked[i] = Stream.FRand() < BlockedRatio;
+			}
+			Blocked[0] = false;
+			Blocked[Blocked.Num() - 1] = false;
+		}
+
+		int32 Index(const FIntVector& Cell) const { return (Cell.Z * Size + Cell.Y) * Size + Cell.X; }
+
+		FIntVector Cell(int32 InIndex) const
+		{
+			return FIntVector(InIndex % Size, (InIndex / Size) % Size, InIndex / (Size * Size));
+		}
+
+		template <typename FunctionType>
+		void ForEachNeighbour(int32 InIndex, FunctionType&& Function) const
+		{
+			const FIntVector C = Cell(InIndex);
+			for (int32 z = -1; z <= 1; z++)
+				for (int32 y = -1; y <= 1; y++)
+					for (int32 x = -1; x <= 1; x++)
+					{
+						const FIntVector N = C + FIntVector(x, y, z);
+						if ((x == 0 && y == 0 && z == 0) || N.X < 0 || N.Y < 0 || N.Z < 0 || N.X >= Size ||
+							N.Y >= Size || N.Z >= Size)
+							continue;
+						const int32 NIndex = Index(N);
+						if (!Blocked[NIndex]) Function(NIndex);
+					}
+		}
+
+		FVector Position(int32 InIndex) const { return FVector(Cell(InIndex)) * 100; }
+	};
+
+	struct FResult
+	{
+		double Cost = -1;
+		int32 Expansions = 0;
+		double Seconds = 0;
+	};
+
+	struct FRecord
+	{
+		int32 Cell;
+		FVector2D Cost;
+	};
+
+	//Mirrors the previous search core: string keys and a linear scan of the open set.
+	FResult RunLinearScan(const FGrid& Grid, int32 Start, int32 End)
+	{
+		FResult Result;
+		const double StartTime = FPlatformTime::Seconds();
+		TMap<FString, FRecord> OpenSet, ClosedSet;
+		auto Key = [&Grid](int32 Cell) { return FString::Printf(TEXT("%d%p"), Cell, &Grid); };
+		const FString EndName = Key(End);
+		OpenSet.Add(Key(Start), {Start, FVector2D(0, 0)});
+		while (OpenSet.Num() > 0)
+		{
+			auto It = OpenSet.CreateIterator();
+			FString CurrentNode = It.Key();
+			for (++It; It; ++It)
+			{
+				const FVector2D& A = It.Value().Cost;
+				const FVector2D& B = OpenSet[CurrentNode].Cost;
+				if (A.X + A.Y < B.X + B.Y || (A.X + A.Y == B.X + B.Y && A.Y < B.Y)) CurrentNode = It.Key();
+			}
+			ClosedSet.Add(CurrentNode);
+			OpenSet.RemoveAndCopyValue(CurrentNode, ClosedSet[CurrentNode]);
+			Result.Expansions++;
+			const FRecord Current = ClosedSet[CurrentNode];
+			if (CurrentNode == EndName)
+			{
+				Result.Cost = Current.Cost.X;
+				break;
+			}
+			Grid.ForEachNeighbour(Current.Cell, [&](int32 Neighbour)
+			{
+				const FString NeighbourName = Key(Neighbour);
+				if (ClosedSet.Contains(NeighbourName)) return;
+				const double G = Current.Cost.X + FVector::Distance(
+					Grid.Position(Current.Cell), Grid.Position(Neighbour));
+				if (FRecord* Open = OpenSet.Find(NeighbourName))
+				{
+					if (G < Open->Cost.X) Open->Cost.X = G;
+					return;
+				}
+				OpenSet.Add(NeighbourName, {
+					            Neighbour,
+					            FVector2D(G, FVector::Distance(Grid.Position(Neighbour),
+					                                           Grid.Position(End)))
+				            });
+			});
+		}
+		Result.Seconds = FPlatformTime::Seconds() - StartTime;
+		return Result;
+	}
+
+	//The current search core: integer handles, a closed bitset and an indexed binary heap.
+	FResult RunIndexedHeap(const FGrid& Grid, int32 Start, int32 End)
+	{
+		FResult Result;
+		const double StartTime = FPlatformTime::Seconds();
+		TArray<FRecord> Records;
+		TMap<int32, int32> Handles;
+		TBitArray<> ClosedSet;
+		auto Compare = [&Records](int32 A, int32 B)
+		{
+			const FVector2D& CostA = Records[A].Cost;
+			const FVector2D& CostB = Records[B].Cost;
+			if (CostA.X + CostA.Y != CostB.X + CostB.Y) return CostA.X + CostA.Y < CostB.X + CostB.Y;
+			if (CostA.Y != CostB.Y) return CostA.Y < CostB.Y;
+			return A < B;
+		};
+		TFAIndexedHeap<decltype(Compare)> OpenSet(Compare);
+		Records.Add({Start, FVector2D(0, 0)});
+		ClosedSet.Add(false);
+		Handles.Add(Start, 0);
+		OpenSet.Push(0);
+		while (!OpenSet.IsEmpty())
+		{
+			const int32 Current = OpenSet.Pop();
+			ClosedSet[Current] = true;
+			Result.Expansions++;
+			const FRecord CurrentRecord = Records[Current];
+			if (CurrentRecord.Cell == End)
+			{
+				Result.Cost = CurrentRecord.Cost.X;
+				break;
+			}
+			Grid.ForEachNeighbour(CurrentRecord.Cell, [&](int32 Neighbour)
+			{
+				const int32* Found = Handles.Find(Neighbour);
+				if (Found && ClosedSet[*Found]) return;
+				const double G = CurrentRecord.Cost.X + FVector::Distance(
+					Grid.Position(CurrentRecord.Cell), Grid.Position(Neighbour));
+				if (Found)
+				{
+					if (G < Records[*Found].Cost.X)
+					{
+						Records[*Found].Cost.X = G;
+						OpenSet.Update(*Found);
+					}
+					return;
+				}
+				const int32 Handle = Records.Add({
+					Neighbour,
+					FVector2D(G, FVector::Distance(Grid.Position(Neighbour), Grid.Position(End)))
+				});
+				ClosedSet.Add(false);
+				Handles.Add(Neighbour, Handle);
+				OpenSet.Push(Handle);
+			});
+		}
+		Result.Seconds = FPlatformTime::Seconds() - StartTime;
+		return Result;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAOpenSetBenchmark, "FlyingAIPlugin.FABenchmark.OpenSet",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 PerfFilter)
+
+bool FAOpenSetBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace FABenchmark;
+	for (const int32 Size : {16, 24, 32})
+	{
+		const FGrid Grid(Size, 0.3f, Size);
+		const int32 Start = 0, End = Grid.Blocked.Num() - 1;
+		const FResult Before = RunLinearScan(Grid, Start, End);
+		const FResult After = RunIndexedHeap(Grid, Start, End);
+		TestEqual(*FString::Printf(TEXT("Path cost should match on a %d^3 grid."), Size), After.Cost,
+		          Before.Cost, 1e-3);
+		AddInfo(FString::Printf(
+			TEXT("%d^3 grid: linear scan %d expansions in %.2fms (%.0f/s), indexed heap %d expansions in %.2fms (%.0f/s)"),
+			Size, Before.Expansions, Before.Seconds * 1000,
+			Before.Expansions / FMath::Max(Before.Seconds, UE_SMALL_NUMBER), After.Expansions,
+			After.Seconds * 1000, After.Expansions / FMath::Max(After.Seconds, UE_SMALL_NUMBER)));
+	}
+	return true;
+}
+
+namespace FABenchmark
+{
+	/**
+	 * Abstract graph of a level with many bounds: a lattice of HPA nodes with cells of random width,
+	 * so the path with the fewest HPA nodes is usually not the shortest one.
+	 */
+	struct FHPALevel
+	{
+		int32 Size = 0;
+		TArray<FVector> Centres;
+		TMap<uint32, FFAConnectedHPANode> Connection;
+		TMap<TPair<uint32, uint32>, FVector> Portals;
+		FFAHPAGraph Graph;
+
+		FHPALevel(int32 InSize, float RemovedRatio, int32 Seed)
+			: Size(InSize)
+		{
+			FRandomStream Stream(Seed);
+			TArray<double> Offsets[3];
+			for (auto& Axis : Offsets)
+			{
+				Axis.Add(0);
+				for (int32 i = 0; i < Size; i++)
+				{
+					Axis.Add(Axis.Last() + Stream.FRandRange(100, 800));
+				}
+			}
+			for (int32 i = 0; i < Size * Size * Size; i++)
+			{
+				const FIntVector C(i % Size, (i / Size) % Size, i / (Size * Size));
+				Centres.Add(FVector((Offsets[0][C.X] + Offsets[0][C.X + 1]) / 2,
+				                    (Offsets[1][C.Y] + Offsets[1][C.Y + 1]) / 2,
+				                    (Offsets[2][C.Z] + Offsets[2][C.Z + 1]) / 2));
+				Connection.Add(i);
+			}
+			for (int32 i = 0; i < Centres.Num(); i++)
+			{
+				for (const int32 Step : {1, Size, Size * Size})
+				{
+					const int32 Other = i + Step;
+					if (Other >= Centres.Num() || (Step == 1 && Other % Size == 0) ||
+						(Step == Size && (Other / Size) % Size == 0))
+						continue;
+					if (Stream.FRand() < RemovedRatio) continue;
+					Connection[i].Values.Add(Other);
+					Connection[Other].Values.Add(i);
+					const FVector Portal = (Centres[i] + Centres[Other]) / 2;
+					Portals.Add(TPair<uint32, uint32>(i, Other), Portal);
+					Portals.Add(TPair<uint32, uint32>(Other, i), Portal);
+					Graph.AddPortal(i, Other, Portal);
+				}
+			}
+			Graph.Build();
+		}
+
+		//Length of the path from the start to the end through the portals between the HPA nodes.
+		double PathLength(const TArray<uint32>& Path, const FVector& Start, const FVector& End) const
+		{
+			double Length = 0;
+			FVector Last = Start;
+			for (int32 i = 1; i < Path.Num(); i++)
+			{
+				const FVector& Portal = Portals[TPair<uint32, uint32>(Path[i - 1], Path[i])];
+				Length += FVector::Distance(Last, Portal);
+				Last = Portal;
+			}
+			return Length + FVector::Distance(Last, End);
+		}
+	};
+
+	//Mirrors the previous HPA search: an unweighted BFS with linear scans.
+	bool RunHPABreadthFirst(const FHPALevel& Level, uint32 StartHPANode, uint32 EndHPANode,
+	                        TArray<uint32>& OutPath)
+	{
+		TArray<uint32> Visited;
+		TArray<TPair<uint32, uint32>> Paths;
+		TArray<uint32> Queue;
+		Queue.Add(StartHPANode);
+		uint32 Current = -1;
+		while (Queue.Num() > 0)
+		{
+			uint32 i = Queue[0];
+			Queue.RemoveAt(0);
+			Visited.AddUnique(i);
+			for (auto x : Level.Connection[i].Values)
+			{
+				if (Visited.Contains(x)) continue;
+				Paths.Add(TPair<uint32, uint32>(x, i));
+				if (x == EndHPANode)
+				{
+					Current = x;
+					break;
+				}
+				Queue.AddUnique(x);
+				Visited.AddUnique(x);
+			}
+		}
+		if (Current == -1) return false;
+		while (Current != StartHPANode)
+		{
+			OutPath.Add(Current);
+			Current = Paths.FindByPredicate([Current](TPair<uint32, uint32>& a)
+			{
+				return Current == a.Key;
+			})->Value;
+		}
+		OutPath.Add(Current);
+		Algo::Reverse(OutPath);
+		return true;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAHPASearchBenchmark, "FlyingAIPlugin.FABenchmark.HPASearch",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 PerfFilter)
+
+bool FAHPASearchBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace FABenchmark;
+	for (const int32 Size : {8, 12, 16})
+	{
+		const FHPALevel Level(Size, 0.2f, Size);
+		FRandomStream Stream(Size);
+		constexpr int32 NumQueries = 32;
+		double BFSSeconds = 0, GraphSeconds = 0, BFSLength = 0, GraphLength = 0;
+		int32 Found = 0;
+		for (int32 q = 0; q < NumQueries; q++)
+		{
+			const uint32 Start = Stream.RandHelper(Level.Centres.Num());
+			const uint32 End = Stream.RandHelper(Level.Centres.Num());
+			if (Start == End) continue;
+			TArray<uint32> BFSPath, GraphPath;
+			double Time = FPlatformTime::Seconds();
+			const bool bBFSFound = RunHPABreadthFirst(Level, Start, End, BFSPath);
+			BFSSeconds += FPlatformTime::Seconds() - Time;
+			Time = FPlatformTime::Seconds();
+			const bool bGraphFound = Level.Graph.FindPath(Start, Level.Centres[Start], End,
+			                                              Level.Centres[End], GraphPath);
+			GraphSeconds += FPlatformTime::Seconds() - Time;
+			TestEqual(TEXT("Both searches should agree on whether HPA nodes are connected."),
+			          bGraphFound, bBFSFound);
+			if (!bBFSFound || !bGraphFound) continue;
+			const double BFSPathLength = Level.PathLength(BFSPath, Level.Centres[Start],
+			                                              Level.Centres[End]);
+			const double GraphPathLength = Level.PathLength(GraphPath, Level.Centres[Start],
+			                                                Level.Centres[End]);
+			TestTrue(TEXT("Weighted search should not find a longer path."),
+			         GraphPathLength <= BFSPathLength + 1e-3);
+			BFSLength += BFSPathLength;
+			GraphLength += GraphPathLength;
+			Found++;
+		}
+		AddInfo(FString::Printf(
+			TEXT("%d HPA nodes, %d portals: BFS %.3fms/query, mean length %.0f; weighted %.3fms/query, mean length %.0f"),
+			Level.Centres.Num(), Level.Graph.GetNumPortals(), BFSSeconds * 1000 / NumQueries,
+			BFSLength / FMath::Max(Found, 1), GraphSeconds * 1000 / NumQueries,
+			GraphLength / FMath::Max(Found, 1)));
+	}
+	return true;
+}
+
+namespace FABenchmark
+{
+	//Wall time of concurrent searches in one bound, each holding its lock for the whole search, with a loader
+	//writing the nodes meanwhile like a bound changing LOD.
+	template <typename LockType>
+	double RunConcurrentSearches(const FGrid& Grid, const TArray<TPair<int32, int32>>& Queries, LockType&& Lock,
+	                             TArray<double>& OutCosts)
+	{
+		OutCosts.Init(-1, Queries.Num());
+		std::atomic<bool> bSearching{true};
+		const double StartTime = FPlatformTime::Seconds();
+		UE::Tasks::FTask Loader = UE::Tasks::Launch(UE_SOURCE_LOCATION, [&Lock, &bSearching]
+		{
+			while (bSearching)
+			{
+				Lock.Write([] { FPlatformProcess::Sleep(0.0001f); });
+				FPlatformProcess::Sleep(0.002f);
+			}
+		});
+		TArray<UE::Tasks::FTask> Tasks;
+		for (int32 q = 0; q < Queries.Num(); q++)
+		{
+			Tasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [&Grid, &Queries, &Lock, &OutCosts, q]
+			{
+				Lock.Read([&] { OutCosts[q] = RunIndexedHeap(Grid, Queries[q].Key, Queries[q].Value).Cost; });
+			}));
+		}
+		UE::Tasks::Wait(Tasks);
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+		bSearching = false;
+		Loader.Wait();
+		return Seconds;
+	}
+
+	//Mirrors the previous nodes data lock: readers exclude each other.
+	struct FExclusiveLock
+	{
+		FCriticalSection Mutex;
+
+		template <typename FunctionType>
+		void Read(FunctionType&& Function)
+		{
+			UE::TScopeLock Lock(Mutex);
+			Function();
+		}
+
+		template <typename FunctionType>
+		void Write(FunctionType&& Function)
+		{
+			UE::TScopeLock Lock(Mutex);
+			Function();
+		}
+	};
+
+	//The current nodes data lock: readers share it, only the loader excludes them.
+	struct FSharedLock
+	{
+		FRWLock Mutex;
+
+		template <typename FunctionType>
+		void Read(FunctionType&& Function)
+		{
+			FReadScopeLock Lock(Mutex);
+			Function();
+		}
+
+		template <typename FunctionType>
+		void Write(FunctionType&& Function)
+		{
+			FWriteScopeLock Lock(Mutex);
+			Function();
+		}
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FABoundContentionBenchmark, "FlyingAIPlugin.FABenchmark.BoundContention",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 PerfFilter)
+
+bool FABoundContentionBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace FABenchmark;
+	const FGrid Grid(24, 0.3f, 24);
+	FRandomStream Stream(24);
+	for (const int32 NumQueries : {16, 32, 64})
+	{
+		TArray<TPair<int32, int32>> Queries;
+		for (int32 q = 0; q < NumQueries; q++)
+		{
+			int32 Start, End;
+			do
+			{
+				Start = Stream.RandHelper(Grid.Blocked.Num());
+			}
+			while (Grid.Blocked[Start]);
+			do
+			{
+				End = Stream.RandHelper(Grid.Blocked.Num());
+			}
+			while (Grid.Blocked[End]);
+			Queries.Emplace(Start, End);
+		}
+		TArray<double> ExclusiveCosts, SharedCosts;
+		FExclusiveLock ExclusiveLock;
+		FSharedLock SharedLock;
+		const double ExclusiveSeconds = RunConcurrentSearches(Grid, Queries, ExclusiveLock, ExclusiveCosts);
+		const double SharedSeconds = RunConcurrentSearches(Grid, Queries, SharedLock, SharedCosts);
+		TestTrue(TEXT("Shared reads should find the same paths."), SharedCosts == ExclusiveCosts);
+		AddInfo(FString::Printf(
+			TEXT("%d searches in one bound on %d workers: exclusive lock %.2fms, shared lock %.2fms (%.1fx)"),
+			NumQueries, FTaskGraphInterface::Get().GetNumWorkerThreads(), ExclusiveSeconds * 1000,
+			SharedSeconds * 1000, ExclusiveSeconds / FMath::Max(SharedSeconds, UE_SMALL_NUMBER)));
+	}
+	return true;
+}
@@ -1,6 +1,27 @@
 ﻿#include "FABound.h"
+#include "FABoundTree.h"
+#include "FADisjointSet.h"
+#include "FADynamicObstacleOverlay.h"
+#include "FAEdgeClearanceCache.h"
+#include "FAHPAGraph.h"
+#include "FAIndexedHeap.h"
+#include "FANodeGenSubsystem.h"
+#include "FANodeHandle.h"
+#include "FAOccupancyGrid.h"
+#include "FANavOctreeData.h"
+#include "FANodeSpatialIndex.h"
+#include "FAPathfindingAlgo.h"
+#include "FAPathfindingSettings.h"
+#include "FAPathQuery.h"
+#include "FAPathSearchScratch.h"
 #include "FAWorldSubsystem.h"
+#include "Algo/AllOf.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
 #include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FABoundSubdivisionTest,
                                  "FlyingAIPlugin.FAUnitTest.BoundSubdivision",
@@ -88,3 +109,948 @@ bool FAAABBOverlapTest::RunTest(const FString& Parameters)
 
 	return true;
 }
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FASweepAndPruneTest, "FlyingAIPlugin.FAUnitTest.SweepAndPrune",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FASweepAndPruneTest::RunTest(const FString& Parameters)
+{
+	//Boxes on a grid so some only touch.
+	FRandomStream Stream(0);
+	TArray<FBox> Boxes[2];
+	for (auto& Set : Boxes)
+	{
+		for (int32 i = 0; i < 100; i++)
+		{
+			const FVector Min(Stream.RandRange(0, 20) * 10, Stream.RandRange(0, 20) * 10, Stream.RandRange(0, 4) * 10);
+			Set.Emplace(Min, Min + FVector(Stream.RandRange(1, 3) * 10));
+		}
+	}
+	TSet<TPair<int32, int32>> Expected;
+	for (int32 a = 0; a < Boxes[0].Num(); a++)
+	{
+		for (int32 b = 0; b < Boxes[1].Num(); b++)
+		{
+			if (UFAWorldSubsystem::AABBOverlap(Boxes[0][a].GetCenter(), Boxes[1][b].GetCenter(),
+			                                   Boxes[0][a].GetExtent(), Boxes[1][b].GetExtent()))
+				Expected.Add(TPair<int32, int32>(a, b));
+		}
+	}
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		TArray<TPair<int32, int32>> Pairs;
+		UFAWorldSubsystem::SweepAndPrune(Boxes[0], Boxes[1], Axis, Pairs);
+		TestEqual(*FString::Printf(TEXT("Sweep along axis %d should find every overlapping pair once"), Axis),
+		          Pairs.Num(), Expected.Num());
+		TestTrue(*FString::Printf(TEXT("Sweep along axis %d should only find overlapping pairs"), Axis),
+		         Expected.Includes(TSet<TPair<int32, int32>>(Pairs)));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIndexedHeapTest, "FlyingAIPlugin.FAUnitTest.IndexedHeap",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FAIndexedHeapTest::RunTest(const FString& Parameters)
+{
+	TArray<float> Keys{5, 3, 8, 1, 9, 7};
+	TFAIndexedHeap Heap([&Keys](int32 A, int32 B) { return Keys[A] < Keys[B]; });
+	for (int32 i = 0; i < Keys.Num(); i++)
+	{
+		Heap.Push(i);
+	}
+	TestEqual(TEXT("Top should be the smallest key"), Heap.Top(), 3);
+	Keys[4] = 0;
+	Heap.Update(4);
+	TestEqual(TEXT("Decrease-key should move handle to the top"), Heap.Top(), 4);
+	Keys[4] = 10;
+	Heap.Update(4);
+	TArray<int32> Order;
+	while (!Heap.IsEmpty())
+	{
+		Order.Add(Heap.Pop());
+	}
+	TestTrue(TEXT("Handles should pop in key order"), Order == TArray<int32>{3, 1, 0, 5, 2, 4});
+	TestFalse(TEXT("Popped handle should not be contained"), Heap.Contains(3));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAHPAIndexTest, "FlyingAIPlugin.FAUnitTest.HPAIndex",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FAHPAIndexTest::RunTest(const FString& Parameters)
+{
+	FFADisjointSet Set(5);
+	TestTrue(TEXT("Separate elements should merge"), Set.Union(0, 3));
+	Set.Union(3, 4);
+	TestFalse(TEXT("Elements of one set should not merge again"), Set.Union(4, 0));
+	TArray<int32> Labels;
+	TestEqual(TEXT("Sets should be counted"), Set.Label(Labels), 3);
+	TestTrue(TEXT("Sets should be numbered by their first element"), Labels == TArray<int32>{0, 1, 2, 0, 0});
+
+	//Node_0 and Node_1 connected, Node_2 next to the blocked Node_3 in one table, a chain in the other.
+	//Links to blocked nodes or to the other table don't join clusters.
+	TArray<UDataTable*> Tables;
+	const TArray<TArray<int32>> Links{{1}, {0, 4}, {3}, {2}, {1, 5}, {4, 6}, {5}};
+	for (int32 i = 0; i < Links.Num(); i++)
+	{
+		if (i == 0 || i == 4)
+		{
+			Tables.Add(NewObject<UDataTable>());
+			Tables.Last()->RowStruct = FFaNodeData::StaticStruct();
+		}
+		FFaNodeData Node;
+		Node.IsTraversable = i != 3;
+		for (const int32 Link : Links[i])
+		{
+			Node.Neighbour.Add(FName(FString::Printf(TEXT("Node_%d"), Link)));
+		}
+		Tables.Last()->AddRow(FName(FString::Printf(TEXT("Node_%d"), i)), Node);
+	}
+	TArray<AFABound*> HPAIndex;
+	TestEqual(TEXT("Clusters should be the connected nodes of each table"),
+	          UFAWorldSubsystem::SetHPAIndex(Tables, HPAIndex), 3);
+	TestEqual(TEXT("An index should be added for each cluster"), HPAIndex.Num(), 3);
+	const TArray<int32> Expected{0, 0, 1, INDEX_NONE, 2, 2, 2};
+	for (int32 i = 0; i < Expected.Num(); i++)
+	{
+		const FFaNodeData* Node = Tables[i < 4 ? 0 : 1]->FindRow<FFaNodeData>(
+			FName(FString::Printf(TEXT("Node_%d"), i)), "");
+		TestEqual(*FString::Printf(TEXT("Node_%d should be in its cluster"), i), Node->HPANodeIndex, Expected[i]);
+	}
+
+	//Cut the chain of the other table, its clusters are relabelled without touching the first table.
+	Tables[1]->FindRow<FFaNodeData>("Node_4", "")->Neighbour = {"Node_1"};
+	Tables[1]->FindRow<FFaNodeData>("Node_5", "")->Neighbour = {"Node_6"};
+	TestEqual(TEXT("A cut cluster should be relabelled in two"),
+	          UFAWorldSubsystem::RelabelHPAIndex(Tables[1], {2}, HPAIndex), 2);
+	TestEqual(TEXT("An index should only be added for the new cluster"), HPAIndex.Num(), 4);
+	const TArray<int32> Relabelled{0, 0, 1, INDEX_NONE, 2, 3, 3};
+	for (int32 i = 0; i < Relabelled.Num(); i++)
+	{
+		const FFaNodeData* Node = Tables[i < 4 ? 0 : 1]->FindRow<FFaNodeData>(
+			FName(FString::Printf(TEXT("Node_%d"), i)), "");
+		TestEqual(*FString::Printf(TEXT("Node_%d should be relabelled"), i), Node->HPANodeIndex, Relabelled[i]);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FANodeHandleTest, "FlyingAIPlugin.FAUnitTest.NodeHandle",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FANodeHandleTest::RunTest(const FString& Parameters)
+{
+	const FFANodeHandle A(1, 5), B(1, 6), C(2, 0);
+	TestFalse(TEXT("Default handle should be invalid"), FFANodeHandle().IsValid());
+	TestTrue(TEXT("Same indices should be equal"), A == FFANodeHandle(1, 5));
+	TestTrue(TEXT("Order by node index within a bound"), A < B);
+	TestTrue(TEXT("Order by bound index first"), B < C);
+	TSet<FFANodeHandle> Set{A, B, C, FFANodeHandle(1, 5)};
+	TestEqual(TEXT("Equal handles should hash the same"), Set.Num(), 3);
+	int32 BoundIndex, NodeIndex;
+	UFANodeHandleLibrary::BreakNodeHandle(UFANodeHandleLibrary::MakeNodeHandle(-1, 7), BoundIndex,
+	                                      NodeIndex);
+	TestEqual(TEXT("Negative bound index should round trip as INDEX_NONE"), BoundIndex, INDEX_NONE);
+	TestEqual(TEXT("Node index should round trip"), NodeIndex, 7);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAHPAGraphTest, "FlyingAIPlugin.FAUnitTest.HPAGraph",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FAHPAGraphTest::RunTest(const FString& Parameters)
+{
+	//0 and 3 are connected directly by a long detour, and by 1 and 2 on a straight line.
+	FFAHPAGraph Graph;
+	Graph.AddPortal(0, 3, FVector(0, 1000, 0));
+	Graph.AddPortal(0, 1, FVector(100, 0, 0));
+	Graph.AddPortal(1, 2, FVector(200, 0, 0));
+	Graph.AddPortal(2, 3, FVector(300, 0, 0));
+	Graph.AddPortal(4, 5, FVector(0, 0, 100));
+	TestTrue(TEXT("Graph should need building after adding portals"), Graph.NeedsBuild());
+	Graph.Build();
+	TArray<uint32> Path;
+	float Cost;
+	TestTrue(TEXT("Connected HPA nodes should have a path"),
+	         Graph.FindPath(0, FVector::ZeroVector, 3, FVector(400, 0, 0), Path, &Cost));
+	TestTrue(TEXT("Shortest path should pass every HPA node in order"),
+	         Path == TArray<uint32>{0, 1, 2, 3});
+	TestEqual(TEXT("Cost should be the length through the portals"), Cost, 400.f, 1e-3f);
+	TestFalse(TEXT("Disconnected HPA nodes should not have a path"),
+	          Graph.FindPath(0, FVector::ZeroVector, 5, FVector::ZeroVector, Path));
+	TestTrue(TEXT("Same HPA node should be a path of itself"),
+	         Graph.FindPath(2, FVector::ZeroVector, 2, FVector::ZeroVector, Path) && Path.Num() == 1);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FANodeSpatialIndexTest, "FlyingAIPlugin.FAUnitTest.NodeSpatialIndex",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FANodeSpatialIndexTest::RunTest(const FString& Parameters)
+{
+	//A bound with one octant subdivided again, the leaves are the other octants and the children of that octant.
+	TSharedPtr<FFaNodeData> Root = MakeShared<FFaNodeData>();
+	Root->Position = FVector(50, -20, 10);
+	Root->HalfExtent = FVector(100);
+	FFANewNodeChildType Octants, Children;
+	UFAWorldSubsystem::Subdivide(Root, Octants);
+	UFAWorldSubsystem::Subdivide(Octants.Children[5], Children);
+	TArray<const FFaNodeData*> Leaves;
+	TArray<FVector3f> Positions, HalfExtents;
+	for (int i = 0; i < 8; i++)
+	{
+		if (i != 5) Leaves.Add(Octants.Children[i].Get());
+		Leaves.Add(Children.Children[i].Get());
+	}
+	for (const FFaNodeData* Leaf : Leaves)
+	{
+		Positions.Add(FVector3f(Leaf->Position));
+		HalfExtents.Add(FVector3f(Leaf->HalfExtent));
+	}
+	FFANodeSpatialIndex Index;
+	Index.Build(Positions, HalfExtents, Root->Position, Root->HalfExtent);
+
+	FRandomStream Stream(0);
+	for (int i = 0; i < 200; i++)
+	{
+		const FVector Point = Root->Position + FVector(Stream.FRandRange(-99, 99),
+		                                               Stream.FRandRange(-99, 99),
+		                                               Stream.FRandRange(-99, 99));
+		const uint32 Found = Index.FindNode(Point);
+		if (!TestTrue(TEXT("A point in the bound should be in a leaf"),
+		              Found != FFANodeSpatialIndex::InvalidIndex))
+			continue;
+		const FFaNodeData* Leaf = Leaves[Found];
+		TestTrue(*FString::Printf(TEXT("%s should be in the leaf found"), *Point.ToString()),
+		         FBox::BuildAABB(Leaf->Position, Leaf->HalfExtent).IsInsideOrOn(Point));
+	}
+	//Neighbours from the cells should be the leaves touching each leaf, across faces, edges or corners.
+	TArray<uint32> Offsets, Neighbours;
+	Index.BuildNeighbours(Offsets, Neighbours);
+	if (TestEqual(TEXT("Every leaf should have neighbours"), Offsets.Num(), Leaves.Num() + 1))
+	{
+		for (int32 i = 0; i < Leaves.Num(); i++)
+		{
+			TArray<uint32> Touching;
+			for (int32 j = 0; j < Leaves.Num(); j++)
+			{
+				if (i != j && UFAWorldSubsystem::AABBOverlap(Leaves[i]->Position, Leaves[j]->Position,
+				                                             Leaves[i]->HalfExtent, Leaves[j]->HalfExtent))
+					Touching.Add(j);
+			}
+			TestTrue(*FString::Printf(TEXT("Neighbours of leaf %d should be the leaves touching it"), i),
+			         TArray<uint32>(TConstArrayView<uint32>(Neighbours.GetData() + Offsets[i],
+			                                                Offsets[i + 1] - Offsets[i])) == Touching);
+		}
+	}
+	//A box over the face between the subdivided octant and the octant next to it in x.
+	const FBox Face = FBox::BuildAABB(Children.Children[0]->Position, Children.Children[0]->HalfExtent).Overlap(
+		FBox::BuildAABB(Octants.Children[4]->Position, Octants.Children[4]->HalfExtent));
+	TArray<uint32> InBox;
+	Index.FindNodesInBox(Face, InBox);
+	InBox.Sort();
+	TArray<uint32> Touching;
+	for (int32 i = 0; i < Leaves.Num(); i++)
+	{
+		if (FBox::BuildAABB(Leaves[i]->Position, Leaves[i]->HalfExtent).Intersect(Face)) Touching.Add(i);
+	}
+	TestTrue(TEXT("Leaves in a box should be the leaves touching it"), InBox == Touching);
+	TestEqual(TEXT("Morton code should interleave x, y and z"),
+	          FFANodeSpatialIndex::EncodeMorton(1, 2, 4), (uint64)0b100010001);
+	Index.Reset();
+	TestEqual(TEXT("Empty index should not find any leaf"), Index.FindNode(Root->Position),
+	          FFANodeSpatialIndex::InvalidIndex);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FANavOctreeDataTest, "FlyingAIPlugin.FAUnitTest.NavOctreeData",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+namespace
+{
+	//The octants of a bound, each a neighbour of the next one, the last one blocked.
+	UFANavOctreeData* MakeOctantNavData(FFANewNodeChildType& Octants)
+	{
+		TSharedPtr<FFaNodeData> Root = MakeShared<FFaNodeData>();
+		Root->HalfExtent = FVector(100);
+		UFAWorldSubsystem::Subdivide(Root, Octants);
+		UDataTable* Table = NewObject<UDataTable>();
+		Table->RowStruct = FFaNodeData::StaticStruct();
+		for (int i = 0; i < 8; i++)
+		{
+			FFaNodeData& Node = *Octants.Children[i];
+			Node.IsTraversable = i != 7;
+			Node.HPANodeIndex = i / 4;
+			if (i > 0) Node.Neighbour.Add(FName(FString::Printf(TEXT("Node_%d"), i - 1)));
+			if (i < 7) Node.Neighbour.Add(FName(FString::Printf(TEXT("Node_%d"), i + 1)));
+			//Not a row of the table, should be dropped.
+			Node.Neighbour.Add("Missing");
+			Table->AddRow(FName(FString::Printf(TEXT("Node_%d"), i)), Node);
+		}
+		UFANavOctreeData* NavData = NewObject<UFANavOctreeData>();
+		NavData->BuildFromDataTable(Table, Root->Position, Root->HalfExtent);
+		return NavData;
+	}
+}
+
+bool FANavOctreeDataTest::RunTest(const FString& Parameters)
+{
+	FFANewNodeChildType Octants;
+	UFANavOctreeData* NavData = MakeOctantNavData(Octants);
+
+	TestEqual(TEXT("Every row should be a node"), NavData->Num(), 8);
+	for (int i = 0; i < 8; i++)
+	{
+		const FFaNodeData& Node = *Octants.Children[i];
+		TestEqual(TEXT("Node should keep the row position"), NavData->GetPosition(i), Node.Position);
+		TestEqual(TEXT("Node should keep the row traversability"), NavData->IsTraversable(i),
+		          Node.IsTraversable);
+		TestEqual(TEXT("Node should keep the row HPA node"), NavData->GetHPANodeIndex(i),
+		          Node.HPANodeIndex);
+		TestEqual(TEXT("Neighbours missing from the table should be dropped"),
+		          NavData->GetNeighbours(i).Num(), i == 0 || i == 7 ? 1 : 2);
+		TestTrue(TEXT("Neighbour names should map to node indices"),
+		         NavData->GetNeighbours(i).Contains(i == 0 ? 1 : i - 1));
+		TestEqual(TEXT("The centre of a node should be found in it"), NavData->FindNode(Node.Position),
+		          (uint32)i);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FADynamicObstacleOverlayTest, "FlyingAIPlugin.FAUnitTest.DynamicObstacleOverlay",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FADynamicObstacleOverlayTest::RunTest(const FString& Parameters)
+{
+	FFANewNodeChildType Octants;
+	const UFANavOctreeData* NavData = MakeOctantNavData(Octants);
+	FFADynamicObstacleOverlay Overlay;
+	TestFalse(TEXT("Nothing should be blocked without obstacles"), Overlay.IsBlocked(0));
+
+	//Inside octant 0, touching octant 1 and the blocked octant 7 is not in reach.
+	TArray<uint32> Changed;
+	Overlay.AddObstacle(0, FBox(FVector(-60), FVector(0, -10, -10)), NavData, Changed);
+	TestTrue(TEXT("Only the node overlapped should be blocked"), Changed == TArray<uint32>{0});
+	TestFalse(TEXT("Nodes touching the obstacle should stay open"), Overlay.IsBlocked(1));
+	Changed.Reset();
+	Overlay.AddObstacle(1, FBox(FVector(-100), FVector(100)), NavData, Changed);
+	TestEqual(TEXT("Traversable nodes not blocked before should change"), Changed.Num(), 6);
+	TestFalse(TEXT("Nodes that are not traversable should not be blocked"), Changed.Contains(7));
+	TestEqual(TEXT("Blocked nodes should be counted"), Overlay.GetNumBlocked(), 7);
+
+	Changed.Reset();
+	Overlay.RemoveObstacle(1, Changed);
+	TestEqual(TEXT("Nodes only blocked by the removed obstacle should change"), Changed.Num(), 6);
+	TestTrue(TEXT("A node still overlapped by an obstacle should stay blocked"), Overlay.IsBlocked(0));
+	Changed.Reset();
+	Overlay.RemoveObstacle(0, Changed);
+	TestTrue(TEXT("The last obstacle of a node should unblock it"), Changed == TArray<uint32>{0});
+	TestEqual(TEXT("Nothing should be blocked once every obstacle is removed"), Overlay.GetNumBlocked(), 0);
+
+	Overlay.SetObstacleBox(2, FBox(FVector(0), FVector(10)));
+	TestTrue(TEXT("A box overlapping an obstacle box should be found"),
+	         Overlay.OverlapsObstacle(FBox(FVector(5), FVector(20))));
+	TestFalse(TEXT("A box only touching an obstacle box should not"),
+	          Overlay.OverlapsObstacle(FBox(FVector(10), FVector(20))));
+	Overlay.SetObstacleBox(2, FBox(FVector(100), FVector(110)));
+	TestFalse(TEXT("A moved obstacle box should be replaced"), Overlay.OverlapsObstacle(FBox(FVector(5), FVector(20))));
+	Overlay.Reset();
+	TestTrue(TEXT("Reset should keep the obstacle boxes"), Overlay.OverlapsObstacle(FBox(FVector(105), FVector(120))));
+	Changed.Reset();
+	Overlay.RemoveObstacle(2, Changed);
+	TestFalse(TEXT("A removed obstacle box should be forgotten"),
+	          Overlay.OverlapsObstacle(FBox(FVector(105), FVector(120))));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FANavBlobTest, "FlyingAIPlugin.FAUnitTest.NavBlob",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FANavBlobTest::RunTest(const FString& Parameters)
+{
+	FFANewNodeChildType Octants;
+	const UFANavOctreeData* Source = MakeOctantNavData(Octants);
+	const FString Filename = FPaths::AutomationTransientDir() / TEXT("NavBlobTest") + FFANavBlob::Extension;
+	if (!TestTrue(TEXT("Blob should be written"), Source->WriteBlob(Filename))) return false;
+
+	UFANavOctreeData* NavData = NewObject<UFANavOctreeData>();
+	if (!TestTrue(TEXT("Blob should be loaded"), NavData->LoadFromBlob(Filename))) return false;
+	TestEqual(TEXT("Blob should keep every node"), NavData->Num(), Source->Num());
+	for (int i = 0; i < Source->Num(); i++)
+	{
+		TestEqual(TEXT("Blob should keep the position"), NavData->GetPosition(i), Source->GetPosition(i));
+		TestEqual(TEXT("Blob should keep the traversability"), NavData->IsTraversable(i),
+		          Source->IsTraversable(i));
+		TestTrue(TEXT("Blob should keep the neighbours"),
+		         TArray<uint32>(NavData->GetNeighbours(i)) == TArray<uint32>(Source->GetNeighbours(i)));
+		TestEqual(TEXT("Blob should keep the spatial index"), NavData->FindNode(Source->GetPosition(i)),
+		          (uint32)i);
+	}
+	TestTrue(TEXT("Mapping a blob twice should share it"),
+	         FFANavBlob::Map(Filename) == FFANavBlob::Map(Filename));
+	NavData->ReleaseBlob();
+	TestEqual(TEXT("Released blob should leave no node"), NavData->Num(), 0);
+
+	//A truncated file is rejected.
+	TArray<uint8> Bytes;
+	FFileHelper::LoadFileToArray(Bytes, *Filename);
+	Bytes.SetNum(Bytes.Num() / 2);
+	FFileHelper::SaveArrayToFile(Bytes, *Filename);
+	AddExpectedError(TEXT("truncated or corrupted"));
+	TestFalse(TEXT("Truncated blob should not be loaded"), NavData->LoadFromBlob(Filename));
+	IFileManager::Get().Delete(*Filename);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAOccupancyGridTest, "FlyingAIPlugin.FAUnitTest.OccupancyGrid",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FAOccupancyGridTest::RunTest(const FString& Parameters)
+{
+	TestTrue(TEXT("Triangle through a box should overlap it"),
+	         FFAOccupancyGrid::TriangleBoxOverlap(FVector::ZeroVector, FVector(1), FVector(-5, -5, 0),
+	                                              FVector(5, -5, 0), FVector(0, 5, 0)));
+	TestFalse(TEXT("Triangle beside a box should not overlap it"),
+	          FFAOccupancyGrid::TriangleBoxOverlap(FVector::ZeroVector, FVector(1), FVector(2, 2, -5),
+	                                               FVector(2, 2, 5), FVector(5, -1, 0)));
+
+	//A box, a sphere and a slanted triangle, none aligned to the cells.
+	const FBox Box(FVector(-33, -12, -57), FVector(21, 43, -6));
+	const FSphere Sphere(FVector(52, 47, 55), 23);
+	const FVector Triangle[3] = {FVector(-90, 80, 10), FVector(-10, 95, 70), FVector(-70, 20, 90)};
+	FFAOccupancyShapes Shapes;
+	FFAOccupancyShapes::FConvex& Convex = Shapes.Convexes.AddDefaulted_GetRef();
+	for (int32 i = 0; i < 8; i++)
+	{
+		Convex.Vertices.Add(FVector(i & 1 ? Box.Max.X : Box.Min.X, i & 2 ? Box.Max.Y : Box.Min.Y,
+		                            i & 4 ? Box.Max.Z : Box.Min.Z));
+	}
+	Convex.Indices = {
+		0, 2, 6, 0, 6, 4, 1, 3, 7, 1, 7, 5, 0, 1, 5, 0, 5, 4,
+		2, 3, 7, 2, 7, 6, 0, 1, 3, 0, 3, 2, 4, 5, 7, 4, 7, 6
+	};
+	Shapes.Spheres.Add(Sphere);
+	Shapes.Triangles.Append(Triangle, 3);
+	FFAOccupancyGrid Grid;
+	TestFalse(TEXT("Too many levels should be refused"),
+	          Grid.Build(Shapes, FVector::ZeroVector, FVector(100), FFAOccupancyGrid::MaxLevels + 1));
+	if (!TestTrue(TEXT("Grid should be built"), Grid.Build(Shapes, FVector::ZeroVector, FVector(100), 4)))
+		return false;
+
+	//Every cell of every level matches overlap tests against the shapes.
+	for (int32 Level = 0; Level <= 4; Level++)
+	{
+		const int32 NumCells = 1 << Level;
+		const FVector HalfExtent = FVector(100.0 / NumCells - FFAOccupancyGrid::TouchTolerance);
+		int32 Mismatches = 0;
+		for (int32 x = 0; x < NumCells; x++)
+			for (int32 y = 0; y < NumCells; y++)
+				for (int32 z = 0; z < NumCells; z++)
+				{
+					const FVector Centre = FVector(-100) + (FVector(x, y, z) + 0.5) * (200.0 / NumCells);
+					const bool bExpected = FBox::BuildAABB(Centre, HalfExtent).Intersect(Box) ||
+						FMath::ComputeSquaredDistanceFromBoxToPoint(Centre - HalfExtent, Centre + HalfExtent,
+						                                            Sphere.Center) <= FMath::Square(Sphere.W) ||
+						FFAOccupancyGrid::TriangleBoxOverlap(Centre, HalfExtent, Triangle[0], Triangle[1],
+						                                     Triangle[2]);
+					Mismatches += Grid.IsOccupied(Level, Centre) != bExpected;
+				}
+		TestEqual(*FString::Printf(TEXT("Level %d should match the shapes"), Level), Mismatches, 0);
+	}
+	TestFalse(TEXT("Grid without fallback boxes should not need queries"),
+	          Grid.NeedsQuery(FBox(FVector(-100), FVector(100))));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FABoundTreeTest, "FlyingAIPlugin.FAUnitTest.BoundTree",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FABoundTreeTest::RunTest(const FString& Parameters)
+{
+	FRandomStream Stream(0);
+	FFABoundTree Tree;
+	TArray<FBox> Boxes;
+	TArray<int32> Proxies;
+	//Boxes along a line, the worst case of an unbalanced tree.
+	for (int32 i = 0; i < 256; i++)
+	{
+		Boxes.Add(FBox::BuildAABB(FVector(i * 100, Stream.FRandRange(-50, 50), 0),
+		                          FVector(Stream.FRandRange(20, 150))));
+		Proxies.Add(Tree.Insert(Boxes.Last(), i));
+	}
+	TestTrue(TEXT("Tree should stay balanced"), Tree.GetHeight() <= 16);
+
+	auto Check = [&](const TCHAR* What)
+	{
+		for (int32 q = 0; q < 50; q++)
+		{
+			const FVector Point(Stream.FRandRange(-200, 26000), Stream.FRandRange(-200, 200),
+			                    Stream.FRandRange(-200, 200));
+			const FBox Box = FBox::BuildAABB(Point, FVector(Stream.FRandRange(0, 500)));
+			const FVector End = Point + Stream.GetUnitVector() * 2000;
+			TSet<uint32> PointHits, BoxHits, RayHits;
+			Tree.QueryPoint(Point, [&PointHits](uint32 i) { PointHits.Add(i); });
+			Tree.QueryBox(Box, [&BoxHits](uint32 i) { BoxHits.Add(i); });
+			Tree.QueryRay(Point, End, [&RayHits](uint32 i) { RayHits.Add(i); });
+			for (int32 i = 0; i < Boxes.Num(); i++)
+			{
+				const bool bInTree = Proxies[i] != FFABoundTree::NullNode;
+				TestEqual(*FString::Printf(TEXT("%s: point query of box %d"), What, i),
+				          PointHits.Contains(i), bInTree && Boxes[i].IsInsideOrOn(Point));
+				TestEqual(*FString::Printf(TEXT("%s: box query of box %d"), What, i),
+				          BoxHits.Contains(i), bInTree && Boxes[i].Intersect(Box));
+				TestEqual(*FString::Printf(TEXT("%s: ray query of box %d"), What, i),
+				          RayHits.Contains(i),
+				          bInTree && FMath::LineBoxIntersection(Boxes[i], Point, End, End - Point));
+			}
+		}
+	};
+	Check(TEXT("Inserted"));
+	for (int32 i = 0; i < Boxes.Num(); i += 2)
+	{
+		Tree.Remove(Proxies[i]);
+		Proxies[i] = FFABoundTree::NullNode;
+	}
+	for (int32 i = 1; i < Boxes.Num(); i += 4)
+	{
+		Boxes[i] = Boxes[i].ShiftBy(FVector(0, 0, 300));
+		Tree.Move(Proxies[i], Boxes[i]);
+	}
+	TestEqual(TEXT("Removed boxes should not be counted"), Tree.Num(), Boxes.Num() / 2);
+	Check(TEXT("Removed and moved"));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAPathQuerySchedulerTest, "FlyingAIPlugin.FAUnitTest.PathQueryScheduler",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FAPathQuerySchedulerTest::RunTest(const FString& Parameters)
+{
+	FFAPathQueryScheduler Scheduler;
+	TArray<int32> Finished;
+	auto Request = [&](int32 Tag, EFAPathQueryPriority Priority, const UObject* Owner = nullptr,
+	                   const TOptional<FFAPathQueryKey>& Key = {}, int32 MaxSearches = 8)
+	{
+		//Shared results need the locations of a searched path, so requests that share end as failed searches.
+		FFAFinePath FinePath;
+		FinePath.bIsSuccess = !Key.IsSet();
+		FinePath.CurrentHPANodeIndex = Tag;
+		return Scheduler.Schedule(FFAPathQuery::MakeFinished(FinePath), Key, Priority, FObjectKey(Owner), MaxSearches,
+		                          FFAOnPathQueryFinished::CreateLambda([&Finished, Tag](const FFAFinePath& Path)
+		                          {
+			                          Finished.Add(Path.bIsSuccess ? Tag : -Tag);
+		                          }));
+	};
+
+	//Higher priorities are handed over first, in request order within a priority.
+	Request(1, EFAPathQueryPriority::Background);
+	Request(2, EFAPathQueryPriority::Normal);
+	Request(3, EFAPathQueryPriority::PlayerVisible);
+	Request(4, EFAPathQueryPriority::Normal);
+	TestEqual(TEXT("Queue depth of a priority"), Scheduler.GetStats(EFAPathQueryPriority::Normal).QueueDepth, 2);
+	Scheduler.Tick(1, 64);
+	TestTrue(TEXT("Callbacks should follow priority"), Finished == TArray<int32>{3, 2, 4, 1});
+	TestEqual(TEXT("Nothing should be pending once handed over"), Scheduler.Num(), 0);
+	TestEqual(TEXT("Completed requests"), Scheduler.GetStats(EFAPathQueryPriority::Normal).Completed, 2ll);
+
+	//Cancelled requests are never called back.
+	Finished.Reset();
+	const UObject* Owner = GetTransientPackage();
+	const int32 Cancelled = Request(5, EFAPathQueryPriority::Normal);
+	Request(6, EFAPathQueryPriority::Normal, Owner);
+	Request(7, EFAPathQueryPriority::Background, Owner);
+	const int32 Kept = Request(8, EFAPathQueryPriority::Normal);
+	Scheduler.Cancel(Cancelled);
+	TestFalse(TEXT("Cancelled request should not be pending"), Scheduler.IsPending(Cancelled));
+	TestEqual(TEXT("Requests of the owner"), Scheduler.CancelOwner(FObjectKey(Owner)), 2);
+	TestTrue(TEXT("Other requests should stay pending"), Scheduler.IsPending(Kept));
+	Scheduler.Tick(1, 64);
+	TestTrue(TEXT("Only the kept request should be called back"), Finished == TArray<int32>{8});
+	TestEqual(TEXT("Cancelled requests"), Scheduler.GetStats(EFAPathQueryPriority::Normal).Cancelled, 2ll);
+
+	//A full priority rejects requests without blocking the others.
+	Finished.Reset();
+	TestNotEqual(TEXT("Under the limit"), Request(9, EFAPathQueryPriority::Background, nullptr, {}, 1), INDEX_NONE);
+	TestEqual(TEXT("Over the limit"), Request(10, EFAPathQueryPriority::Background, nullptr, {}, 1), INDEX_NONE);
+	TestNotEqual(TEXT("Other priority"), Request(11, EFAPathQueryPriority::Normal, nullptr, {}, 1), INDEX_NONE);
+	TestEqual(TEXT("Rejected requests"), Scheduler.GetStats(EFAPathQueryPriority::Background).Rejected, 1ll);
+
+	//Requests with the same key share one search, even over the limit, and take the result of the first.
+	Scheduler.ResetStats();
+	FFAPathQueryKey Key;
+	Key.StartNode = FFANodeHandle(0, 1);
+	Key.EndHPANode = 2;
+	TestNotEqual(TEXT("Leader"), Request(12, EFAPathQueryPriority::Background, nullptr, Key, 2), INDEX_NONE);
+	TestNotEqual(TEXT("Follower"), Request(13, EFAPathQueryPriority::PlayerVisible, nullptr, Key, 0), INDEX_NONE);
+	FFAPathQuerySchedulerStats Stats = Scheduler.GetStats(EFAPathQueryPriority::PlayerVisible);
+	TestEqual(TEXT("Coalesced requests"), Stats.Coalesced, 1ll);
+	TestEqual(TEXT("The shared search should move to the higher priority"), Stats.Searches, 1);
+	Scheduler.Tick(1, 64);
+	TestTrue(TEXT("Shared requests should be handed over by priority"), Finished == TArray<int32>{-13, 11, -12, 9});
+	Stats = Scheduler.GetStats(EFAPathQueryPriority::PlayerVisible);
+	TestEqual(TEXT("Completed shared request"), Stats.Completed, 1ll);
+	TestTrue(TEXT("Latency should be measured"), Stats.MaxLatency >= Stats.AverageLatency);
+
+	Request(14, EFAPathQueryPriority::Normal);
+	Scheduler.Reset();
+	TestEqual(TEXT("Reset should drop every request"), Scheduler.Num(), 0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAPathQueryTokenTest, "FlyingAIPlugin.FAUnitTest.PathQueryToken",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FAPathQueryTokenTest::RunTest(const FString& Parameters)
+{
+	const TSharedRef<FFAPathQueryToken, ESPMode::ThreadSafe> Parent = MakeShared<
+		FFAPathQueryToken, ESPMode::ThreadSafe>();
+	const TSharedRef<FFAPathQueryToken, ESPMode::ThreadSafe> Child = MakeShared<
+		FFAPathQueryToken, ESPMode::ThreadSafe>(Parent);
+	const TSharedRef<FFAPathQueryToken, ESPMode::ThreadSafe> Sibling = MakeShared<
+		FFAPathQueryToken, ESPMode::ThreadSafe>(Parent);
+	Child->Cancel();
+	TestTrue(TEXT("Cancelled token"), Child->IsCancelled());
+	TestFalse(TEXT("A child should not cancel its parent"), Parent->IsCancelled());
+	TestFalse(TEXT("A child should not cancel its siblings"), Sibling->IsCancelled());
+	Parent->Cancel();
+	TestTrue(TEXT("A parent should cancel its children"), Sibling->IsCancelled());
+
+	//A cancelled query stops before touching any bound, and asks to be requested again.
+	FFAPathQuery Query(FFAFinePath(), FFAPathNodeData(), nullptr, nullptr, FVector::ZeroVector, FVector::ZeroVector);
+	Query.SetToken(Sibling);
+	TestTrue(TEXT("Cancelled query"), Query.Step(64) == EFAPathQueryStatus::Cancelled);
+	TestTrue(TEXT("Cancelled query should be done"), Query.IsDone());
+	TestFalse(TEXT("Cancelled path should be requested again"), Query.GetFinePath().bBoundLoaded);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAPathSearchScratchTest, "FlyingAIPlugin.FAUnitTest.PathSearchScratch",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FAPathSearchScratchTest::RunTest(const FString& Parameters)
+{
+	TUniquePtr<FFAPathSearchScratch> Scratch = FFAPathSearchScratch::Acquire();
+	const FFAPathSearchScratch* First = Scratch.Get();
+	for (int32 i = 0; i < 1000; i++)
+	{
+		Scratch->Records.Add({.Handle = FFANodeHandle(0, i), .Cost = FVector2D(1000 - i, 0)});
+		Scratch->PathLink.Add(i - 1);
+		Scratch->ClosedSet.Add(false);
+		Scratch->Handles.Add(FFANodeHandle(0, i), i);
+		Scratch->OpenSet.Push(i);
+	}
+	TestEqual(TEXT("Open set should order by the records"), Scratch->OpenSet.Pop(), 999);
+	const SIZE_T Size = Scratch->GetAllocatedSize();
+	FFAPathSearchScratch::Release(MoveTemp(Scratch));
+	TestTrue(TEXT("Peak size should be reported"), FFAPathSearchScratch::GetPeakAllocatedSize() >= Size);
+
+	//The same thread gets the scratch back, empty but with its memory.
+	const int32 NumAllocated = FFAPathSearchScratch::GetNumAllocated();
+	Scratch = FFAPathSearchScratch::Acquire();
+	TestTrue(TEXT("Released scratch should be reused"), Scratch.Get() == First);
+	TestEqual(TEXT("Reuse should not allocate a scratch"), FFAPathSearchScratch::GetNumAllocated(), NumAllocated);
+	TestTrue(TEXT("Reused scratch should be empty"), Scratch->Records.Num() == 0 && Scratch->PathLink.Num() == 0 &&
+	         Scratch->Handles.Num() == 0 && Scratch->ClosedSet.Num() == 0 && Scratch->OpenSet.IsEmpty());
+	TestEqual(TEXT("Reused scratch should keep its memory"), Scratch->GetAllocatedSize(), Size);
+	Scratch->Records.Add({.Cost = FVector2D(1, 0)});
+	Scratch->OpenSet.Push(0);
+	TestEqual(TEXT("Reused open set should compare the reused records"), Scratch->OpenSet.Pop(), 0);
+	FFAPathSearchScratch::Release(MoveTemp(Scratch));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAGeneratePathTest, "FlyingAIPlugin.FAUnitTest.GeneratePath",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FAGeneratePathTest::RunTest(const FString& Parameters)
+{
+	//The octants of a bound at the origin, each a neighbour of the three it shares a face with. One HPA node, and
+	//clear enough around every node to pass without overlap tests.
+	FFANewNodeChildType Octants;
+	TSharedPtr<FFaNodeData> Root = MakeShared<FFaNodeData>();
+	Root->HalfExtent = FVector(100);
+	UFAWorldSubsystem::Subdivide(Root, Octants);
+	UDataTable* Table = NewObject<UDataTable>();
+	Table->RowStruct = FFaNodeData::StaticStruct();
+	for (int i = 0; i < 8; i++)
+	{
+		FFaNodeData& Node = *Octants.Children[i];
+		Node.IsTraversable = true;
+		Node.HPANodeIndex = 0;
+		Node.Clearance = 1000;
+		for (const int Axis : {1, 2, 4})
+		{
+			Node.Neighbour.Add(FName(FString::Printf(TEXT("Node_%d"), i ^ Axis)));
+		}
+		Table->AddRow(FName(FString::Printf(TEXT("Node_%d"), i)), Node);
+	}
+	UFANavOctreeData* NavData = NewObject<UFANavOctreeData>();
+	NavData->BuildFromDataTable(Table, Root->Position, Root->HalfExtent);
+	AFABound* Bound = NewObject<AFABound>();
+	Bound->SetBoundData(NewObject<UFABoundData>());
+	Bound->SetBoundIndex(0);
+	Bound->GetLocalToGlobalHPANodes().Add(0, 0);
+	Bound->SetNavData(NavData);
+
+	auto MakeNode = [Bound, NavData](uint32 NodeIndex)
+	{
+		return FFAPathNodeData{
+			.NodeData = NavData->MakeNodeData(NodeIndex), .NodeBound = Bound, .Handle = Bound->MakeNodeHandle(NodeIndex)
+		};
+	};
+	const FFAPathNodeData EndNode = MakeNode(7);
+	auto GeneratePath = [&]
+	{
+		FFAFinePath FinePath;
+		FinePath.HPAPath.EndNode = EndNode;
+		FinePath.HPAPath.EndLocation = FVector(60);
+		FinePath.HPAPath.HPAAssociateBounds = {Bound};
+		FinePath.HPAPath.HPANodes = {0};
+		FinePath.LocalStartNode = MakeNode(0);
+		FinePath.LocalStartLocation = FVector(-60);
+		FinePath.CurrentHPANodeIndex = 0;
+		NewObject<UFAPathfindingAlgo>()->GeneratePath(FinePath, EndNode, nullptr, GetDefault<UFAPathfindingSettings>());
+		TArray<uint32> Nodes;
+		for (const FFAPathNodeData& Node : FinePath.Nodes)
+		{
+			Nodes.Add(Node.Handle.NodeIndex);
+		}
+		return TPair<TArray<uint32>, FFAFinePath>(MoveTemp(Nodes), MoveTemp(FinePath));
+	};
+
+	//Every path across three faces costs the same. Ties go to the less fCost, then the less hCost, then the node
+	//opened first, which is the order of the neighbours in the nodes data.
+	auto [Nodes, FinePath] = GeneratePath();
+	TestTrue(TEXT("Path should be found"), FinePath.bIsSuccess);
+	TestTrue(TEXT("Ties should go to the node opened first"), Nodes == TArray<uint32>{0, 1, 3, 7});
+	TestTrue(TEXT("Path should start with the start node as given"),
+	         FinePath.Nodes.Num() > 0 && FinePath.Nodes[0] == FinePath.LocalStartNode);
+	TestEqual(TEXT("Path nodes should be in world space"), FinePath.Nodes.Last().NodeData.Position, FVector(50));
+	TestEqual(TEXT("Path nodes should be in the global HPA node"), FinePath.Nodes.Last().NodeData.HPANodeIndex,
+	          (uint32)0);
+	//Through the centres of the faces crossed, led in from the start and out past the end location.
+	TestTrue(TEXT("Control points should be the baseline ones"), FinePath.ControlPoints == TArray<FVector>{
+		         FVector(-120, -70, -70), FVector(-60), FVector(0, -50, -50), FVector(50, 0, -50),
+		         FVector(50, 50, 0), FVector(60), FVector(70, 70, 120)
+	         });
+
+	//Blocking octant 3 turns the path to the next tie.
+	TArray<uint32> Changed;
+	Bound->GetObstacleOverlay().AddObstacle(0, FBox(FVector(10, 10, -90), FVector(90, 90, -10)), NavData, Changed);
+	auto [DetourNodes, DetourPath] = GeneratePath();
+	TestTrue(TEXT("Path should go around a blocked node"), DetourNodes == TArray<uint32>{0, 1, 5, 7});
+	TestTrue(TEXT("Detour control points should be the baseline ones"), DetourPath.ControlPoints == TArray<FVector>{
+		         FVector(-120, -70, -70), FVector(-60), FVector(0, -50, -50), FVector(50, -50, 0),
+		         FVector(50, 0, 50), FVector(60), FVector(70, 120, 70)
+	         });
+	return true;
+}
+
+namespace
+{
+	//An editor world of its own for the tests querying the physics scene, destroyed with it.
+	struct FFATestWorld
+	{
+		UWorld* World = UWorld::CreateWorld(EWorldType::Editor, false);
+
+		~FFATestWorld() { World->DestroyWorld(false); }
+
+		//A cube blocking the world static object type.
+		AStaticMeshActor* SpawnCube(const FVector& Location, double HalfExtent) const
+		{
+			AStaticMeshActor* Cube = World->SpawnActor<AStaticMeshActor>(Location, FRotator::ZeroRotator);
+			Cube->SetMobility(EComponentMobility::Movable);
+			Cube->GetStaticMeshComponent()->SetStaticMesh(
+				LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube")));
+			//The mesh is 100 wide.
+			Cube->SetActorScale3D(FVector(HalfExtent / 50));
+			return Cube;
+		}
+	};
+
+	//Runs the steps of a generation on the calling thread.
+	class FFATestNodeGenRunnable : public FFANodeGenRunnable
+	{
+	public:
+		FFATestNodeGenRunnable(UWorld* World, AFABound* Bound, UFABoundData* BoundData,
+		                       const TArray<UDataTable*>& Tables, const TArray<FBox>& DirtyBoxes = {})
+			: FFANodeGenRunnable(World, Bound, BoundData, Tables, DirtyBoxes)
+		{
+		}
+
+		using FFANodeGenRunnable::GenerateAllNodes;
+		using FFANodeGenRunnable::RegenerateDirtyNodes;
+	};
+
+	//Named alike in every set, as the rows are named after their table.
+	TArray<UDataTable*> MakeNodeDataTables()
+	{
+		UPackage* Package = CreatePackage(*MakeUniqueObjectName(nullptr, UPackage::StaticClass(),
+		                                                        TEXT("/Temp/FAUnitTest")).ToString());
+		TArray<UDataTable*> Tables;
+		for (int i = 0; i < 8; i++)
+		{
+			UDataTable* Table = NewObject<UDataTable>(Package, *FString::Printf(TEXT("DT_Test_%d"), i));
+			Table->RowStruct = FFaNodeData::StaticStruct();
+			Tables.Add(Table);
+		}
+		return Tables;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FARegenerateDirtyNodesTest, "FlyingAIPlugin.FAUnitTest.RegenerateDirtyNodes",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FARegenerateDirtyNodesTest::RunTest(const FString& Parameters)
+{
+	FFATestWorld TestWorld;
+	UFAWorldSubsystem* Subsystem = TestWorld.World->GetSubsystem<UFAWorldSubsystem>();
+	if (!TestNotNull(TEXT("Editor worlds should have the world subsystem"), Subsystem)) return false;
+	UFAPathfindingSettings* Settings = GetMutableDefault<UFAPathfindingSettings>();
+	const TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypes = Settings->ObjectTypes;
+	const TSubclassOf<AActor> EnvironmentActorClass = Settings->EnvironmentActorClass;
+	const bool bVoxelizeGeneration = Settings->bVoxelizeGeneration;
+	Settings->ObjectTypes = {ObjectTypeQuery1};
+	//Voxelizing waits for the game thread, which runs the test.
+	Settings->bVoxelizeGeneration = false;
+
+	AFABound* Bound = NewObject<AFABound>();
+	Bound->GetRootComponent()->SetRelativeScale3D(FVector(400) / Bound->GetHalfExtent());
+	UFABoundData* BoundData = NewObject<UFABoundData>();
+	BoundData->MaxDepth = 4;
+	//Across two octants, so two tables are regenerated.
+	const AStaticMeshActor* Cube = TestWorld.SpawnCube(FVector(30, -170, 90), 60);
+
+	//Generated before the cube was part of the environment, no actor of the class is in the world.
+	Settings->EnvironmentActorClass = AFABound::StaticClass();
+	const TArray<UDataTable*> Tables = MakeNodeDataTables();
+	FFATestNodeGenRunnable(TestWorld.World, Bound, BoundData, Tables).GenerateAllNodes(Subsystem);
+	Settings->EnvironmentActorClass = AStaticMeshActor::StaticClass();
+	FFATestNodeGenRunnable(TestWorld.World, Bound, BoundData, Tables, {Cube->GetComponentsBoundingBox(true)}).
+		RegenerateDirtyNodes(Subsystem);
+	const TArray<UDataTable*> FullTables = MakeNodeDataTables();
+	FFATestNodeGenRunnable(TestWorld.World, Bound, BoundData, FullTables).GenerateAllNodes(Subsystem);
+	UFAWorldSubsystem::SetNodeNeighbours(Tables, Bound->GetActorLocation(), Bound->GetHalfExtent());
+	UFAWorldSubsystem::SetNodeNeighbours(FullTables, Bound->GetActorLocation(), Bound->GetHalfExtent());
+
+	Settings->ObjectTypes = ObjectTypes;
+	Settings->EnvironmentActorClass = EnvironmentActorClass;
+	Settings->bVoxelizeGeneration = bVoxelizeGeneration;
+
+	int32 NumBlocked = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		TestEqual(TEXT("Regenerated tables should have the rows of a full generation"),
+		          Tables[i]->GetRowMap().Num(), FullTables[i]->GetRowMap().Num());
+		for (auto& Row : FullTables[i]->GetRowMap())
+		{
+			const FFaNodeData* FullNode = reinterpret_cast<FFaNodeData*>(Row.Value);
+			const FFaNodeData* Node = Tables[i]->FindRow<FFaNodeData>(Row.Key, TEXT(""), false);
+			if (!TestNotNull(*FString::Printf(TEXT("Row %s should be regenerated"), *Row.Key.ToString()), Node))
+				continue;
+			NumBlocked += !FullNode->IsTraversable;
+			TestTrue(TEXT("Regenerated nodes should be the nodes of a full generation"),
+			         Node->Position == FullNode->Position && Node->HalfExtent == FullNode->HalfExtent &&
+			         Node->Depth == FullNode->Depth && Node->IsTraversable == FullNode->IsTraversable);
+			TestEqual(TEXT("Regenerated clearance should be the clearance of a full generation"), Node->Clearance,
+			          FullNode->Clearance, 0.01f);
+			TestTrue(TEXT("Regenerated neighbours should be the neighbours of a full generation"),
+			         Node->Neighbour.Num() == FullNode->Neighbour.Num() && Algo::AllOf(
+				         FullNode->Neighbour, [Node](const FName& Neighbour)
+				         {
+					         return Node->Neighbour.Contains(Neighbour);
+				         }));
+		}
+	}
+	TestTrue(TEXT("The cube should block nodes"), NumBlocked > 0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAComputeNodeClearanceTest, "FlyingAIPlugin.FAUnitTest.ComputeNodeClearance",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FAComputeNodeClearanceTest::RunTest(const FString& Parameters)
+{
+	FFATestWorld TestWorld;
+	//Its nearest face is 140 away from the node along x.
+	TestWorld.SpawnCube(FVector(190, 0, 0), 50);
+	FFaNodeData Node;
+	Node.Position = FVector::ZeroVector;
+	Node.HalfExtent = FVector(25);
+	const TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypes = {ObjectTypeQuery1};
+	auto ComputeClearance = [&](float MaxClearance, TSubclassOf<AActor> ActorClass)
+	{
+		return UFAWorldSubsystem::ComputeNodeClearance(&Node, MaxClearance, 6, ObjectTypes, ActorClass, {},
+		                                               TestWorld.World);
+	};
+
+	//Grown to 100 free and 200 blocked, then bisected 6 times to within 100 / 64 of the face.
+	const float Clearance = ComputeClearance(1000, AStaticMeshActor::StaticClass());
+	TestTrue(TEXT("Clearance should not reach the obstacle"), Clearance < 140);
+	TestTrue(TEXT("Clearance should be refined to the obstacle"), Clearance > 140 - 100.0f / 64);
+	TestEqual(TEXT("Clearance should stop at the max clearance before the obstacle"),
+	          ComputeClearance(100, AStaticMeshActor::StaticClass()), 100.0f);
+	TestEqual(TEXT("Actors of other classes should not limit the clearance"),
+	          ComputeClearance(1000, AFABound::StaticClass()), 1000.0f);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAEdgeClearanceCacheTest, "FlyingAIPlugin.FAUnitTest.EdgeClearanceCache",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::
+                                 EngineFilter)
+
+bool FAEdgeClearanceCacheTest::RunTest(const FString& Parameters)
+{
+	FFAEdgeClearanceCache Cache;
+	auto MakeKey = [](uint32 To, uint32 SizeClass = 0)
+	{
+		return FFAEdgeClearanceKey(FFANodeHandle(0, 0), FFANodeHandle(0, To), SizeClass);
+	};
+	bool bClear = false;
+	TestFalse(TEXT("An edge not tested yet should miss"), Cache.Find(MakeKey(1), bClear));
+	Cache.Add(MakeKey(1), true, 4, Cache.GetEpoch());
+	Cache.Add(MakeKey(2), false, 4, Cache.GetEpoch());
+	TestTrue(TEXT("A cached clear edge should hit"), Cache.Find(MakeKey(1), bClear) && bClear);
+	TestTrue(TEXT("A cached blocked edge should hit"), Cache.Find(MakeKey(2), bClear) && !bClear);
+	TestFalse(TEXT("Edges of another collider size class should miss"), Cache.Find(MakeKey(1, 1), bClear));
+	FFAEdgeClearanceCacheStats Stats = Cache.GetStats();
+	TestEqual(TEXT("Hits should be counted"), Stats.Hits, (int64)2);
+	TestEqual(TEXT("Misses should be counted"), Stats.Misses, (int64)2);
+
+	//Full at 4, the oldest is evicted first and the others stay.
+	for (uint32 To = 3; To <= 5; To++)
+	{
+		Cache.Add(MakeKey(To), true, 4, Cache.GetEpoch());
+	}
+	TestFalse(TEXT("The oldest edge should be evicted"), Cache.Find(MakeKey(1), bClear));
+	TestTrue(TEXT("Other edges should stay cached"), Cache.Find(MakeKey(2), bClear) && Cache.Find(MakeKey(5), bClear));
+	TestEqual(TEXT("The cache should hold at most its max entries"), Cache.GetStats().Entries, (int64)4);
+
+	//An edge tested around the invalidation was tested in the environment before it.
+	const uint64 Epoch = Cache.GetEpoch();
+	Cache.Invalidate();
+	TestFalse(TEXT("Invalidated edges should miss"), Cache.Find(MakeKey(2), bClear));
+	Cache.Add(MakeKey(2), true, 4, Epoch);
+	TestFalse(TEXT("A result tested before an invalidation should be dropped"), Cache.Find(MakeKey(2), bClear));
+	Cache.Add(MakeKey(2), true, 4, Cache.GetEpoch());
+	TestTrue(TEXT("A result tested after an invalidation should be cached"), Cache.Find(MakeKey(2), bClear));
+	TestEqual(TEXT("Invalidations should be counted"), Cache.GetStats().Invalidations, (int64)1);
+	return true;
+}